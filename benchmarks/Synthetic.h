@@ -0,0 +1,171 @@
+/**
+ * File: Synthetic.h
+ * Date: October 2026
+ * Description: synthetic descriptors and fixtures for the benchmarks
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_BENCH_SYNTHETIC__
+#define __D_T_BENCH_SYNTHETIC__
+
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "DBoW2.h"
+
+namespace Synthetic {
+
+/// Seed of every generator, so that runs are reproducible
+static const unsigned int SEED = 20261017;
+
+/// Number of training images of the benchmark vocabularies
+static const int TRAINING_IMAGES = 100;
+
+/// Features per synthetic image
+static const int FEATURES_PER_IMAGE = 300;
+
+/// Branching factor and depth of the benchmark vocabularies
+static const int VOC_K = 10;
+static const int VOC_L = 4;
+
+// ---------------------------------------------------------------------------
+
+/// Random ORB descriptor
+inline cv::Mat orbDescriptor(std::mt19937 &rng)
+{
+  cv::Mat d(1, DBoW2::FORB::L, CV_8U);
+  unsigned char *p = d.ptr<unsigned char>();
+  for(int i = 0; i < DBoW2::FORB::L; ++i) p[i] = (unsigned char)(rng() & 0xff);
+  return d;
+}
+
+/// Random BRIEF descriptor
+inline DBoW2::FBrief::TDescriptor briefDescriptor(std::mt19937 &rng)
+{
+  DBoW2::FBrief::TDescriptor d;
+  for(int i = 0; i < DBoW2::FBrief::L; ++i) if(rng() & 1) d.set(i);
+  return d;
+}
+
+/// Random float descriptor, normalized like SURF and SIFT descriptors
+template<int D>
+inline DBoW2::FloatDescriptor<D> floatDescriptor(std::mt19937 &rng)
+{
+  std::normal_distribution<float> normal;
+  DBoW2::FloatDescriptor<D> d;
+  float n = 0.f;
+  for(int i = 0; i < D; ++i)
+  {
+    d[i] = normal(rng);
+    n += d[i] * d[i];
+  }
+  n = std::sqrt(n);
+  for(int i = 0; i < D; ++i) d[i] /= n;
+  return d;
+}
+
+/// Random semantic ORB descriptor with a class in [-1, nclasses)
+inline DBoW2::FSORB::TDescriptor sorbDescriptor(std::mt19937 &rng,
+  int nclasses = 8)
+{
+  const int c = (int)(rng() % (nclasses + 1)) - 1;
+  return std::make_pair(orbDescriptor(rng), c);
+}
+
+/// Images of random descriptors. Image i is generated from seed SEED + i
+template<class TDescriptor, class Gen>
+std::vector<std::vector<TDescriptor> > images(int n, Gen gen,
+  int first = 0, int features = FEATURES_PER_IMAGE)
+{
+  std::vector<std::vector<TDescriptor> > ret(n);
+  for(int i = 0; i < n; ++i)
+  {
+    std::mt19937 rng(SEED + first + i);
+    ret[i].reserve(features);
+    for(int j = 0; j < features; ++j) ret[i].push_back(gen(rng));
+  }
+  return ret;
+}
+
+inline cv::Mat genOrb(std::mt19937 &rng) { return orbDescriptor(rng); }
+inline DBoW2::FSORB::TDescriptor genSorb(std::mt19937 &rng)
+  { return sorbDescriptor(rng); }
+inline DBoW2::FBrief::TDescriptor genBrief(std::mt19937 &rng)
+  { return briefDescriptor(rng); }
+inline DBoW2::FSurf64::TDescriptor genSurf(std::mt19937 &rng)
+  { return floatDescriptor<64>(rng); }
+inline DBoW2::FFloat128::TDescriptor genFloat128(std::mt19937 &rng)
+  { return floatDescriptor<128>(rng); }
+
+// ---------------------------------------------------------------------------
+
+/// ORB vocabulary trained once on synthetic images
+inline const OrbVocabulary& orbVocabulary()
+{
+  static OrbVocabulary *voc = NULL;
+  if(!voc)
+  {
+    srand(SEED);
+    voc = new OrbVocabulary(VOC_K, VOC_L, DBoW2::TF_IDF, DBoW2::L1_NORM);
+    voc->create(images<cv::Mat>(TRAINING_IMAGES, genOrb));
+  }
+  return *voc;
+}
+
+/// SURF vocabulary trained once on synthetic images
+inline const SurfVocabulary& surfVocabulary()
+{
+  static SurfVocabulary *voc = NULL;
+  if(!voc)
+  {
+    srand(SEED);
+    voc = new SurfVocabulary(VOC_K, VOC_L, DBoW2::TF_IDF, DBoW2::L1_NORM);
+    voc->create(images<DBoW2::FSurf64::TDescriptor>(TRAINING_IMAGES,
+      genSurf));
+  }
+  return *voc;
+}
+
+/// Semantic ORB vocabulary trained once on synthetic images
+inline const SemanticOrbVocabulary& sorbVocabulary()
+{
+  static SemanticOrbVocabulary *voc = NULL;
+  if(!voc)
+  {
+    srand(SEED);
+    voc = new SemanticOrbVocabulary(VOC_K, VOC_L, DBoW2::TF_IDF,
+      DBoW2::L1_NORM);
+    voc->create(images<DBoW2::FSORB::TDescriptor>(TRAINING_IMAGES, genSorb));
+  }
+  return *voc;
+}
+
+/// Semantic ORB database with the given scoring and number of entries.
+/// Databases are built once and kept for the whole run
+inline const SemanticOrbDatabase& sorbDatabase(DBoW2::ScoringType scoring,
+  int entries)
+{
+  static std::map<std::pair<int, int>, SemanticOrbDatabase*> dbs;
+
+  SemanticOrbDatabase *&db = dbs[std::make_pair((int)scoring, entries)];
+  if(!db)
+  {
+    SemanticOrbVocabulary voc = sorbVocabulary();
+    voc.setScoringType(scoring);
+
+    db = new SemanticOrbDatabase(voc, false, 0);
+    std::vector<std::vector<DBoW2::FSORB::TDescriptor> > imgs =
+      images<DBoW2::FSORB::TDescriptor>(entries, genSorb, TRAINING_IMAGES);
+    for(size_t i = 0; i < imgs.size(); ++i) db->add(imgs[i]);
+  }
+  return *db;
+}
+
+} // namespace Synthetic
+
+#endif
@@ -0,0 +1,499 @@
+/**
+ * File: SyntheticDataset.h
+ * Date: October 2026
+ * Description: generator, writer and reader of synthetic descriptor corpora
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_BENCH_SYNTHETIC_DATASET__
+#define __D_T_BENCH_SYNTHETIC_DATASET__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "DBoW2.h"
+
+namespace Synthetic {
+
+/// Parameters of a synthetic corpus
+/**
+ * The corpus simulates a camera moving through a sequence of places.
+ * Every place has a set of landmarks, each one a noisy copy of one of the
+ * global cluster centers, with a fixed semantic class. A place is seen for
+ * some consecutive frames, and each frame observes a subset of its
+ * landmarks, keeping a fraction of the landmarks of the previous frame
+ * (tracked features). When moving to a new place, the camera may revisit
+ * a place seen before instead.
+ */
+struct DatasetParams
+{
+  /// Number of frames
+  unsigned int frames;
+  /// Features per frame
+  unsigned int features;
+  /// Number of global cluster centers of the descriptor space
+  unsigned int clusters;
+  /// Bits flipped from the cluster center to create a landmark
+  unsigned int cluster_spread;
+  /// Bits flipped from the landmark every time it is observed
+  unsigned int observation_noise;
+  /// Landmarks of each place
+  unsigned int landmarks_per_place;
+  /// Consecutive frames that observe the same place
+  unsigned int frames_per_place;
+  /// Fraction of landmarks of a frame kept in the next one of the same place
+  double coherence;
+  /// Probability of going to an already visited place when moving
+  double revisit_probability;
+  /// Store semantic classes
+  bool semantic;
+  /// Number of semantic classes
+  unsigned int classes;
+  /// Exponent of the Zipf distribution of the classes
+  double class_skew;
+  /// Fraction of landmarks without class (class -1)
+  double unlabelled;
+  /// Seed of the generator
+  unsigned int seed;
+
+  /**
+   * Default parameters: ORB-like 300-feature frames
+   */
+  DatasetParams(): frames(1000), features(300), clusters(4096),
+    cluster_spread(24), observation_noise(6), landmarks_per_place(1000),
+    frames_per_place(10), coherence(0.8), revisit_probability(0.2),
+    semantic(true), classes(16), class_skew(1.0), unlabelled(0.3),
+    seed(20261017){}
+};
+
+/// Uniform integer in [0, n) from a 32-bit generator. Standard
+/// distributions are avoided to get the same corpus on every platform
+inline unsigned int uniformInt(std::mt19937 &rng, unsigned int n)
+{
+  return (unsigned int)(((uint64_t)rng() * n) >> 32);
+}
+
+/// Uniform real in [0, 1)
+inline double uniformReal(std::mt19937 &rng)
+{
+  return rng() / 4294967296.0;
+}
+
+// ---------------------------------------------------------------------------
+
+/// A frame of the corpus
+struct Frame
+{
+  /// Place observed
+  uint32_t place;
+  /// First frame of the first visit to this place, or -1 if it was not
+  /// visited before (ground truth for loop detection)
+  int32_t revisit_of;
+  /// Row-major N x FORB::L descriptor bytes
+  std::vector<unsigned char> descriptors;
+  /// N classes (only in semantic corpora)
+  std::vector<int16_t> classes;
+
+  /**
+   * Returns the number of features of the frame
+   */
+  inline size_t size() const { return descriptors.size() / DBoW2::FORB::L; }
+
+  /**
+   * Returns the features as ORB descriptors
+   * @param features (out)
+   */
+  void toOrb(std::vector<DBoW2::FORB::TDescriptor> &features) const
+  {
+    features.resize(size());
+    for(size_t i = 0; i < features.size(); ++i)
+    {
+      features[i].create(1, DBoW2::FORB::L, CV_8U);
+      std::memcpy(features[i].ptr<unsigned char>(),
+        &descriptors[i * DBoW2::FORB::L], DBoW2::FORB::L);
+    }
+  }
+
+  /**
+   * Returns the features as semantic ORB descriptors
+   * @param features (out)
+   */
+  void toSemanticOrb(std::vector<DBoW2::FSORB::TDescriptor> &features) const
+  {
+    features.resize(size());
+    for(size_t i = 0; i < features.size(); ++i)
+    {
+      features[i].first.create(1, DBoW2::FORB::L, CV_8U);
+      std::memcpy(features[i].first.ptr<unsigned char>(),
+        &descriptors[i * DBoW2::FORB::L], DBoW2::FORB::L);
+      features[i].second = (classes.empty() ? -1 : classes[i]);
+    }
+  }
+};
+
+// ---------------------------------------------------------------------------
+
+/// Generates the frames of a corpus one by one
+/**
+ * Landmarks are not stored; they are regenerated from a seed derived from
+ * their place and index, so the memory used does not depend on the
+ * number of frames.
+ */
+class DatasetGenerator
+{
+public:
+
+  /**
+   * Creates the generator and the cluster centers
+   * @param params
+   */
+  explicit DatasetGenerator(const DatasetParams &params)
+    : m_params(params), m_rng(params.seed), m_frame(0), m_place(0),
+      m_nplaces(0), m_revisit_of(-1), m_new_place(true)
+  {
+    m_centers.resize((size_t)params.clusters * DBoW2::FORB::L);
+    for(size_t i = 0; i < m_centers.size(); ++i)
+      m_centers[i] = (unsigned char)(m_rng() & 0xff);
+
+    // cumulative Zipf distribution of classes
+    m_class_cdf.resize(params.classes);
+    double sum = 0;
+    for(unsigned int c = 0; c < params.classes; ++c)
+    {
+      sum += 1.0 / std::pow((double)(c + 1), params.class_skew);
+      m_class_cdf[c] = sum;
+    }
+    for(unsigned int c = 0; c < params.classes; ++c) m_class_cdf[c] /= sum;
+  }
+
+  /**
+   * Returns the parameters of the corpus
+   */
+  inline const DatasetParams& params() const { return m_params; }
+
+  /**
+   * Generates the next frame
+   * @param frame (out)
+   * @return false if all the frames were already generated
+   */
+  bool next(Frame &frame)
+  {
+    if(m_frame >= m_params.frames) return false;
+
+    const unsigned int nf = m_params.features;
+    const unsigned int L = DBoW2::FORB::L;
+
+    if(m_frame % m_params.frames_per_place == 0) moveToPlace();
+
+    frame.place = m_place;
+    frame.revisit_of = m_revisit_of;
+
+    // choose landmarks: keep some of the previous frame, resample the rest
+    m_landmarks.resize(nf);
+    for(unsigned int i = 0; i < nf; ++i)
+    {
+      if(!m_new_place && uniformReal(m_rng) < m_params.coherence) continue;
+      m_landmarks[i] = uniformInt(m_rng, m_params.landmarks_per_place);
+    }
+    m_new_place = false;
+
+    frame.descriptors.resize((size_t)nf * L);
+    frame.classes.resize(m_params.semantic ? nf : 0);
+
+    for(unsigned int i = 0; i < nf; ++i)
+    {
+      unsigned char *d = &frame.descriptors[(size_t)i * L];
+      int c = makeLandmark(m_place, m_landmarks[i], d);
+      if(m_params.semantic) frame.classes[i] = (int16_t)c;
+
+      for(unsigned int b = 0; b < m_params.observation_noise; ++b)
+      {
+        unsigned int k = uniformInt(m_rng, L * 8);
+        d[k / 8] ^= (unsigned char)(1 << (k % 8));
+      }
+    }
+
+    ++m_frame;
+    return true;
+  }
+
+protected:
+
+  /**
+   * Selects the place of the next frames
+   */
+  void moveToPlace()
+  {
+    if(m_nplaces > 1 && uniformReal(m_rng) < m_params.revisit_probability)
+    {
+      // any place but the newest one
+      m_place = uniformInt(m_rng, m_nplaces - 1);
+      m_revisit_of = (int32_t)m_first_frame[m_place];
+    }
+    else
+    {
+      m_place = m_nplaces++;
+      m_first_frame.push_back(m_frame);
+      m_revisit_of = -1;
+    }
+    m_new_place = true;
+  }
+
+  /**
+   * Writes the descriptor of a landmark and returns its class
+   * @param place
+   * @param index landmark index in the place
+   * @param d (out) FORB::L bytes
+   * @return class, -1 if unlabelled
+   */
+  int makeLandmark(unsigned int place, unsigned int index,
+    unsigned char *d) const
+  {
+    std::mt19937 rng((uint32_t)(m_params.seed * 2654435761u) ^
+      (place * 40503u + index * 2246822519u));
+
+    const unsigned int L = DBoW2::FORB::L;
+    const unsigned int cluster = uniformInt(rng, m_params.clusters);
+    std::memcpy(d, &m_centers[(size_t)cluster * L], L);
+
+    for(unsigned int b = 0; b < m_params.cluster_spread; ++b)
+    {
+      unsigned int k = uniformInt(rng, L * 8);
+      d[k / 8] ^= (unsigned char)(1 << (k % 8));
+    }
+
+    if(m_params.classes == 0 || uniformReal(rng) < m_params.unlabelled)
+      return -1;
+
+    const double r = uniformReal(rng);
+    return (int)(std::upper_bound(m_class_cdf.begin(), m_class_cdf.end() - 1,
+      r) - m_class_cdf.begin());
+  }
+
+protected:
+
+  DatasetParams m_params;
+  std::mt19937 m_rng;
+  std::vector<unsigned char> m_centers;
+  std::vector<double> m_class_cdf;
+
+  /// Frames generated so far
+  unsigned int m_frame;
+  /// Current place
+  unsigned int m_place;
+  /// Places created so far
+  unsigned int m_nplaces;
+  /// First frame of each place
+  std::vector<unsigned int> m_first_frame;
+  /// Revisit information of the current place
+  int32_t m_revisit_of;
+  /// Whether no frame of the current visit has been generated
+  bool m_new_place;
+  /// Landmarks observed in the last frame
+  std::vector<unsigned int> m_landmarks;
+};
+
+// ---------------------------------------------------------------------------
+
+/// Binary corpus file
+/**
+ * Format (little endian, whatever the byte order of the host):
+ *   char[8] "DBW2SYN1"
+ *   uint32 descriptor bytes, uint32 semantic flag, uint32 frames,
+ *   uint32 classes
+ *   for each frame:
+ *     uint32 features, uint32 place, int32 revisit_of,
+ *     features x descriptor bytes,
+ *     features x int16 class (only if semantic)
+ */
+class DatasetFile
+{
+public:
+
+  DatasetFile(): m_f(NULL), m_semantic(false), m_frames(0), m_classes(0){}
+
+  ~DatasetFile() { close(); }
+
+  /**
+   * Creates a file and writes its header
+   * @param filename
+   * @param params parameters of the corpus that will be written
+   * @return false on error
+   */
+  bool create(const std::string &filename, const DatasetParams &params)
+  {
+    close();
+    m_f = std::fopen(filename.c_str(), "wb");
+    if(!m_f) return false;
+
+    m_semantic = params.semantic;
+    m_frames = params.frames;
+    m_classes = params.classes;
+
+    unsigned char header[16];
+    putU32(header, (uint32_t)DBoW2::FORB::L);
+    putU32(header + 4, (uint32_t)(m_semantic ? 1 : 0));
+    putU32(header + 8, m_frames);
+    putU32(header + 12, m_classes);
+    return std::fwrite(magic(), 1, 8, m_f) == 8 &&
+      std::fwrite(header, 1, 16, m_f) == 16;
+  }
+
+  /**
+   * Opens a file and reads its header
+   * @param filename
+   * @return false on error or if the file is not a corpus
+   */
+  bool open(const std::string &filename)
+  {
+    close();
+    m_f = std::fopen(filename.c_str(), "rb");
+    if(!m_f) return false;
+
+    char magic[8];
+    unsigned char header[16];
+    if(std::fread(magic, 1, 8, m_f) != 8 ||
+      std::memcmp(magic, this->magic(), 8) != 0 ||
+      std::fread(header, 1, 16, m_f) != 16 ||
+      getU32(header) != (uint32_t)DBoW2::FORB::L)
+    {
+      close();
+      return false;
+    }
+
+    m_semantic = (getU32(header + 4) != 0);
+    m_frames = getU32(header + 8);
+    m_classes = getU32(header + 12);
+    return true;
+  }
+
+  /**
+   * Appends a frame
+   * @param frame
+   * @return false on error
+   */
+  bool write(const Frame &frame)
+  {
+    const uint32_t n = (uint32_t)frame.size();
+    unsigned char header[12];
+    putU32(header, n);
+    putU32(header + 4, frame.place);
+    putU32(header + 8, (uint32_t)frame.revisit_of);
+
+    bool ok = std::fwrite(header, 1, 12, m_f) == 12 &&
+      std::fwrite(frame.descriptors.data(), 1, frame.descriptors.size(), m_f)
+        == frame.descriptors.size();
+
+    if(ok && m_semantic)
+    {
+      m_buffer.resize((size_t)n * 2);
+      for(uint32_t i = 0; i < n; ++i)
+      {
+        const uint16_t c = (uint16_t)frame.classes[i];
+        m_buffer[2*i] = (unsigned char)(c & 0xff);
+        m_buffer[2*i + 1] = (unsigned char)(c >> 8);
+      }
+      ok = std::fwrite(m_buffer.data(), 1, m_buffer.size(), m_f) ==
+        m_buffer.size();
+    }
+    return ok;
+  }
+
+  /**
+   * Reads the next frame
+   * @param frame (out)
+   * @return false at the end of the file or on error
+   */
+  bool read(Frame &frame)
+  {
+    unsigned char header[12];
+    if(std::fread(header, 1, 12, m_f) != 12) return false;
+
+    const uint32_t n = getU32(header);
+    frame.place = getU32(header + 4);
+    frame.revisit_of = (int32_t)getU32(header + 8);
+
+    frame.descriptors.resize((size_t)n * DBoW2::FORB::L);
+    frame.classes.resize(m_semantic ? n : 0);
+
+    if(std::fread(frame.descriptors.data(), 1, frame.descriptors.size(), m_f)
+      != frame.descriptors.size()) return false;
+
+    if(m_semantic)
+    {
+      m_buffer.resize((size_t)n * 2);
+      if(std::fread(m_buffer.data(), 1, m_buffer.size(), m_f) !=
+        m_buffer.size()) return false;
+      for(uint32_t i = 0; i < n; ++i)
+        frame.classes[i] = (int16_t)(uint16_t)
+          (m_buffer[2*i] | (m_buffer[2*i + 1] << 8));
+    }
+    return true;
+  }
+
+  /**
+   * Goes back to the first frame of an opened file
+   * @return false on error
+   */
+  bool rewind()
+  {
+    return m_f && std::fseek(m_f, 8 + 16, SEEK_SET) == 0;
+  }
+
+  /**
+   * Closes the file
+   */
+  void close()
+  {
+    if(m_f) std::fclose(m_f);
+    m_f = NULL;
+  }
+
+  /// Header information
+  inline bool semantic() const { return m_semantic; }
+  inline unsigned int frames() const { return m_frames; }
+  inline unsigned int classes() const { return m_classes; }
+
+protected:
+
+  /// Magic number of corpus files
+  static inline const char* magic() { return "DBW2SYN1"; }
+
+  /// Little endian encoding of 32-bit integers
+  static inline void putU32(unsigned char *p, uint32_t v)
+  {
+    p[0] = (unsigned char)(v & 0xff);
+    p[1] = (unsigned char)((v >> 8) & 0xff);
+    p[2] = (unsigned char)((v >> 16) & 0xff);
+    p[3] = (unsigned char)(v >> 24);
+  }
+
+  static inline uint32_t getU32(const unsigned char *p)
+  {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+      ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+  }
+
+  FILE *m_f;
+  bool m_semantic;
+  uint32_t m_frames;
+  uint32_t m_classes;
+  /// Encoded classes of a frame
+  std::vector<unsigned char> m_buffer;
+
+private:
+
+  DatasetFile(const DatasetFile &);
+  DatasetFile& operator=(const DatasetFile &);
+};
+
+} // namespace Synthetic
+
+#endif
@@ -0,0 +1,98 @@
+/**
+ * File: bench_database.cpp
+ * Date: October 2026
+ * Description: benchmarks of database insertions and queries
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Synthetic.h"
+
+using namespace DBoW2;
+
+// ---------------------------------------------------------------------------
+
+static void BM_DatabaseAdd(benchmark::State &state)
+{
+  const SemanticOrbVocabulary &voc = Synthetic::sorbVocabulary();
+  const bool use_di = (state.range(0) != 0);
+
+  const std::vector<std::vector<FSORB::TDescriptor> > imgs =
+    Synthetic::images<FSORB::TDescriptor>(64, Synthetic::genSorb,
+      Synthetic::TRAINING_IMAGES);
+
+  SemanticOrbDatabase db(voc, use_di, 2);
+
+  size_t i = 0;
+  for(auto _ : state)
+  {
+    benchmark::DoNotOptimize(db.add(imgs[i]));
+    if(++i == imgs.size())
+    {
+      i = 0;
+      state.PauseTiming();
+      db.clear();
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_DatabaseAdd)->Arg(0)->Arg(1)->ArgName("use_di");
+
+// ---------------------------------------------------------------------------
+
+static void BM_DatabaseQuery(benchmark::State &state)
+{
+  const ScoringType scoring = (ScoringType)state.range(0);
+  const int entries = (int)state.range(1);
+
+  const SemanticOrbDatabase &db = Synthetic::sorbDatabase(scoring, entries);
+
+  // queries are images revisiting the database entries
+  const std::vector<std::vector<FSORB::TDescriptor> > queries =
+    Synthetic::images<FSORB::TDescriptor>(16, Synthetic::genSorb,
+      Synthetic::TRAINING_IMAGES);
+
+  // the classes of the words are computed once, along with the vectors
+  std::vector<BowVector> vecs(queries.size());
+  std::vector<std::vector<int> > classes(queries.size());
+  TransformContext ctx;
+  for(size_t i = 0; i < queries.size(); ++i)
+  {
+    db.getVocabulary()->transform(queries[i], ctx);
+    ctx.toBowVector(vecs[i]);
+
+    std::vector<int> feature_classes(queries[i].size());
+    for(size_t k = 0; k < queries[i].size(); ++k)
+      feature_classes[k] = queries[i][k].second;
+    ctx.wordClasses(&feature_classes[0], classes[i]);
+  }
+
+  QueryResults ret;
+  size_t i = 0;
+  for(auto _ : state)
+  {
+    db.query(vecs[i], &classes[i][0], ret, 10);
+    benchmark::DoNotOptimize(ret);
+    if(++i == queries.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void QueryArgs(benchmark::internal::Benchmark *b)
+{
+  b->ArgNames({"scoring", "entries"});
+  for(int s = L1_NORM; s <= DOT_PRODUCT; ++s)
+  {
+    // KL completes every score with a scan of the query rows
+    const int max_entries = (s == KL ? 1000 : 10000);
+    for(int n = 100; n <= max_entries; n *= 10) b->Args({s, n});
+  }
+}
+
+BENCHMARK(BM_DatabaseQuery)->Apply(QueryArgs);
@@ -0,0 +1,80 @@
+/**
+ * File: bench_descriptors.cpp
+ * Date: October 2026
+ * Description: benchmarks of the descriptor functions
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Synthetic.h"
+
+using namespace DBoW2;
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F, TDescriptor (*Gen)(std::mt19937&)>
+static void BM_Distance(benchmark::State &state)
+{
+  std::mt19937 rng(Synthetic::SEED);
+  std::vector<TDescriptor> a, b;
+  for(int i = 0; i < 256; ++i)
+  {
+    a.push_back(Gen(rng));
+    b.push_back(Gen(rng));
+  }
+
+  size_t i = 0;
+  for(auto _ : state)
+  {
+    benchmark::DoNotOptimize(F::distance(a[i], b[i]));
+    i = (i + 1) & 255;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_Distance, FORB::TDescriptor, FORB, Synthetic::genOrb);
+BENCHMARK_TEMPLATE(BM_Distance, FSORB::TDescriptor, FSORB,
+  Synthetic::genSorb);
+BENCHMARK_TEMPLATE(BM_Distance, FBrief::TDescriptor, FBrief,
+  Synthetic::genBrief);
+BENCHMARK_TEMPLATE(BM_Distance, FSurf64::TDescriptor, FSurf64,
+  Synthetic::genSurf);
+BENCHMARK_TEMPLATE(BM_Distance, FFloat128::TDescriptor, FFloat128,
+  Synthetic::genFloat128);
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F, TDescriptor (*Gen)(std::mt19937&)>
+static void BM_MeanValue(benchmark::State &state)
+{
+  std::mt19937 rng(Synthetic::SEED);
+  std::vector<TDescriptor> descriptors;
+  for(int i = 0; i < state.range(0); ++i) descriptors.push_back(Gen(rng));
+
+  std::vector<const TDescriptor*> pdescriptors;
+  for(size_t i = 0; i < descriptors.size(); ++i)
+    pdescriptors.push_back(&descriptors[i]);
+
+  TDescriptor mean;
+  for(auto _ : state)
+  {
+    F::meanValue(pdescriptors, mean);
+    benchmark::DoNotOptimize(mean);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK_TEMPLATE(BM_MeanValue, FORB::TDescriptor, FORB, Synthetic::genOrb)
+  ->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK_TEMPLATE(BM_MeanValue, FSORB::TDescriptor, FSORB,
+  Synthetic::genSorb)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK_TEMPLATE(BM_MeanValue, FBrief::TDescriptor, FBrief,
+  Synthetic::genBrief)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK_TEMPLATE(BM_MeanValue, FSurf64::TDescriptor, FSurf64,
+  Synthetic::genSurf)->RangeMultiplier(10)->Range(10, 100000);
+BENCHMARK_TEMPLATE(BM_MeanValue, FFloat128::TDescriptor, FFloat128,
+  Synthetic::genFloat128)->RangeMultiplier(10)->Range(10, 100000);
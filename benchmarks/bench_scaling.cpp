@@ -0,0 +1,318 @@
+/**
+ * File: bench_scaling.cpp
+ * Date: October 2026
+ * Description: scaling benchmarks on synthetic corpora
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Synthetic.h"
+#include "SyntheticDataset.h"
+
+using namespace DBoW2;
+
+// The corpus is read from the file in DBOW2_DATASET (see gen_dataset) or
+// generated with the default parameters; the benchmarks fail if that file
+// cannot be opened. DBOW2_MAX_ENTRIES limits the size of the largest
+// database (10000 by default).
+
+namespace {
+
+// ---------------------------------------------------------------------------
+
+/// Frames of the corpus, read or generated on demand
+/**
+ * Frames are streamed: only the last one and the indexes of the revisits
+ * are kept. Going back to an earlier frame rewinds the file or restarts
+ * the generator, so frames should be requested in increasing order.
+ */
+class Corpus
+{
+public:
+
+  static Corpus& instance()
+  {
+    static Corpus corpus;
+    return corpus;
+  }
+
+  /// Empty if the corpus can be read, or the reason why it cannot
+  inline const std::string& error() const { return m_error; }
+
+  /// Returns frame i. A corpus file shorter than i frames is repeated
+  void get(size_t i, std::vector<FSORB::TDescriptor> &features)
+  {
+    if(m_length > 0) i %= m_length;
+    if(i + 1 < m_next) restart();
+
+    while(m_next <= i)
+    {
+      if(!(m_use_file ? m_file.read(m_frame) : m_generator.next(m_frame)))
+      {
+        if(m_next == 0)
+          throw std::string("The synthetic corpus is empty");
+        m_length = m_next;
+        i %= m_length;
+        restart();
+        continue;
+      }
+
+      if(m_next == m_scanned)
+      {
+        if(m_frame.revisit_of >= 0) m_revisits.push_back(m_next);
+        ++m_scanned;
+      }
+      ++m_next;
+    }
+
+    m_frame.toSemanticOrb(features);
+  }
+
+  /// Frames that revisit a place, among the first n frames
+  std::vector<size_t> revisits(size_t n)
+  {
+    std::vector<FSORB::TDescriptor> aux;
+    get(n - 1, aux);
+
+    std::vector<size_t> ret;
+    for(size_t i = 0; i < m_revisits.size() && m_revisits[i] < n; ++i)
+      ret.push_back(m_revisits[i]);
+    return ret;
+  }
+
+private:
+
+  Corpus(): m_generator(params()), m_use_file(false), m_next(0),
+    m_scanned(0), m_length(0)
+  {
+    const char *filename = getenv("DBOW2_DATASET");
+    if(filename)
+    {
+      m_use_file = true;
+      if(!m_file.open(filename))
+        m_error = std::string("Could not open the corpus ") + filename;
+    }
+  }
+
+  static Synthetic::DatasetParams params()
+  {
+    Synthetic::DatasetParams p;
+    p.frames = 1000000;
+    return p;
+  }
+
+  /// Goes back to the first frame
+  void restart()
+  {
+    if(m_use_file)
+    {
+      if(!m_file.rewind())
+        throw std::string("Could not rewind the synthetic corpus");
+    }
+    else
+      m_generator = Synthetic::DatasetGenerator(params());
+    m_next = 0;
+  }
+
+  Synthetic::DatasetGenerator m_generator;
+  Synthetic::DatasetFile m_file;
+  bool m_use_file;
+  std::string m_error;
+  /// Last frame read
+  Synthetic::Frame m_frame;
+  /// Index of the next frame to read
+  size_t m_next;
+  /// Frames read at least once
+  size_t m_scanned;
+  /// Frames of the corpus, 0 until the end is reached
+  size_t m_length;
+  /// Indexes of the frames that revisit a place
+  std::vector<size_t> m_revisits;
+};
+
+/// Skips the benchmark if the corpus cannot be read
+bool corpusOk(benchmark::State &state)
+{
+  const std::string &error = Corpus::instance().error();
+  if(!error.empty()) state.SkipWithError(error.c_str());
+  return error.empty();
+}
+
+// ---------------------------------------------------------------------------
+
+/// Vocabulary trained on the first frames of the corpus
+const SemanticOrbVocabulary& corpusVocabulary()
+{
+  static SemanticOrbVocabulary *voc = NULL;
+  if(!voc)
+  {
+    std::vector<std::vector<FSORB::TDescriptor> > training(200);
+    for(size_t i = 0; i < training.size(); ++i)
+      Corpus::instance().get(i * 5, training[i]);
+
+    srand(Synthetic::SEED);
+    voc = new SemanticOrbVocabulary(Synthetic::VOC_K, Synthetic::VOC_L + 1);
+    voc->create(training);
+  }
+  return *voc;
+}
+
+/// Largest database size
+int maxEntries()
+{
+  const char *s = getenv("DBOW2_MAX_ENTRIES");
+  return (s ? atoi(s) : 10000);
+}
+
+/// Sizes from 1000 to maxEntries()
+void Sizes(benchmark::internal::Benchmark *b)
+{
+  for(int n = 1000; n <= maxEntries(); n *= 10) b->Arg(n);
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+
+static void BM_ScalingCreate(benchmark::State &state)
+{
+  if(!corpusOk(state)) return;
+
+  std::vector<std::vector<FSORB::TDescriptor> > training(state.range(0));
+  for(size_t i = 0; i < training.size(); ++i)
+    Corpus::instance().get(i, training[i]);
+
+  for(auto _ : state)
+  {
+    srand(Synthetic::SEED);
+    SemanticOrbVocabulary voc(Synthetic::VOC_K, Synthetic::VOC_L);
+    voc.create(training);
+    benchmark::DoNotOptimize(voc.size());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+BENCHMARK(BM_ScalingCreate)->Arg(10)->Arg(100)->Arg(1000)
+  ->Unit(benchmark::kMillisecond)->Iterations(1);
+
+// ---------------------------------------------------------------------------
+
+static void BM_ScalingTransform(benchmark::State &state)
+{
+  if(!corpusOk(state)) return;
+
+  const SemanticOrbVocabulary &voc = corpusVocabulary();
+
+  std::vector<std::vector<FSORB::TDescriptor> > frames(100);
+  for(size_t i = 0; i < frames.size(); ++i)
+    Corpus::instance().get(i, frames[i]);
+
+  BowVector v;
+  FeatureVector fv;
+  size_t i = 0, features = 0;
+  for(auto _ : state)
+  {
+    voc.transform(frames[i], v, fv, 2);
+    features += frames[i].size();
+    if(++i == frames.size()) i = 0;
+  }
+  state.SetItemsProcessed(features);
+}
+
+BENCHMARK(BM_ScalingTransform);
+
+// ---------------------------------------------------------------------------
+
+static void BM_ScalingDatabaseAdd(benchmark::State &state)
+{
+  if(!corpusOk(state)) return;
+
+  const SemanticOrbVocabulary &voc = corpusVocabulary();
+  const int entries = state.range(0);
+
+  // entries are transformed in chunks, without measuring it, to bound the
+  // memory of the precomputed vectors
+  const int chunk = 1000;
+  std::vector<BowVector> vecs(chunk);
+  std::vector<FeatureVector> fvs(chunk);
+  std::vector<FSORB::TDescriptor> features;
+
+  for(auto _ : state)
+  {
+    SemanticOrbDatabase *db = new SemanticOrbDatabase(voc, true, 2);
+    for(int i = 0; i < entries; i += chunk)
+    {
+      const int n = std::min(chunk, entries - i);
+
+      state.PauseTiming();
+      for(int j = 0; j < n; ++j)
+      {
+        Corpus::instance().get(i + j, features);
+        voc.transform(features, vecs[j], fvs[j], 2);
+      }
+      state.ResumeTiming();
+
+      for(int j = 0; j < n; ++j) db->add(vecs[j], fvs[j]);
+    }
+    benchmark::DoNotOptimize(db->size());
+
+    state.PauseTiming(); // do not measure the destruction
+    delete db;
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(state.iterations() * entries);
+}
+
+BENCHMARK(BM_ScalingDatabaseAdd)->Apply(Sizes)
+  ->Unit(benchmark::kMillisecond)->Iterations(1);
+
+// ---------------------------------------------------------------------------
+
+static void BM_ScalingDatabaseQuery(benchmark::State &state)
+{
+  if(!corpusOk(state)) return;
+
+  const int entries = state.range(0);
+
+  // the database lives only while its size is benchmarked
+  SemanticOrbDatabase db(corpusVocabulary(), false, 0);
+  std::vector<FSORB::TDescriptor> features;
+  for(int i = 0; i < entries; ++i)
+  {
+    Corpus::instance().get(i, features);
+    db.add(features);
+  }
+
+  // query with the frames that revisit a place
+  std::vector<size_t> revisits = Corpus::instance().revisits(entries);
+  if(revisits.empty())
+  {
+    state.SkipWithError("The corpus has no revisits");
+    return;
+  }
+  if(revisits.size() > 64) revisits.resize(64);
+
+  std::vector<std::vector<FSORB::TDescriptor> > queries(revisits.size());
+  for(size_t i = 0; i < queries.size(); ++i)
+    Corpus::instance().get(revisits[i], queries[i]);
+
+  QueryResults ret;
+  size_t i = 0;
+  for(auto _ : state)
+  {
+    db.query(queries[i], ret, 10);
+    benchmark::DoNotOptimize(ret);
+    if(++i == queries.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_ScalingDatabaseQuery)->Apply(Sizes)
+  ->Unit(benchmark::kMillisecond);
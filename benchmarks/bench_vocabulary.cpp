@@ -0,0 +1,162 @@
+/**
+ * File: bench_vocabulary.cpp
+ * Date: October 2026
+ * Description: benchmarks of vocabulary transforms and scoring objects
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "Synthetic.h"
+
+using namespace DBoW2;
+
+// ---------------------------------------------------------------------------
+
+static void BM_TransformFeature(benchmark::State &state)
+{
+  const OrbVocabulary &voc = Synthetic::orbVocabulary();
+  const std::vector<cv::Mat> features = Synthetic::images<cv::Mat>(1,
+    Synthetic::genOrb, Synthetic::TRAINING_IMAGES)[0];
+
+  size_t i = 0;
+  for(auto _ : state)
+  {
+    benchmark::DoNotOptimize(voc.transform(features[i]));
+    if(++i == features.size()) i = 0;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_TransformFeature);
+
+// ---------------------------------------------------------------------------
+
+static void BM_TransformImage(benchmark::State &state)
+{
+  const OrbVocabulary &voc = Synthetic::orbVocabulary();
+  const std::vector<cv::Mat> features = Synthetic::images<cv::Mat>(1,
+    Synthetic::genOrb, Synthetic::TRAINING_IMAGES, state.range(0))[0];
+
+  BowVector v;
+  for(auto _ : state)
+  {
+    voc.transform(features, v);
+    benchmark::DoNotOptimize(v);
+  }
+  state.SetItemsProcessed(state.iterations() * features.size());
+}
+
+BENCHMARK(BM_TransformImage)->Arg(300)->Arg(1000)->Arg(2000);
+
+// ---------------------------------------------------------------------------
+
+static void BM_TransformImageDirect(benchmark::State &state)
+{
+  const OrbVocabulary &voc = Synthetic::orbVocabulary();
+  const std::vector<cv::Mat> features = Synthetic::images<cv::Mat>(1,
+    Synthetic::genOrb, Synthetic::TRAINING_IMAGES, state.range(0))[0];
+
+  BowVector v;
+  FeatureVector fv;
+  for(auto _ : state)
+  {
+    voc.transform(features, v, fv, 2);
+    benchmark::DoNotOptimize(fv);
+  }
+  state.SetItemsProcessed(state.iterations() * features.size());
+}
+
+BENCHMARK(BM_TransformImageDirect)->Arg(300)->Arg(1000)->Arg(2000);
+
+// ---------------------------------------------------------------------------
+
+static void BM_TransformImageContext(benchmark::State &state)
+{
+  const OrbVocabulary &voc = Synthetic::orbVocabulary();
+  const std::vector<cv::Mat> features = Synthetic::images<cv::Mat>(1,
+    Synthetic::genOrb, Synthetic::TRAINING_IMAGES, state.range(0))[0];
+
+  TransformContext ctx(features.size());
+  for(auto _ : state)
+  {
+    voc.transform(features, ctx, 2);
+    benchmark::DoNotOptimize(ctx.features().data());
+  }
+  state.SetItemsProcessed(state.iterations() * features.size());
+}
+
+BENCHMARK(BM_TransformImageContext)->Arg(300)->Arg(1000)->Arg(2000);
+
+// ---------------------------------------------------------------------------
+
+static void BM_TransformImageBlock(benchmark::State &state)
+{
+  const OrbVocabulary &voc = Synthetic::orbVocabulary();
+  const std::vector<cv::Mat> features = Synthetic::images<cv::Mat>(1,
+    Synthetic::genOrb, Synthetic::TRAINING_IMAGES, state.range(0))[0];
+
+  // the N x 32 matrix a feature detector returns
+  cv::Mat descriptors;
+  FORB::toMat8U(features, descriptors);
+
+  BowVector v;
+  FeatureVector fv;
+  for(auto _ : state)
+  {
+    voc.transform(descriptors, v, fv, 2);
+    benchmark::DoNotOptimize(fv);
+  }
+  state.SetItemsProcessed(state.iterations() * features.size());
+}
+
+BENCHMARK(BM_TransformImageBlock)->Arg(300)->Arg(1000)->Arg(2000);
+
+// ---------------------------------------------------------------------------
+
+static void BM_TransformSurfImage(benchmark::State &state)
+{
+  SurfVocabulary voc = Synthetic::surfVocabulary();
+  voc.setNodePrecision((NodePrecision)state.range(0));
+
+  const std::vector<FSurf64::TDescriptor> features =
+    Synthetic::images<FSurf64::TDescriptor>(1, Synthetic::genSurf,
+      Synthetic::TRAINING_IMAGES)[0];
+
+  BowVector v;
+  for(auto _ : state)
+  {
+    voc.transform(features, v);
+    benchmark::DoNotOptimize(v);
+  }
+  state.SetItemsProcessed(state.iterations() * features.size());
+}
+
+BENCHMARK(BM_TransformSurfImage)->DenseRange(FULL_PRECISION, INT8_PRECISION)
+  ->ArgName("precision");
+
+// ---------------------------------------------------------------------------
+
+static void BM_Score(benchmark::State &state)
+{
+  OrbVocabulary voc = Synthetic::orbVocabulary();
+  voc.setScoringType((ScoringType)state.range(0));
+
+  const std::vector<std::vector<cv::Mat> > imgs = Synthetic::images<cv::Mat>(
+    2, Synthetic::genOrb, Synthetic::TRAINING_IMAGES);
+
+  BowVector a, b;
+  voc.transform(imgs[0], a);
+  voc.transform(imgs[1], b);
+
+  for(auto _ : state)
+  {
+    benchmark::DoNotOptimize(voc.score(a, b));
+  }
+}
+
+BENCHMARK(BM_Score)->DenseRange(L1_NORM, DOT_PRODUCT)
+  ->ArgName("scoring");
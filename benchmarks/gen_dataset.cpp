@@ -0,0 +1,120 @@
+/**
+ * File: gen_dataset.cpp
+ * Date: October 2026
+ * Description: writes a synthetic descriptor corpus to a binary file
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "SyntheticDataset.h"
+
+using namespace std;
+
+// ----------------------------------------------------------------------------
+
+static void usage(const char *program)
+{
+  const Synthetic::DatasetParams d;
+  cerr << "Usage: " << program << " [options] -o <file>" << endl
+    << "  --frames N            frames to generate (" << d.frames << ")" << endl
+    << "  --features N          features per frame (" << d.features << ")"
+    << endl
+    << "  --clusters N          cluster centers (" << d.clusters << ")" << endl
+    << "  --spread N            bits flipped per landmark ("
+    << d.cluster_spread << ")" << endl
+    << "  --noise N             bits flipped per observation ("
+    << d.observation_noise << ")" << endl
+    << "  --landmarks N         landmarks per place ("
+    << d.landmarks_per_place << ")" << endl
+    << "  --frames-per-place N  frames of each visit (" << d.frames_per_place
+    << ")" << endl
+    << "  --coherence F         tracked fraction between frames ("
+    << d.coherence << ")" << endl
+    << "  --revisit F           probability of revisiting a place ("
+    << d.revisit_probability << ")" << endl
+    << "  --classes N           semantic classes, 0 for plain ORB ("
+    << d.classes << ")" << endl
+    << "  --class-skew F        Zipf exponent of classes (" << d.class_skew
+    << ")" << endl
+    << "  --unlabelled F        fraction of features without class ("
+    << d.unlabelled << ")" << endl
+    << "  --seed N              random seed (" << d.seed << ")" << endl;
+}
+
+// ----------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+  Synthetic::DatasetParams params;
+  string filename;
+
+  for(int i = 1; i < argc; ++i)
+  {
+    const string arg = argv[i];
+    if(i + 1 >= argc)
+    {
+      usage(argv[0]);
+      return 1;
+    }
+    const char *value = argv[++i];
+
+    if(arg == "-o") filename = value;
+    else if(arg == "--frames") params.frames = atoi(value);
+    else if(arg == "--features") params.features = atoi(value);
+    else if(arg == "--clusters") params.clusters = atoi(value);
+    else if(arg == "--spread") params.cluster_spread = atoi(value);
+    else if(arg == "--noise") params.observation_noise = atoi(value);
+    else if(arg == "--landmarks") params.landmarks_per_place = atoi(value);
+    else if(arg == "--frames-per-place") params.frames_per_place = atoi(value);
+    else if(arg == "--coherence") params.coherence = atof(value);
+    else if(arg == "--revisit") params.revisit_probability = atof(value);
+    else if(arg == "--classes") params.classes = atoi(value);
+    else if(arg == "--class-skew") params.class_skew = atof(value);
+    else if(arg == "--unlabelled") params.unlabelled = atof(value);
+    else if(arg == "--seed") params.seed = atoi(value);
+    else
+    {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if(filename.empty() || params.clusters == 0 ||
+    params.landmarks_per_place == 0 || params.frames_per_place == 0)
+  {
+    usage(argv[0]);
+    return 1;
+  }
+  params.semantic = (params.classes > 0);
+
+  Synthetic::DatasetFile file;
+  if(!file.create(filename, params))
+  {
+    cerr << "Could not create " << filename << endl;
+    return 1;
+  }
+
+  Synthetic::DatasetGenerator generator(params);
+  Synthetic::Frame frame;
+  unsigned int revisits = 0;
+
+  while(generator.next(frame))
+  {
+    if(!file.write(frame))
+    {
+      cerr << "Could not write " << filename << endl;
+      return 1;
+    }
+    if(frame.revisit_of >= 0) ++revisits;
+  }
+
+  cout << "Wrote " << params.frames << " frames of " << params.features
+    << " features (" << revisits << " revisiting frames) to " << filename
+    << endl;
+  return 0;
+}
@@ -0,0 +1,274 @@
+/**
+ * File: Allocators.h
+ * Date: October 2026
+ * Description: arena and pool allocators for vocabulary and database
+ *   containers
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_ALLOCATORS__
+#define __D_T_ALLOCATORS__
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace DBoW2 {
+
+/// Where vocabularies and databases allocate their containers
+enum AllocationPolicy
+{
+  /// Global allocator, one allocation per element
+  HEAP_ALLOCATION,
+  /// Allocations batched in large blocks that are released together: a
+  /// monotonic arena for the vocabulary tree and pooled slabs for the
+  /// database postings
+  ARENA_ALLOCATION
+};
+
+/// Monotonic arena: allocations are carved out of large blocks and only
+/// released all at once
+class MonotonicArena
+{
+public:
+
+  /**
+   * Creates an empty arena
+   * @param block_size bytes of each block
+   */
+  explicit MonotonicArena(size_t block_size = 65536);
+
+  /**
+   * Releases all the memory
+   */
+  ~MonotonicArena();
+
+  /**
+   * Allocates memory from the current block
+   * @param bytes
+   * @param alignment power of two
+   * @return pointer to the memory, valid until release()
+   */
+  void* allocate(size_t bytes, size_t alignment);
+
+  /**
+   * Releases all the blocks
+   */
+  void release();
+
+  /**
+   * Returns the bytes of the blocks allocated
+   */
+  inline size_t capacity() const { return m_capacity; }
+
+private:
+
+  MonotonicArena(const MonotonicArena &);
+  MonotonicArena& operator=(const MonotonicArena &);
+
+  std::vector<char*> m_blocks;
+  size_t m_block_size;
+  size_t m_capacity;
+  char *m_current;
+  char *m_end;
+};
+
+/// Pool of fixed-size blocks allocated in slabs
+/**
+ * Freed blocks are kept in a free list and reused. The slabs are only
+ * returned to the system by purge(), when no block is in use.
+ */
+class SlabPool
+{
+public:
+
+  /**
+   * Creates an empty pool
+   * @param block_size bytes of each block
+   * @param blocks_per_slab number of blocks allocated at once
+   */
+  explicit SlabPool(size_t block_size, size_t blocks_per_slab = 4096);
+
+  /**
+   * Releases all the slabs
+   */
+  ~SlabPool();
+
+  /**
+   * Returns a free block
+   * @return pointer to block_size bytes
+   */
+  void* allocate();
+
+  /**
+   * Returns a block to the pool
+   * @param p block obtained with allocate()
+   */
+  void deallocate(void *p);
+
+  /**
+   * Returns the slabs to the system if no block is in use
+   * @return true iff the slabs were released
+   */
+  bool purge();
+
+  /**
+   * Returns the size of the blocks
+   */
+  inline size_t blockSize() const { return m_block_size; }
+
+  /**
+   * Returns the number of blocks in use
+   */
+  inline size_t used() const { return m_used; }
+
+  /**
+   * Returns the bytes of the slabs allocated
+   */
+  inline size_t capacity() const
+  {
+    return m_slabs.size() * m_block_size * m_blocks_per_slab;
+  }
+
+private:
+
+  SlabPool(const SlabPool &);
+  SlabPool& operator=(const SlabPool &);
+
+  /// Free block
+  struct FreeBlock
+  {
+    FreeBlock *next;
+  };
+
+  std::vector<char*> m_slabs;
+  size_t m_block_size;
+  size_t m_blocks_per_slab;
+  size_t m_used;
+  FreeBlock *m_free;
+  char *m_current;
+  char *m_end;
+};
+
+/// Allocator that takes its memory from a MonotonicArena, or from the
+/// global allocator if it has no arena
+/**
+ * Containers copied from one using an arena use the global allocator, so
+ * that the copies do not depend on the lifetime of the arena.
+ */
+template<class T>
+class ArenaAllocator
+{
+public:
+  typedef T value_type;
+
+  typedef std::false_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  ArenaAllocator(MonotonicArena *arena = NULL): m_arena(arena){}
+
+  template<class U>
+  ArenaAllocator(const ArenaAllocator<U> &a): m_arena(a.arena()){}
+
+  inline T* allocate(size_t n)
+  {
+    if(m_arena)
+      return static_cast<T*>(m_arena->allocate(n * sizeof(T),
+        std::alignment_of<T>::value));
+    else
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  inline void deallocate(T *p, size_t)
+  {
+    if(!m_arena) ::operator delete(p);
+  }
+
+  inline ArenaAllocator select_on_container_copy_construction() const
+  {
+    return ArenaAllocator();
+  }
+
+  inline MonotonicArena* arena() const { return m_arena; }
+
+private:
+  MonotonicArena *m_arena;
+};
+
+template<class T, class U>
+inline bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+  return a.arena() == b.arena();
+}
+
+template<class T, class U>
+inline bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+  return a.arena() != b.arena();
+}
+
+/// Allocator that takes single elements from a SlabPool, or from the
+/// global allocator if it has no pool or they do not fit in its blocks
+/**
+ * Meant for node-based containers (std::list, std::map). Copies of the
+ * containers share the pool, which must outlive them.
+ */
+template<class T>
+class PoolAllocator
+{
+public:
+  typedef T value_type;
+
+  PoolAllocator(SlabPool *pool = NULL): m_pool(pool){}
+
+  template<class U>
+  PoolAllocator(const PoolAllocator<U> &a): m_pool(a.pool()){}
+
+  inline T* allocate(size_t n)
+  {
+    if(pooled(n))
+      return static_cast<T*>(m_pool->allocate());
+    else
+      return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  inline void deallocate(T *p, size_t n)
+  {
+    if(pooled(n))
+      m_pool->deallocate(p);
+    else
+      ::operator delete(p);
+  }
+
+  inline SlabPool* pool() const { return m_pool; }
+
+private:
+
+  /// Tells whether n elements are taken from the pool
+  inline bool pooled(size_t n) const
+  {
+    return m_pool && n == 1 && sizeof(T) <= m_pool->blockSize() &&
+      std::alignment_of<T>::value <= sizeof(void*) * 2;
+  }
+
+  SlabPool *m_pool;
+};
+
+template<class T, class U>
+inline bool operator==(const PoolAllocator<T> &a, const PoolAllocator<U> &b)
+{
+  return a.pool() == b.pool();
+}
+
+template<class T, class U>
+inline bool operator!=(const PoolAllocator<T> &a, const PoolAllocator<U> &b)
+{
+  return a.pool() != b.pool();
+}
+
+} // namespace DBoW2
+
+#endif
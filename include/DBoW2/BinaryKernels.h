@@ -0,0 +1,67 @@
+/**
+ * File: BinaryKernels.h
+ * Date: October 2026
+ * Description: vectorized kernels for binary descriptors
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_BINARY_KERNELS__
+#define __D_T_BINARY_KERNELS__
+
+#include <stdint.h>
+
+namespace DBoW2 {
+
+/// Hamming distance and majority kernels for binary descriptors
+/**
+ * The kernels use the AVX-512 population count, AVX2 or the POPCNT
+ * instruction when the processor supports them, and portable code
+ * otherwise. The instruction set is chosen once, at the first call.
+ * Pointers need not be aligned.
+ */
+class BinaryKernels
+{
+public:
+
+  /**
+   * Returns the number of different bits of two bit strings
+   * @param a
+   * @param b
+   * @param n number of 64-bit words
+   * @return hamming distance
+   */
+  static int distance(const uint64_t *a, const uint64_t *b, int n);
+
+  /**
+   * Returns the number of bits set in a bit string
+   * @param a
+   * @param n number of 64-bit words
+   * @return population count
+   */
+  static int count(const uint64_t *a, int n);
+
+  /**
+   * Sets the bits that are set in at least a given number of bit strings,
+   * which is the mean of binary descriptors. The bits are counted in
+   * bit-sliced counters, so the kernel does the same work for every bit
+   * of a word and does not depend on the order of the bits in the bytes
+   * @param strings n pointers to bit strings
+   * @param n number of strings
+   * @param bytes length of each string, in bytes
+   * @param threshold number of strings in which a bit must be set
+   * @param mean (out) bit string of the given length
+   */
+  static void majority(const unsigned char *const *strings, int n,
+    int bytes, int threshold, unsigned char *mean);
+
+  /**
+   * Returns the name of the instruction set the kernels use
+   * @return "AVX-512", "AVX2", "POPCNT" or "scalar"
+   */
+  static const char* instructionSet();
+};
+
+} // namespace DBoW2
+
+#endif
@@ -0,0 +1,252 @@
+/**
+ * File: Bundle.h
+ * Date: October 2026
+ * Description: single-file bundle of a vocabulary, its semantic classes and
+ *   a database, read through a memory map
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_BUNDLE__
+#define __D_T_BUNDLE__
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <stdint.h>
+
+namespace DBoW2 {
+
+/// Data of a bundle section, read in order with bounds checks
+/**
+ * The section does not own the data, which belongs to the Bundle it was
+ * obtained from and is only valid while it is open. Values are stored in
+ * the byte order of the machine that wrote the bundle (little-endian on the
+ * supported platforms).
+ */
+class BundleSection
+{
+public:
+
+  /**
+   * Creates a section over the given bytes
+   * @param data
+   * @param size bytes
+   */
+  BundleSection(const void *data = NULL, size_t size = 0)
+    : m_data(static_cast<const unsigned char*>(data)), m_size(size),
+      m_pos(0)
+  {
+  }
+
+  /**
+   * Returns the next n bytes and skips them
+   * @param n
+   * @return pointer to n bytes
+   * @throw std::string if the section has fewer bytes left
+   */
+  inline const unsigned char* skip(size_t n)
+  {
+    if(n > m_size - m_pos) throw std::string("Truncated bundle section");
+    const unsigned char *p = m_data + m_pos;
+    m_pos += n;
+    return p;
+  }
+
+  /**
+   * Reads the next value
+   * @return value
+   * @throw std::string if the section has no bytes left for it
+   */
+  template<class T>
+  inline T read()
+  {
+    T value;
+    std::memcpy(&value, skip(sizeof(T)), sizeof(T));
+    return value;
+  }
+
+  /**
+   * Returns the bytes left
+   */
+  inline size_t remaining() const { return m_size - m_pos; }
+
+  /**
+   * Returns the size of the section
+   */
+  inline size_t size() const { return m_size; }
+
+  /**
+   * Writes a value as read() reads it
+   * @param out stream
+   * @param value
+   */
+  template<class T>
+  static inline void write(std::ostream &out, const T &value)
+  {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+protected:
+
+  /// Bytes of the section
+  const unsigned char *m_data;
+  /// Size of the section
+  size_t m_size;
+  /// Bytes already read
+  size_t m_pos;
+};
+
+/// Single file holding named binary sections, mapped into memory at once
+/**
+ * A bundle starts with a table of contents, so opening it costs one open
+ * and one mmap. The sections are only paged in when they are read, and the
+ * absent ones cost nothing. Reading is not deferred further:
+ * TemplatedDatabase::loadBundle parses every section it uses when called. The library writes the VOCABULARY, CLASSES and
+ * DATABASE sections (see TemplatedDatabase::saveBundle); other sections can
+ * be added with BundleWriter.
+ *
+ * Format: a 32-byte header (magic "DBoW2BDL", version, number of sections,
+ * file size), a 32-byte entry per section (name of up to 15 characters,
+ * offset and size), and the sections, aligned to 64 bytes.
+ */
+class Bundle
+{
+public:
+
+  /// Name of the section of the vocabulary
+  static const char* const VOCABULARY;
+  /// Name of the section of the semantic classes
+  static const char* const CLASSES;
+  /// Name of the section of the database entries
+  static const char* const DATABASE;
+
+  /**
+   * Creates a closed bundle
+   */
+  Bundle();
+
+  /**
+   * Opens a bundle file
+   * @param filename
+   * @throw std::string if the file cannot be read or is not a bundle
+   */
+  explicit Bundle(const std::string &filename);
+
+  /**
+   * Unmaps the file
+   */
+  ~Bundle();
+
+  /**
+   * Maps a bundle file and reads its table of contents
+   * @param filename
+   * @throw std::string if the file cannot be read or is not a bundle
+   */
+  void open(const std::string &filename);
+
+  /**
+   * Unmaps the file. The sections obtained from the bundle are no longer
+   * valid
+   */
+  void close();
+
+  /**
+   * Returns whether a file is open
+   */
+  inline bool isOpen() const { return m_data != NULL; }
+
+  /**
+   * Returns whether the bundle has a section
+   * @param name
+   */
+  bool has(const std::string &name) const;
+
+  /**
+   * Returns a section
+   * @param name
+   * @return section
+   * @throw std::string if the bundle has no such section
+   */
+  BundleSection section(const std::string &name) const;
+
+  /**
+   * Returns the names of the sections, in file order
+   */
+  std::vector<std::string> names() const;
+
+  /**
+   * Returns the size of the file
+   */
+  inline size_t bytes() const { return m_size; }
+
+protected:
+
+  /// Entry of the table of contents
+  struct Entry
+  {
+    /// Section name
+    std::string name;
+    /// Offset of the section in the file
+    uint64_t offset;
+    /// Size of the section
+    uint64_t size;
+  };
+
+  /**
+   * Reads the table of contents of the mapped file
+   * @param filename for error messages
+   */
+  void readContents(const std::string &filename);
+
+private:
+
+  Bundle(const Bundle &);
+  Bundle& operator=(const Bundle &);
+
+protected:
+
+  /// File contents
+  const unsigned char *m_data;
+  /// File size
+  size_t m_size;
+  /// Whether m_data is a memory map (or a copy in m_buffer otherwise)
+  bool m_mapped;
+  /// Copy of the file where memory maps are not available
+  std::vector<unsigned char> m_buffer;
+  /// Table of contents
+  std::vector<Entry> m_contents;
+};
+
+/// Writes a bundle file
+class BundleWriter
+{
+public:
+
+  /**
+   * Adds a section, replacing the section with the same name if any
+   * @param name up to 15 characters
+   * @param data contents
+   * @throw std::string if the name is empty or too long
+   */
+  void add(const std::string &name, const std::string &data);
+
+  /**
+   * Writes the bundle with the sections added so far
+   * @param filename
+   * @throw std::string if the file cannot be written
+   */
+  void write(const std::string &filename) const;
+
+protected:
+
+  /// Sections in order
+  std::vector<std::pair<std::string, std::string> > m_sections;
+};
+
+} // namespace DBoW2
+
+#endif
@@ -57,6 +57,8 @@ namespace DBoW2
 #include "FBrief.h"
 #include "FORB.h"
 #include "FSORB.h"
+#include "FSurf64.h"
+#include "FFloat.h"
 
 /// ORB Vocabulary
 typedef DBoW2::TemplatedVocabulary<DBoW2::FORB::TDescriptor, DBoW2::FORB>
@@ -82,5 +84,21 @@ typedef DBoW2::TemplatedVocabulary<DBoW2::FBrief::TDescriptor, DBoW2::FBrief>
 typedef DBoW2::TemplatedDatabase<DBoW2::FBrief::TDescriptor, DBoW2::FBrief>
   BriefDatabase;
 
+/// SURF64 Vocabulary
+typedef DBoW2::TemplatedVocabulary<DBoW2::FSurf64::TDescriptor, DBoW2::FSurf64>
+  SurfVocabulary;
+
+/// SURF64 Database
+typedef DBoW2::TemplatedDatabase<DBoW2::FSurf64::TDescriptor, DBoW2::FSurf64>
+  SurfDatabase;
+
+/// 128-dimensional float descriptor (SIFT, learned) Vocabulary
+typedef DBoW2::TemplatedVocabulary<DBoW2::FFloat128::TDescriptor,
+  DBoW2::FFloat128> Float128Vocabulary;
+
+/// 128-dimensional float descriptor Database
+typedef DBoW2::TemplatedDatabase<DBoW2::FFloat128::TDescriptor,
+  DBoW2::FFloat128> Float128Database;
+
 #endif
 
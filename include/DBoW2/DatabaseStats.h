@@ -0,0 +1,91 @@
+/**
+ * File: DatabaseStats.h
+ * Date: October 2026
+ * Description: memory usage and posting list statistics of a database
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_DATABASE_STATS__
+#define __D_T_DATABASE_STATS__
+
+#include <cstddef>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "BowVector.h"
+#include "QueryProfile.h"
+
+namespace DBoW2 {
+
+/// Memory used by a database and length of its posting lists
+/**
+ * Sizes are estimates of the heap memory of the containers: element sizes
+ * plus the pointers of list and tree nodes, without allocator headers.
+ * The vocabulary is not included.
+ */
+struct DatabaseStats
+{
+  /// Bytes of the inverted file: rows and postings, without their semantic
+  /// fields
+  size_t inverted_file;
+  /// Bytes of the direct file
+  size_t direct_file;
+  /// Bytes of the semantic data: class of the postings and class table
+  size_t semantic;
+  /// Bytes of the database object and unused capacity of its vectors
+  size_t overhead;
+
+  /// Number of postings (entry-word pairs) in the inverted file
+  unsigned long postings;
+  /// Length of the posting lists of the words
+  Histogram posting_lengths;
+  /// Words with the longest posting lists, and their length, longest first
+  std::vector<std::pair<WordId, unsigned long> > heaviest_words;
+
+  /// Features added since the database was cleared that were not indexed
+  /// because the weight of their class is 0 (e.g. dynamic objects). Saved
+  /// and loaded with the database
+  unsigned long dropped_features;
+  /// Features added since the database was cleared that were indexed with
+  /// a class weight below 1. Saved and loaded with the database
+  unsigned long weighted_features;
+  /// Class ids of the dropped features and how many were dropped, most
+  /// dropped first
+  std::vector<std::pair<int, unsigned long> > dropped_classes;
+
+  DatabaseStats(): inverted_file(0), direct_file(0), semantic(0),
+    overhead(0), postings(0), dropped_features(0), weighted_features(0){}
+
+  /**
+   * Returns the total number of bytes
+   */
+  inline size_t total() const
+  {
+    return inverted_file + direct_file + semantic + overhead;
+  }
+
+  /**
+   * Keeps the n longest posting lists of the given lengths
+   * @param lengths length of the posting list of each word
+   * @param n number of words to keep
+   */
+  void findHeaviestWords(const std::vector<unsigned long> &lengths, size_t n);
+
+  /**
+   * Sorts dropped_classes, most dropped first
+   */
+  void sortDroppedClasses();
+};
+
+/**
+ * Writes a report of the statistics
+ * @param os stream to write to
+ * @param stats
+ */
+std::ostream& operator<<(std::ostream &os, const DatabaseStats &stats);
+
+} // namespace DBoW2
+
+#endif
@@ -0,0 +1,89 @@
+/**
+ * File: DescriptorTraits.h
+ * Date: October 2026
+ * Description: compile-time properties of descriptor classes
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_DESCRIPTOR_TRAITS__
+#define __D_T_DESCRIPTOR_TRAITS__
+
+#include <cstddef>
+
+namespace DBoW2 {
+
+/// Values of the properties of a descriptor class (see DescriptorTraits)
+template<int Bits, bool Binary, bool Semantic, size_t Alignment,
+  bool BatchDistance>
+struct DescriptorTraitsBase
+{
+  /// Length of a descriptor in bits, 0 if unknown
+  static const int bits = Bits;
+
+  /// Length of a descriptor in bytes, 0 if unknown
+  static const int bytes = Bits / 8;
+
+  /// Whether descriptors are bit strings compared with the hamming distance
+  static const bool is_binary = Binary;
+
+  /// Whether descriptors are pairs <descriptor, semantic class>
+  static const bool is_semantic = Semantic;
+
+  /// Alignment in bytes guaranteed for the elements of a descriptor
+  static const size_t alignment = Alignment;
+
+  /// Whether F offers distance(const unsigned char *, const TDescriptor &)
+  /// and hash(const unsigned char *), which compare the rows of an N x bytes
+  /// CV_8U matrix without converting them into descriptors
+  static const bool has_batch_distance = BatchDistance;
+};
+
+template<int Bits, bool Binary, bool Semantic, size_t Alignment,
+  bool BatchDistance>
+const int DescriptorTraitsBase<Bits, Binary, Semantic, Alignment,
+  BatchDistance>::bits;
+
+template<int Bits, bool Binary, bool Semantic, size_t Alignment,
+  bool BatchDistance>
+const int DescriptorTraitsBase<Bits, Binary, Semantic, Alignment,
+  BatchDistance>::bytes;
+
+template<int Bits, bool Binary, bool Semantic, size_t Alignment,
+  bool BatchDistance>
+const bool DescriptorTraitsBase<Bits, Binary, Semantic, Alignment,
+  BatchDistance>::is_binary;
+
+template<int Bits, bool Binary, bool Semantic, size_t Alignment,
+  bool BatchDistance>
+const bool DescriptorTraitsBase<Bits, Binary, Semantic, Alignment,
+  BatchDistance>::is_semantic;
+
+template<int Bits, bool Binary, bool Semantic, size_t Alignment,
+  bool BatchDistance>
+const size_t DescriptorTraitsBase<Bits, Binary, Semantic, Alignment,
+  BatchDistance>::alignment;
+
+template<int Bits, bool Binary, bool Semantic, size_t Alignment,
+  bool BatchDistance>
+const bool DescriptorTraitsBase<Bits, Binary, Semantic, Alignment,
+  BatchDistance>::has_batch_distance;
+
+// --------------------------------------------------------------------------
+
+/// Properties of the descriptors handled by a class F, known at compile time
+/**
+ * The vocabulary and the database choose their code paths with them instead
+ * of asking F at run time. Descriptor classes specialize DescriptorTraits
+ * next to their definition (see FORB, FSORB, FBrief, FFloat); the defaults
+ * describe a class the library knows nothing about, which gets the generic
+ * code paths.
+ */
+template<class F>
+struct DescriptorTraits: public DescriptorTraitsBase<0, false, false, 1, false>
+{
+};
+
+} // namespace DBoW2
+
+#endif
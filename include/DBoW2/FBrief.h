@@ -14,18 +14,174 @@
 #include <bitset>
 #include <vector>
 #include <string>
+#include <stdint.h>
 
 #include "FClass.h"
+#include "BinaryKernels.h"
+#include "DescriptorTraits.h"
 
 namespace DBoW2 {
 
+/// BRIEF descriptor of 256 bits stored in 64-bit words
+/**
+ * Bit i is bit i % 64 of word i / 64. The class offers the members of
+ * std::bitset<256> that are used with descriptors, and converts from and to
+ * it, so that code written for the former bitset descriptors still compiles.
+ */
+class alignas(16) BriefDescriptor
+{
+public:
+
+  /// Number of bits
+  static const int L = 256;
+  /// Number of 64-bit words
+  static const int WORDS = L / 64;
+
+  /**
+   * Creates a descriptor with all the bits unset
+   */
+  BriefDescriptor()
+  {
+    reset();
+  }
+
+  /**
+   * Creates a descriptor from a bitset
+   * @param b
+   */
+  BriefDescriptor(const std::bitset<L> &b);
+
+  /**
+   * Returns the descriptor as a bitset
+   */
+  std::bitset<L> to_bitset() const;
+
+  inline bool operator[](size_t i) const { return test(i); }
+
+  inline bool test(size_t i) const
+  {
+    return (m_words[i >> 6] >> (i & 63)) & 1;
+  }
+
+  inline BriefDescriptor& set()
+  {
+    for(int i = 0; i < WORDS; ++i) m_words[i] = ~(uint64_t)0;
+    return *this;
+  }
+
+  inline BriefDescriptor& set(size_t i, bool value = true)
+  {
+    const uint64_t bit = (uint64_t)1 << (i & 63);
+    if(value) m_words[i >> 6] |= bit;
+    else m_words[i >> 6] &= ~bit;
+    return *this;
+  }
+
+  inline BriefDescriptor& reset()
+  {
+    for(int i = 0; i < WORDS; ++i) m_words[i] = 0;
+    return *this;
+  }
+
+  inline BriefDescriptor& reset(size_t i) { return set(i, false); }
+
+  inline BriefDescriptor& flip(size_t i)
+  {
+    m_words[i >> 6] ^= (uint64_t)1 << (i & 63);
+    return *this;
+  }
+
+  /**
+   * Returns the number of bits set
+   */
+  inline size_t count() const
+  {
+    return BinaryKernels::count(m_words, WORDS);
+  }
+
+  inline size_t size() const { return L; }
+
+  inline bool any() const
+  {
+    return (m_words[0] | m_words[1] | m_words[2] | m_words[3]) != 0;
+  }
+
+  inline bool none() const { return !any(); }
+
+  inline BriefDescriptor& operator^=(const BriefDescriptor &b)
+  {
+    for(int i = 0; i < WORDS; ++i) m_words[i] ^= b.m_words[i];
+    return *this;
+  }
+
+  inline BriefDescriptor& operator&=(const BriefDescriptor &b)
+  {
+    for(int i = 0; i < WORDS; ++i) m_words[i] &= b.m_words[i];
+    return *this;
+  }
+
+  inline BriefDescriptor& operator|=(const BriefDescriptor &b)
+  {
+    for(int i = 0; i < WORDS; ++i) m_words[i] |= b.m_words[i];
+    return *this;
+  }
+
+  inline bool operator==(const BriefDescriptor &b) const
+  {
+    return ((m_words[0] ^ b.m_words[0]) | (m_words[1] ^ b.m_words[1]) |
+      (m_words[2] ^ b.m_words[2]) | (m_words[3] ^ b.m_words[3])) == 0;
+  }
+
+  inline bool operator!=(const BriefDescriptor &b) const
+  {
+    return !(*this == b);
+  }
+
+  /**
+   * Returns the bits as a string of '0' and '1', from bit L-1 to bit 0,
+   * as std::bitset does
+   */
+  std::string to_string() const;
+
+  /**
+   * Returns the words of the descriptor
+   */
+  inline uint64_t* words() { return m_words; }
+  inline const uint64_t* words() const { return m_words; }
+
+private:
+
+  uint64_t m_words[WORDS];
+};
+
+inline BriefDescriptor operator^(BriefDescriptor a, const BriefDescriptor &b)
+{
+  return a ^= b;
+}
+
+inline BriefDescriptor operator&(BriefDescriptor a, const BriefDescriptor &b)
+{
+  return a &= b;
+}
+
+inline BriefDescriptor operator|(BriefDescriptor a, const BriefDescriptor &b)
+{
+  return a |= b;
+}
+
+/// Writes the descriptor as std::bitset does
+std::ostream& operator<<(std::ostream &os, const BriefDescriptor &a);
+
+/// Reads a descriptor written as std::bitset does
+std::istream& operator>>(std::istream &is, BriefDescriptor &a);
+
 /// Functions to manipulate BRIEF descriptors
 class FBrief: protected FClass
 {
 public:
 
   static const int L = 256; // Descriptor length (in bits)
-  typedef std::bitset<L> TDescriptor;
+  typedef BriefDescriptor TDescriptor;
   typedef const TDescriptor *pDescriptor;
 
   /**
@@ -42,21 +198,65 @@ public:
    * @param b
    * @return distance
    */
-  static double distance(const TDescriptor &a, const TDescriptor &b);
+  static inline double distance(const TDescriptor &a, const TDescriptor &b)
+  {
+    return (double)BinaryKernels::distance(a.words(), b.words(),
+      TDescriptor::WORDS);
+  }
+
+  /**
+   * Calculates the distance between a descriptor stored as a row of a
+   * descriptor matrix (see fromMat8U) and a descriptor
+   * @param a pointer to L / 8 bytes
+   * @param b
+   * @return distance
+   */
+  static double distance(const unsigned char *a, const TDescriptor &b);
+  
+  /**
+   * Returns a hash of the descriptor
+   * @param a descriptor
+   * @return 64-bit hash
+   */
+  static uint64_t hash(const TDescriptor &a);
+
+  /**
+   * Returns the same hash as hash(const TDescriptor&) for a descriptor
+   * stored as a row of a descriptor matrix
+   * @param a pointer to L / 8 bytes
+   * @return 64-bit hash
+   */
+  static uint64_t hash(const unsigned char *a);
   
   /**
-   * Returns a string version of the descriptor
+   * Returns a string version of the descriptor: L / 4 hex digits, from
+   * bit L-1 to bit 0
    * @param a descriptor
    * @return string version
    */
   static std::string toString(const TDescriptor &a);
   
   /**
-   * Returns a descriptor from a string
+   * Returns a descriptor from a string written by toString, or from the L
+   * binary digits of older versions (as std::bitset writes them)
    * @param a descriptor
    * @param s string version
    */
   static void fromString(TDescriptor &a, const std::string &s);
+
+  /**
+   * Writes the 32 bytes of a descriptor, as stored in binary vocabularies
+   * @param a descriptor
+   * @param p (out) 32 bytes
+   */
+  static void toBytes(const TDescriptor &a, unsigned char *p);
+
+  /**
+   * Reads a descriptor written by toBytes
+   * @param a (out) descriptor
+   * @param p 32 bytes
+   */
+  static void fromBytes(TDescriptor &a, const unsigned char *p);
   
   /**
    * Returns a mat with the descriptors in float format
@@ -66,6 +266,50 @@ public:
   static void toMat32F(const std::vector<TDescriptor> &descriptors, 
     cv::Mat &mat);
 
+  /**
+   * Returns the descriptors stored in the rows of a matrix in the layout of
+   * OpenCV binary descriptors: bit i of a descriptor is bit i % 8 of byte
+   * i / 8 of its row
+   * @param mat Nx32 8U matrix
+   * @param descriptors (out) N descriptors
+   */
+  static void fromMat8U(const cv::Mat &mat,
+    std::vector<TDescriptor> &descriptors);
+
+  /**
+   * Returns a matrix with the descriptors in the layout of OpenCV binary
+   * descriptors
+   * @param descriptors
+   * @param mat (out) Nx32 8U matrix
+   */
+  static void toMat8U(const std::vector<TDescriptor> &descriptors,
+    cv::Mat &mat);
+
+  /**
+   * Returns a descriptor from the blocks of a bit string in which bit i is
+   * bit i % B of block i / B, with B the bits of Block. This is the layout of
+   * boost::dynamic_bitset, whose blocks are obtained with
+   * boost::to_block_range
+   * @param blocks L / B blocks
+   * @param a (out) descriptor
+   */
+  template<class Block>
+  static void fromBlocks(const Block *blocks, TDescriptor &a)
+  {
+    const int B = sizeof(Block) * 8;
+    a.reset();
+    for(int i = 0; i < L / B; ++i)
+      a.words()[(i * B) / 64] |= (uint64_t)blocks[i] << ((i * B) % 64);
+  }
+
+};
+
+/// BRIEF descriptors are strings of 256 bits stored in aligned words, and
+/// can also be compared in the rows of a descriptor matrix (see fromMat8U)
+template<>
+struct DescriptorTraits<FBrief>:
+  public DescriptorTraitsBase<256, true, false, 16, true>
+{
 };
 
 } // namespace DBoW2
@@ -13,6 +13,7 @@
 #include <opencv2/core.hpp>
 #include <vector>
 #include <string>
+#include <stdint.h>
 
 namespace DBoW2 {
 
@@ -43,6 +44,14 @@ class FClass
    */
   static double distance(const TDescriptor &a, const TDescriptor &b);
 
+  /**
+   * Returns a hash of the descriptor. Descriptors at distance 0 must have
+   * the same hash
+   * @param a descriptor
+   * @return 64-bit hash
+   */
+  static uint64_t hash(const TDescriptor &a);
+
   /**
    * Returns a string version of the descriptor
    * @param a descriptor
@@ -57,6 +66,21 @@ class FClass
    */
   static void fromString(TDescriptor &a, const std::string &s);
 
+  /**
+   * Writes the DescriptorTraits<F>::bytes bytes of a descriptor, as stored
+   * in binary vocabularies
+   * @param a descriptor
+   * @param p (out) bytes
+   */
+  static void toBytes(const TDescriptor &a, unsigned char *p);
+
+  /**
+   * Reads a descriptor written by toBytes
+   * @param a (out) descriptor
+   * @param p bytes
+   */
+  static void fromBytes(TDescriptor &a, const unsigned char *p);
+
   /**
    * Returns a mat with the descriptors in float format
    * @param descriptors
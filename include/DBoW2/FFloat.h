@@ -0,0 +1,279 @@
+/**
+ * File: FFloat.h
+ * Date: October 2026
+ * Description: functions for float descriptors (SURF, SIFT, learned)
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_F_FLOAT__
+#define __D_T_F_FLOAT__
+
+#include <opencv2/core.hpp>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <stdint.h>
+
+#include "FClass.h"
+#include "DescriptorTraits.h"
+#include "FloatKernels.h"
+#include "QuantizationCache.h"
+#include "QuantizedCenters.h"
+
+namespace DBoW2 {
+
+/// Float descriptor of D dimensions, stored inline
+/**
+ * The elements are stored in the object itself, so vectors of descriptors
+ * and vocabulary nodes keep them in contiguous memory, without a heap block
+ * per descriptor. The storage is 16-byte aligned, the alignment the global
+ * allocator guarantees.
+ */
+template<int D>
+class alignas(16) FloatDescriptor
+{
+public:
+
+  /// Number of dimensions
+  static const int L = D;
+
+  /**
+   * Creates a zero descriptor
+   */
+  FloatDescriptor()
+  {
+    std::fill(m_data, m_data + D, 0.f);
+  }
+
+  /**
+   * Creates a descriptor from D floats
+   * @param p
+   */
+  explicit FloatDescriptor(const float *p)
+  {
+    std::copy(p, p + D, m_data);
+  }
+
+  /**
+   * Creates a descriptor from a vector of D floats
+   * @param v
+   */
+  explicit FloatDescriptor(const std::vector<float> &v)
+  {
+    std::copy(v.begin(), v.begin() + D, m_data);
+  }
+
+  inline float& operator[](int i) { return m_data[i]; }
+  inline const float& operator[](int i) const { return m_data[i]; }
+
+  inline float* data() { return m_data; }
+  inline const float* data() const { return m_data; }
+
+  /**
+   * Returns the number of dimensions
+   * @return D
+   */
+  inline int size() const { return D; }
+
+private:
+
+  float m_data[D];
+};
+
+/// Float descriptors expose their elements to reduce the precision of the
+/// vocabulary nodes
+template<int D>
+struct FloatView<FloatDescriptor<D> >
+{
+  static const int dimensions = D;
+
+  static inline const float* data(const FloatDescriptor<D> &d)
+  {
+    return d.data();
+  }
+};
+
+/// Functions to manipulate float descriptors of D dimensions
+/**
+ * Distances are squared euclidean distances. The distance and mean kernels
+ * are vectorized (see FloatKernels).
+ */
+template<int D>
+class FFloat: protected FClass
+{
+public:
+
+  /// Descriptor type
+  typedef FloatDescriptor<D> TDescriptor;
+  /// Pointer to a single descriptor
+  typedef const TDescriptor *pDescriptor;
+  /// Descriptor length
+  static const int L = D;
+
+  /**
+   * Returns the number of dimensions of the descriptor space
+   * @return dimensions
+   */
+  inline static int dimensions()
+  {
+    return L;
+  }
+
+  /**
+   * Calculates the mean value of a set of descriptors
+   * @param descriptors vector of pointers to descriptors
+   * @param mean mean descriptor
+   */
+  static void meanValue(const std::vector<pDescriptor> &descriptors,
+    TDescriptor &mean)
+  {
+    mean = TDescriptor();
+    if(descriptors.empty()) return;
+
+    typename std::vector<pDescriptor>::const_iterator it;
+    for(it = descriptors.begin(); it != descriptors.end(); ++it)
+      FloatKernels::accumulate(mean.data(), (*it)->data(), L);
+
+    FloatKernels::scale(mean.data(), 1.f / descriptors.size(), L);
+  }
+
+  /**
+   * Calculates the (squared) distance between two descriptors
+   * @param a
+   * @param b
+   * @return (squared) distance
+   */
+  static double distance(const TDescriptor &a, const TDescriptor &b)
+  {
+    return FloatKernels::squaredDistance(a.data(), b.data(), L);
+  }
+
+  /**
+   * Returns a hash of the descriptor
+   * @param a descriptor
+   * @return 64-bit hash
+   */
+  static uint64_t hash(const TDescriptor &a)
+  {
+    return QuantizationCache::hashBytes(a.data(), L * sizeof(float));
+  }
+
+  /**
+   * Returns a string version of the descriptor, in full precision
+   * @param a descriptor
+   * @return string version
+   */
+  static std::string toString(const TDescriptor &a)
+  {
+    std::stringstream ss;
+    ss.precision(std::numeric_limits<float>::max_digits10);
+    for(int i = 0; i < L; ++i)
+    {
+      ss << a[i] << " ";
+    }
+    return ss.str();
+  }
+
+  /**
+   * Returns a descriptor from a string
+   * @param a descriptor
+   * @param s string version
+   */
+  static void fromString(TDescriptor &a, const std::string &s)
+  {
+    std::stringstream ss(s);
+    for(int i = 0; i < L; ++i)
+    {
+      ss >> a[i];
+    }
+  }
+
+  /**
+   * Writes the L floats of a descriptor, as stored in binary vocabularies
+   * @param a descriptor
+   * @param p (out) L * 4 bytes
+   */
+  static void toBytes(const TDescriptor &a, unsigned char *p)
+  {
+    std::memcpy(p, a.data(), L * sizeof(float));
+  }
+
+  /**
+   * Reads a descriptor written by toBytes
+   * @param a (out) descriptor
+   * @param p L * 4 bytes
+   */
+  static void fromBytes(TDescriptor &a, const unsigned char *p)
+  {
+    std::memcpy(a.data(), p, L * sizeof(float));
+  }
+
+  /**
+   * Returns a mat with the descriptors in float format
+   * @param descriptors
+   * @param mat (out) NxL 32F matrix
+   */
+  static void toMat32F(const std::vector<TDescriptor> &descriptors,
+    cv::Mat &mat)
+  {
+    if(descriptors.empty())
+    {
+      mat.release();
+      return;
+    }
+
+    const int N = descriptors.size();
+    mat.create(N, L, CV_32F);
+
+    for(int i = 0; i < N; ++i)
+    {
+      const float *d = descriptors[i].data();
+      std::copy(d, d + L, mat.ptr<float>(i));
+    }
+  }
+
+  /**
+   * Returns the descriptors stored in the rows of a matrix, such as the one
+   * returned by a feature extractor
+   * @param mat NxL 32F matrix
+   * @param descriptors (out) N descriptors
+   */
+  static void fromMat32F(const cv::Mat &mat,
+    std::vector<TDescriptor> &descriptors)
+  {
+    descriptors.clear();
+    if(mat.empty()) return;
+
+    if(mat.type() != CV_32F || mat.cols != L)
+    {
+      std::stringstream ss;
+      ss << "Expected a descriptor matrix of " << L
+        << " CV_32F columns, got " << mat.cols << " columns of type "
+        << mat.type();
+      throw ss.str();
+    }
+
+    descriptors.reserve(mat.rows);
+    for(int i = 0; i < mat.rows; ++i)
+      descriptors.push_back(TDescriptor(mat.ptr<float>(i)));
+  }
+};
+
+/// Float descriptors of D dimensions, stored inline and aligned
+template<int D>
+struct DescriptorTraits<FFloat<D> >:
+  public DescriptorTraitsBase<32 * D, false, false, 16, false>
+{
+};
+
+/// Functions to manipulate 128-dimensional float descriptors (SIFT,
+/// extended SURF or learned descriptors)
+typedef FFloat<128> FFloat128;
+
+} // namespace DBoW2
+
+#endif
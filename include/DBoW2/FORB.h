@@ -13,8 +13,10 @@
 #include <opencv2/core.hpp>
 #include <vector>
 #include <string>
+#include <stdint.h>
 
 #include "FClass.h"
+#include "DescriptorTraits.h"
 
 namespace DBoW2 {
 
@@ -45,6 +47,29 @@ public:
    * @return distance
    */
   static double distance(const TDescriptor &a, const TDescriptor &b);
+
+  /**
+   * Calculates the distance between a descriptor given by its L bytes, such
+   * as a row of an NxL CV_8U matrix, and a descriptor
+   * @param a
+   * @param b
+   * @return distance
+   */
+  static double distance(const unsigned char *a, const TDescriptor &b);
+  
+  /**
+   * Returns a hash of the descriptor
+   * @param a descriptor
+   * @return 64-bit hash
+   */
+  static uint64_t hash(const TDescriptor &a);
+
+  /**
+   * Returns the hash of a descriptor given by its L bytes
+   * @param a
+   * @return 64-bit hash, equal to that of the descriptor
+   */
+  static uint64_t hash(const unsigned char *a);
   
   /**
    * Returns a string version of the descriptor
@@ -59,6 +84,20 @@ public:
    * @param s string version
    */
   static void fromString(TDescriptor &a, const std::string &s);
+
+  /**
+   * Writes the 32 bytes of a descriptor, as stored in binary vocabularies
+   * @param a descriptor
+   * @param p (out) 32 bytes
+   */
+  static void toBytes(const TDescriptor &a, unsigned char *p);
+
+  /**
+   * Reads a descriptor written by toBytes
+   * @param a (out) descriptor
+   * @param p 32 bytes
+   */
+  static void fromBytes(TDescriptor &a, const unsigned char *p);
   
   /**
    * Returns a mat with the descriptors in float format
@@ -85,6 +124,14 @@ public:
 
 };
 
+/// ORB descriptors are strings of 256 bits, compared in place in the rows of
+/// a descriptor matrix
+template<>
+struct DescriptorTraits<FORB>:
+  public DescriptorTraitsBase<256, true, false, 1, true>
+{
+};
+
 } // namespace DBoW2
 
 #endif
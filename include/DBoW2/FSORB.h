@@ -13,8 +13,10 @@
 #include <opencv2/core.hpp>
 #include <vector>
 #include <string>
+#include <stdint.h>
 
 #include "FClass.h"
+#include "DescriptorTraits.h"
 
 namespace DBoW2 {
 
@@ -46,6 +48,29 @@ public:
    */
   static double distance(const TDescriptor &a, const TDescriptor &b);
 
+  /**
+   * Calculates the distance between a descriptor given by its L bytes, such
+   * as a row of an NxL CV_8U matrix, and a descriptor
+   * @param a
+   * @param b
+   * @return distance
+   */
+  static double distance(const unsigned char *a, const TDescriptor &b);
+
+  /**
+   * Returns a hash of the descriptor
+   * @param a descriptor
+   * @return 64-bit hash
+   */
+  static uint64_t hash(const TDescriptor &a);
+
+  /**
+   * Returns the hash of a descriptor given by its L bytes
+   * @param a
+   * @return 64-bit hash, equal to that of the descriptor
+   */
+  static uint64_t hash(const unsigned char *a);
+
   /**
    * Returns a string version of the descriptor
    * @param a descriptor
@@ -60,6 +85,20 @@ public:
    */
   static void fromString(TDescriptor &a, const std::string &s);
 
+  /**
+   * Writes the 32 bytes of a descriptor, as stored in binary vocabularies
+   * @param a descriptor
+   * @param p (out) 32 bytes
+   */
+  static void toBytes(const TDescriptor &a, unsigned char *p);
+
+  /**
+   * Reads a descriptor written by toBytes
+   * @param a (out) descriptor
+   * @param p 32 bytes
+   */
+  static void fromBytes(TDescriptor &a, const unsigned char *p);
+
   /**
    * Returns a mat with the descriptors in float format
    * @param descriptors
@@ -90,6 +129,13 @@ public:
 
 };
 
+/// Semantic ORB descriptors pair an ORB descriptor with a semantic class
+template<>
+struct DescriptorTraits<FSORB>:
+  public DescriptorTraitsBase<256, true, true, 1, true>
+{
+};
+
 } // namespace DBoW2
 
 #endif
@@ -0,0 +1,95 @@
+/**
+ * File: FloatKernels.h
+ * Date: October 2026
+ * Description: vectorized kernels for float descriptors
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_FLOAT_KERNELS__
+#define __D_T_FLOAT_KERNELS__
+
+#include <stdint.h>
+
+namespace DBoW2 {
+
+/// Distance and mean kernels for float descriptors
+/**
+ * The kernels use AVX-512 or AVX2 with FMA when the processor supports
+ * them, and portable code otherwise. The instruction set is chosen once, at
+ * the first call. Pointers need not be aligned.
+ */
+class FloatKernels
+{
+public:
+
+  /**
+   * Returns the squared euclidean distance between two vectors
+   * @param a
+   * @param b
+   * @param n number of elements
+   * @return squared distance
+   */
+  static float squaredDistance(const float *a, const float *b, int n);
+
+  /**
+   * Adds a vector to another one
+   * @param sum (in/out) sum += a
+   * @param a
+   * @param n number of elements
+   */
+  static void accumulate(float *sum, const float *a, int n);
+
+  /**
+   * Multiplies a vector by a scalar
+   * @param a (in/out) a *= s
+   * @param s
+   * @param n number of elements
+   */
+  static void scale(float *a, float s, int n);
+
+  /**
+   * Returns the squared euclidean distance between two int8 vectors
+   * @param a
+   * @param b
+   * @param n number of elements
+   * @return squared distance
+   */
+  static int squaredDistanceInt8(const int8_t *a, const int8_t *b, int n);
+
+  /**
+   * Returns the squared euclidean distance between a float vector and a
+   * half precision (IEEE 754 binary16) vector
+   * @param a
+   * @param b
+   * @param n number of elements
+   * @return squared distance
+   */
+  static float squaredDistanceHalf(const float *a, const uint16_t *b, int n);
+
+  /**
+   * Converts floats to half precision, rounding to nearest
+   * @param a
+   * @param h (out) n half precision values
+   * @param n number of elements
+   */
+  static void toHalf(const float *a, uint16_t *h, int n);
+
+  /**
+   * Converts half precision values to floats
+   * @param h
+   * @param a (out) n floats
+   * @param n number of elements
+   */
+  static void fromHalf(const uint16_t *h, float *a, int n);
+
+  /**
+   * Returns the name of the instruction set the kernels use
+   * @return "AVX-512", "AVX2" or "scalar"
+   */
+  static const char* instructionSet();
+};
+
+} // namespace DBoW2
+
+#endif
@@ -0,0 +1,146 @@
+/**
+ * File: QuantizationCache.h
+ * Date: October 2026
+ * Description: bounded lock-free cache of descriptor to word assignments
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_QUANTIZATION_CACHE__
+#define __D_T_QUANTIZATION_CACHE__
+
+#include <atomic>
+#include <cstddef>
+#include <stdint.h>
+
+#include "BowVector.h"
+
+namespace DBoW2 {
+
+/// Hit and miss counters of a QuantizationCache
+struct QuantizationCacheStats
+{
+  /// Lookups answered by the cache
+  unsigned long long hits;
+  /// Lookups that had to descend the tree
+  unsigned long long misses;
+  /// Assignments stored in the cache
+  unsigned long long insertions;
+
+  /**
+   * Empty constructor
+   */
+  QuantizationCacheStats(): hits(0), misses(0), insertions(0){}
+
+  /**
+   * Returns the ratio of lookups answered by the cache
+   * @return hits / (hits + misses), or 0 if there were no lookups
+   */
+  double hitRate() const;
+};
+
+/// Cache from exact descriptor hashes to the vocabulary leaf they fall in
+/**
+ * The cache is a direct-mapped table with a fixed number of slots. Each
+ * slot stores the node id and the node id xor-ed with the key, so that
+ * readers can detect slots that are empty, hold another key, or were
+ * torn by a concurrent writer, without taking any lock. Colliding keys
+ * simply overwrite each other.
+ * Keys are 64-bit hashes of the descriptor, so two different descriptors
+ * with the same hash would share an assignment. This is negligible in
+ * practice but means the cache is not bit-exact in theory.
+ */
+class QuantizationCache
+{
+public:
+
+  /**
+   * Creates an empty cache
+   * @param capacity number of slots, rounded up to a power of two
+   */
+  explicit QuantizationCache(size_t capacity = 65536);
+
+  /**
+   * Destructor
+   */
+  ~QuantizationCache();
+
+  /**
+   * Looks for the node associated to a key
+   * @param key descriptor hash
+   * @param nid (out) leaf node id, only set if found
+   * @return true iff the key was found
+   */
+  bool find(uint64_t key, NodeId &nid) const;
+
+  /**
+   * Stores the node associated to a key, replacing the slot content
+   * @param key descriptor hash
+   * @param nid leaf node id (must not be the root)
+   */
+  void insert(uint64_t key, NodeId nid);
+
+  /**
+   * Removes all the assignments. Statistics are kept
+   * @note must not be called concurrently with find or insert
+   */
+  void clear();
+
+  /**
+   * Returns the number of slots of the cache
+   * @return capacity
+   */
+  inline size_t capacity() const { return m_mask + 1; }
+
+  /**
+   * Returns the hit and miss counters
+   * @return statistics
+   */
+  QuantizationCacheStats getStats() const;
+
+  /**
+   * Sets all the counters to 0
+   */
+  void resetStats();
+
+  /**
+   * Hashes a block of memory
+   * @param data
+   * @param bytes length of data
+   * @return 64-bit hash
+   */
+  static uint64_t hashBytes(const void *data, size_t bytes);
+
+protected:
+
+  /// Slot of the table
+  struct Slot
+  {
+    /// key ^ data
+    std::atomic<uint64_t> check;
+    /// node id, 0 if empty
+    std::atomic<uint64_t> data;
+  };
+
+protected:
+
+  /// Table of slots
+  Slot *m_slots;
+
+  /// capacity - 1
+  size_t m_mask;
+
+  /// Counters
+  mutable std::atomic<unsigned long long> m_hits;
+  mutable std::atomic<unsigned long long> m_misses;
+  std::atomic<unsigned long long> m_insertions;
+
+private:
+
+  QuantizationCache(const QuantizationCache &);
+  QuantizationCache& operator=(const QuantizationCache &);
+};
+
+} // namespace DBoW2
+
+#endif
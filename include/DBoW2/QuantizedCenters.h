@@ -0,0 +1,151 @@
+/**
+ * File: QuantizedCenters.h
+ * Date: October 2026
+ * Description: reduced precision copy of the node centers of a vocabulary
+ *   of float descriptors
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_QUANTIZED_CENTERS__
+#define __D_T_QUANTIZED_CENTERS__
+
+#include <cstddef>
+#include <vector>
+#include <stdint.h>
+
+#include "BowVector.h"
+#include "FloatKernels.h"
+
+namespace DBoW2 {
+
+/// Precision of the node centers used to propagate features down the tree
+enum NodePrecision
+{
+  /// Centers as stored in the nodes
+  FULL_PRECISION,
+  /// IEEE 754 half precision floats
+  HALF_PRECISION,
+  /// 8-bit integers with a scale factor shared by the whole tree
+  INT8_PRECISION
+};
+
+/// Access to the elements of float descriptors. Descriptor classes made of
+/// floats specialize it (see FFloat)
+template<class TDescriptor>
+struct FloatView
+{
+  /// Number of floats of the descriptor, 0 if it is not made of floats
+  static const int dimensions = 0;
+
+  /**
+   * Returns the floats of a descriptor
+   * @return pointer to the floats, or NULL
+   */
+  static inline const float* data(const TDescriptor &)
+  {
+    return NULL;
+  }
+};
+
+/// Node centers of a vocabulary tree stored with reduced precision,
+/// contiguously and indexed by node id
+class QuantizedCenters
+{
+public:
+
+  /// Maximum number of dimensions of the descriptors
+  static const int MAX_DIMENSIONS = 512;
+
+  /// Feature prepared to be compared with the centers
+  struct Query
+  {
+    /// Feature
+    const float *data;
+    /// Feature quantized to 8 bits (INT8_PRECISION only)
+    int8_t codes[MAX_DIMENSIONS];
+  };
+
+  /**
+   * Creates an empty set of centers
+   * @param precision HALF_PRECISION or INT8_PRECISION
+   * @param dimensions number of floats of the descriptors
+   * @throw std::string if the precision or the dimensions are not supported
+   */
+  QuantizedCenters(NodePrecision precision, int dimensions);
+
+  /**
+   * Quantizes the centers of all the nodes. With INT8_PRECISION, the scale
+   * factor is chosen so that the largest element is represented by 127
+   * @param centers centers[nid] points to the floats of node nid, or is
+   *   NULL for nodes without center (the root)
+   */
+  void build(const std::vector<const float*> &centers);
+
+  /**
+   * Prepares a feature to be compared with the centers
+   * @param feature floats of the feature
+   * @param q (out) query
+   */
+  void prepare(const float *feature, Query &q) const;
+
+  /**
+   * Returns the squared distance between a feature and a node center, in
+   * the units of the quantized domain (distances with INT8_PRECISION are
+   * scaled by 1 / scale()^2)
+   * @param q prepared feature
+   * @param nid node id
+   * @return squared distance
+   */
+  inline float distance(const Query &q, NodeId nid) const
+  {
+    if(m_precision == INT8_PRECISION)
+      return (float)FloatKernels::squaredDistanceInt8(q.codes,
+        &m_codes[(size_t)nid * m_dimensions], m_dimensions);
+    else
+      return FloatKernels::squaredDistanceHalf(q.data,
+        &m_halves[(size_t)nid * m_dimensions], m_dimensions);
+  }
+
+  /**
+   * Returns the precision of the centers
+   */
+  inline NodePrecision precision() const { return m_precision; }
+
+  /**
+   * Returns the number of dimensions of the centers
+   */
+  inline int dimensions() const { return m_dimensions; }
+
+  /**
+   * Returns the value represented by a code of 1 (INT8_PRECISION only)
+   */
+  inline float scale() const { return m_scale; }
+
+  /**
+   * Returns the bytes used by the centers
+   */
+  size_t bytes() const;
+
+protected:
+
+  /// Precision
+  NodePrecision m_precision;
+
+  /// Number of floats of each center
+  int m_dimensions;
+
+  /// Value of a code of 1, and its inverse
+  float m_scale;
+  float m_inv_scale;
+
+  /// Centers with INT8_PRECISION
+  std::vector<int8_t> m_codes;
+
+  /// Centers with HALF_PRECISION
+  std::vector<uint16_t> m_halves;
+};
+
+} // namespace DBoW2
+
+#endif
@@ -0,0 +1,295 @@
+/**
+ * File: QueryProfile.h
+ * Date: October 2026
+ * Description: optional instrumentation of database queries
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_QUERY_PROFILE__
+#define __D_T_QUERY_PROFILE__
+
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "BowVector.h"
+
+// Queries are only instrumented if DBOW2_QUERY_PROFILING is defined (cmake
+// option ENABLE_QueryProfiling). Otherwise, the DBOW2_PROFILE statements are
+// removed by the preprocessor and the profiler stays empty.
+#ifdef DBOW2_QUERY_PROFILING
+#define DBOW2_PROFILE(...) __VA_ARGS__
+#else
+#define DBOW2_PROFILE(...)
+#endif
+
+namespace DBoW2 {
+
+/// Work done by a single database query
+struct QueryProfile
+{
+  typedef std::chrono::steady_clock Clock;
+
+  /// Query words with a non-empty inverted row
+  unsigned int words;
+  /// Inverted file items visited
+  unsigned long postings;
+  /// Postings that went through the semantic weighting
+  unsigned long semantic_postings;
+  /// Entries that obtained a score
+  unsigned int entries;
+  /// Length of the longest inverted row visited
+  unsigned long max_posting_length;
+  /// Word with the longest inverted row visited
+  WordId heaviest_word;
+
+  /// Seconds accumulating scores along the inverted rows
+  double accumulation_time;
+  /// Seconds sorting and cutting the results
+  double sort_time;
+  /// Seconds normalizing the semantic scores of the results
+  double semantic_time;
+  /// Seconds of the whole query
+  double total_time;
+
+  /**
+   * Creates an empty profile
+   */
+  QueryProfile();
+
+  /**
+   * Accounts for the inverted row of a query word
+   * @param word_id word
+   * @param length number of items in the row of the word
+   */
+  void addRow(WordId word_id, unsigned long length);
+
+  /**
+   * Returns the seconds elapsed since the given time
+   * @param since time point
+   * @return seconds
+   */
+  static inline double seconds(const Clock::time_point &since)
+  {
+    return std::chrono::duration<double>(Clock::now() - since).count();
+  }
+};
+
+/// Histogram with power of two buckets
+/**
+ * Bucket 0 counts the values below 1, and bucket i > 0 counts the values
+ * in [2^(i-1), 2^i). Times are recorded in microseconds.
+ */
+class Histogram
+{
+public:
+
+  /**
+   * Creates an empty histogram
+   */
+  Histogram();
+
+  /**
+   * Adds a value
+   * @param value non-negative value
+   */
+  void add(double value);
+
+  /**
+   * Removes all the values
+   */
+  void clear();
+
+  /**
+   * Returns the number of values added
+   */
+  inline unsigned long count() const { return m_count; }
+
+  /**
+   * Returns the sum of the values added
+   */
+  inline double sum() const { return m_sum; }
+
+  /**
+   * Returns the mean of the values, or 0 if empty
+   */
+  double mean() const;
+
+  /**
+   * Returns the minimum value, or 0 if empty
+   */
+  inline double minValue() const { return m_count > 0 ? m_min : 0; }
+
+  /**
+   * Returns the maximum value, or 0 if empty
+   */
+  inline double maxValue() const { return m_max; }
+
+  /**
+   * Returns an upper bound of the given percentile, with the resolution of
+   * the buckets
+   * @param p percentile in [0..1]
+   * @return upper limit of the bucket where the percentile falls
+   */
+  double percentile(double p) const;
+
+  /**
+   * Returns the counter of each bucket
+   */
+  inline const std::vector<unsigned long>& buckets() const
+  {
+    return m_buckets;
+  }
+
+  /**
+   * Returns the upper limit (excluded) of the given bucket
+   * @param i bucket
+   */
+  static double bucketLimit(size_t i);
+
+protected:
+
+  std::vector<unsigned long> m_buckets;
+  unsigned long m_count;
+  double m_sum;
+  double m_min;
+  double m_max;
+};
+
+/// Aggregates the profiles of the queries made to a database
+/**
+ * Profiles can be recorded from concurrent queries. The accessors are not
+ * synchronized, so read them from a copy (see
+ * TemplatedDatabase::getQueryProfiler) when other threads are querying.
+ */
+class QueryProfiler
+{
+public:
+
+  /**
+   * Creates an empty profiler
+   */
+  QueryProfiler();
+
+  /**
+   * Copies the profiles of the given profiler
+   * @param p profiler
+   */
+  QueryProfiler(const QueryProfiler &p);
+
+  /**
+   * Copies the profiles of the given profiler
+   * @param p profiler
+   */
+  QueryProfiler& operator=(const QueryProfiler &p);
+
+  /**
+   * Tells whether this build instruments the queries
+   * @return true iff DBOW2_QUERY_PROFILING is defined
+   */
+  static inline bool enabled()
+  {
+#ifdef DBOW2_QUERY_PROFILING
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  /**
+   * Adds the profile of a query
+   * @param profile
+   */
+  void record(const QueryProfile &profile);
+
+  /**
+   * Removes all the profiles
+   */
+  void clear();
+
+  /**
+   * Returns the number of queries recorded
+   */
+  inline unsigned long queries() const { return m_words.count(); }
+
+  /**
+   * Returns the profile of the last query recorded
+   */
+  inline const QueryProfile& last() const { return m_last; }
+
+  /**
+   * Returns the profile of the slowest query recorded
+   */
+  inline const QueryProfile& slowest() const { return m_slowest; }
+
+  /// Histogram of words with a non-empty inverted row per query
+  inline const Histogram& words() const { return m_words; }
+
+  /// Histogram of postings visited per query
+  inline const Histogram& postings() const { return m_postings; }
+
+  /// Histogram of entries scored per query
+  inline const Histogram& entries() const { return m_entries; }
+
+  /// Histogram of the longest inverted row visited per query
+  inline const Histogram& maxPostingLength() const
+  {
+    return m_max_posting_length;
+  }
+
+  /// Histogram of accumulation time per query (microseconds)
+  inline const Histogram& accumulationTime() const
+  {
+    return m_accumulation_time;
+  }
+
+  /// Histogram of sorting time per query (microseconds)
+  inline const Histogram& sortTime() const { return m_sort_time; }
+
+  /// Histogram of semantic weighting time per query (microseconds)
+  inline const Histogram& semanticTime() const { return m_semantic_time; }
+
+  /// Histogram of total time per query (microseconds)
+  inline const Histogram& totalTime() const { return m_total_time; }
+
+protected:
+
+  /// Copies the data of p, which must be locked
+  void copy(const QueryProfiler &p);
+
+protected:
+
+  QueryProfile m_last;
+  QueryProfile m_slowest;
+
+  Histogram m_words;
+  Histogram m_postings;
+  Histogram m_entries;
+  Histogram m_max_posting_length;
+  Histogram m_accumulation_time;
+  Histogram m_sort_time;
+  Histogram m_semantic_time;
+  Histogram m_total_time;
+
+  mutable std::mutex m_mutex;
+};
+
+/**
+ * Writes a summary of the histogram
+ * @param os stream to write to
+ * @param h
+ */
+std::ostream& operator<<(std::ostream &os, const Histogram &h);
+
+/**
+ * Writes a summary of the queries recorded
+ * @param os stream to write to
+ * @param p
+ */
+std::ostream& operator<<(std::ostream &os, const QueryProfiler &p);
+
+} // namespace DBoW2
+
+#endif
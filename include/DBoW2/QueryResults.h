@@ -17,6 +17,23 @@ namespace DBoW2 {
 /// Id of entries of the database
 typedef unsigned int EntryId;
 
+/// Linear combination of the appearance and semantic scores that ranks the
+/// results of L1 queries (see TemplatedDatabase::setRankingWeights)
+struct RankingWeights
+{
+  /// Weight of Result::Score
+  double appearance;
+  /// Weight of the semantic agreement of the entry
+  double semantic;
+
+  /**
+   * Creates a combination. The default one ranks by appearance only
+   * @param a weight of the appearance score
+   * @param s weight of the semantic agreement
+   */
+  RankingWeights(double a = 1, double s = 0): appearance(a), semantic(s) {}
+};
+
 /// Single result of a query
 class Result
 {
@@ -28,6 +45,11 @@ public:
   /// Score obtained
   double Score;
   double SemanticScore;
+
+  /// Score used to rank the results of L1 queries: Score combined with the
+  /// semantic agreement of the entry (see RankingWeights). Only filled by
+  /// L1 queries
+  double FusedScore;
   
   /// debug
   int nWords; // words in common
@@ -53,7 +75,7 @@ public:
    * @param _id entry id
    * @param _score score
    */
-  inline Result(EntryId _id, double _score, double _semanticScore = 0): Id(_id), Score(_score), SemanticScore(_semanticScore){}
+  inline Result(EntryId _id, double _score, double _semanticScore = 0): Id(_id), Score(_score), SemanticScore(_semanticScore), FusedScore(0){}
 
   /**
    * Compares the scores of two results
@@ -145,6 +167,17 @@ public:
   }
   
   
+  /**
+   * Compares the fused scores of two results
+   * @param a
+   * @param b
+   * @return true iff a.FusedScore > b.FusedScore
+   */
+  static inline bool gtFused(const Result &a, const Result &b)
+  {
+    return a.FusedScore > b.FusedScore;
+  }
+
   /**
    * Returns true iff a.Id < b.Id
    * @param a
@@ -0,0 +1,313 @@
+/**
+ * File: SemanticClasses.h
+ * Date: October 2026
+ * Description: semantic classes of the features and compatibility of
+ *   their matches
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_SEMANTIC_CLASSES__
+#define __D_T_SEMANTIC_CLASSES__
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+namespace DBoW2 {
+
+class BundleSection;
+
+/// Semantic class packed in 32 bits
+struct SemanticClass
+{
+  /// Class id, as in the categories of the class file
+  uint16_t id;
+  /// Id of the super-category, 0 if the class has none
+  uint16_t parent;
+};
+
+/// Multipliers applied to the score of a word when the classes of the query
+/// feature and the database feature are compared
+struct SemanticWeights
+{
+  /// Same class
+  double match;
+  /// Same anchor class
+  double anchor_match;
+  /// Different classes of the same super-category
+  double related;
+  /// Different classes, or only one of the features has a class
+  double mismatch;
+  /// Weight in the bow vectors of the features of anchor classes without a
+  /// weight of their own
+  double anchor_feature;
+  /// Weight in the bow vectors of the features of other classes without a
+  /// weight of their own
+  double feature;
+  /// Weight in the bow vectors of the features of dynamic classes (e.g.
+  /// people, vehicles) without a weight of their own. With 0, they are
+  /// dropped; below 1, they are down-weighted
+  double dynamic_feature;
+
+  SemanticWeights(): match(2), anchor_match(5), related(1), mismatch(-2),
+    anchor_feature(1), feature(1), dynamic_feature(0) {}
+};
+
+/// Semantic classes known by a database and their compatibility matrix
+/**
+ * Classes are given slots (Index) in the order they are registered, so the
+ * postings of the inverted file store 16 bits per feature and the
+ * multiplier of a pair of classes is a lookup in a dense matrix built in
+ * advance. Slot NO_CLASS stands for features without class (ids <= 0) and
+ * slot UNKNOWN_CLASS for ids that were never registered, which do not
+ * match any class.
+ */
+class SemanticClasses
+{
+public:
+
+  /// Slot of a class
+  typedef uint16_t Index;
+
+  /// Slot of the features without class
+  static const Index NO_CLASS = 0;
+
+  /// Slot of the classes that have not been registered
+  static const Index UNKNOWN_CLASS = 1;
+
+  /// Largest class or super-category id
+  static const int MAX_ID = 65535;
+
+  /// Maximum number of slots
+  static const int MAX_CLASSES = 4096;
+
+  /**
+   * Creates a set with no classes
+   */
+  SemanticClasses();
+
+  /**
+   * Reads the classes from the "categories" array of a json class file
+   * (COCO format). Each category has an "id" and optional "is_anchor" and
+   * "is_dynamic" flags. The super-category is given by an optional
+   * "supercategory" field, which can be the id of the super-category or its
+   * name, and the weight of its features in the bow vectors by an optional
+   * "weight"
+   * @param filename
+   * @throw std::string if the file cannot be read or an id is out of range
+   */
+  void load(const std::string &filename);
+
+  /**
+   * Writes the classes, in slot order, and the weights in binary format
+   * (see Bundle)
+   * @param out stream
+   */
+  void saveBinary(std::ostream &out) const;
+
+  /**
+   * Replaces the classes and the weights with those written by saveBinary.
+   * The classes keep their slots
+   * @param section data
+   * @throw std::string if the data is not valid
+   */
+  void loadBinary(BundleSection section);
+
+  /**
+   * Registers a class, or updates it if it is already known
+   * @param id class id in [1, MAX_ID]
+   * @param parent super-category id in [0, MAX_ID], 0 for none
+   * @param is_anchor whether the class is an anchor
+   * @param weight weight of the features of the class in the bow vectors,
+   *   or < 0 to use the default of dynamic, anchor or other classes
+   * @param is_dynamic whether the class is of objects that move (see
+   *   SemanticWeights::dynamic_feature)
+   * @return slot of the class
+   * @throw std::string if an id is out of range or there are too many
+   *   classes
+   */
+  Index add(int id, int parent = 0, bool is_anchor = false,
+    double weight = -1, bool is_dynamic = false);
+
+  /**
+   * Returns the slot of a class, registering it if it is unknown
+   * @param id class id
+   * @return slot of the class, NO_CLASS if id <= 0
+   * @throw std::string if id > MAX_ID or there are too many classes
+   */
+  Index insert(int id);
+
+  /**
+   * Returns the slot of a class without registering it
+   * @param id class id
+   * @return slot of the class, NO_CLASS if id <= 0 or UNKNOWN_CLASS
+   */
+  inline Index index(int id) const
+  {
+    if(id <= 0) return NO_CLASS;
+    std::unordered_map<int, Index>::const_iterator it = m_slots.find(id);
+    return (it == m_slots.end() ? UNKNOWN_CLASS : it->second);
+  }
+
+  /**
+   * Returns the multiplier of a pair of classes
+   * @param q slot of the class of the query feature
+   * @param d slot of the class of the database feature
+   * @return multiplier
+   */
+  inline double compatibility(Index q, Index d) const
+  {
+    return m_matrix[(size_t)q * m_stride + d];
+  }
+
+  /**
+   * Returns the bit of a class in the class-presence signatures of the
+   * database entries. Slots share bits modulo 64, so a signature may report
+   * a class that is absent, but never misses one; with more than 64
+   * classes, the number of bits in common is not the number of classes
+   * @param i slot
+   * @return bit mask, 0 for NO_CLASS and UNKNOWN_CLASS
+   */
+  static inline uint64_t signature(Index i)
+  {
+    return (i == NO_CLASS || i == UNKNOWN_CLASS ? 0 :
+      (uint64_t)1 << (i & 63));
+  }
+
+  /**
+   * Returns the class in a slot
+   * @param i slot
+   * @return packed class (id 0 for NO_CLASS and UNKNOWN_CLASS)
+   */
+  inline const SemanticClass& getClass(Index i) const
+  {
+    return m_classes[i];
+  }
+
+  /**
+   * Returns whether a class is an anchor
+   * @param i slot
+   */
+  inline bool isAnchor(Index i) const
+  {
+    return m_anchors[i] != 0;
+  }
+
+  /**
+   * Returns whether a class is dynamic
+   * @param i slot
+   */
+  inline bool isDynamic(Index i) const
+  {
+    return m_dynamic[i] != 0;
+  }
+
+  /**
+   * Returns the weight of the features of a class in the bow vectors
+   * @param i slot
+   * @return weight (1 for NO_CLASS and UNKNOWN_CLASS)
+   */
+  double featureWeight(Index i) const;
+
+  /**
+   * Returns the weights of the features of the classes, by class id, as
+   * expected by TemplatedVocabulary::setClassWeights
+   * @param weights (out) weights[id] is the weight of class id; empty if
+   *   all the weights are 1
+   */
+  void getFeatureWeights(std::vector<float> &weights) const;
+
+  /**
+   * Returns the number of slots, including NO_CLASS and UNKNOWN_CLASS
+   * @return number of slots
+   */
+  inline size_t size() const
+  {
+    return m_classes.size();
+  }
+
+  /**
+   * Sets the multipliers and rebuilds the compatibility matrix
+   * @param weights
+   */
+  void setWeights(const SemanticWeights &weights);
+
+  /**
+   * Returns the multipliers
+   * @return weights
+   */
+  inline const SemanticWeights& getWeights() const
+  {
+    return m_weights;
+  }
+
+  /**
+   * Removes all the classes
+   */
+  void clear();
+
+  /**
+   * Returns the memory used by the classes and the matrix
+   * @return bytes
+   */
+  size_t bytes() const;
+
+protected:
+
+  /**
+   * Registers a new class
+   * @param c packed class
+   * @param is_anchor
+   * @param weight weight of the features, < 0 for the default
+   * @param is_dynamic
+   * @return slot of the class
+   */
+  Index append(const SemanticClass &c, bool is_anchor, double weight,
+    bool is_dynamic);
+
+  /**
+   * Fills the compatibility matrix, making room for the slots
+   */
+  void buildMatrix();
+
+  /**
+   * Fills the row and the column of a slot of the compatibility matrix
+   * @param i slot
+   */
+  void fillSlot(Index i);
+
+protected:
+
+  /// Classes by slot
+  std::vector<SemanticClass> m_classes;
+
+  /// Anchor flags by slot
+  std::vector<unsigned char> m_anchors;
+
+  /// Dynamic flags by slot
+  std::vector<unsigned char> m_dynamic;
+
+  /// Weight of the features by slot, < 0 for the default
+  std::vector<float> m_feature_weights;
+
+  /// Slot of each class id
+  std::unordered_map<int, Index> m_slots;
+
+  /// Multipliers
+  SemanticWeights m_weights;
+
+  /// Row length of the matrix, which grows by doubling so that registering
+  /// a class only fills its row and its column
+  size_t m_stride;
+
+  /// m_matrix[q * m_stride + d] = multiplier of classes q and d
+  std::vector<float> m_matrix;
+};
+
+} // namespace DBoW2
+
+#endif
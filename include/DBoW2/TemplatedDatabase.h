@@ -10,22 +10,28 @@
 #ifndef __D_T_TEMPLATED_DATABASE__
 #define __D_T_TEMPLATED_DATABASE__
 
+#include <cstring>
 #include <vector>
 #include <numeric>
 #include <fstream>
+#include <sstream>
 #include <string>
 #include <list>
 #include <set>
+#include <bitset>
+#include <type_traits>
 
 #include "TemplatedVocabulary.h"
+#include "Bundle.h"
+#include "DescriptorTraits.h"
+#include "Allocators.h"
 #include "QueryResults.h"
+#include "QueryProfile.h"
+#include "DatabaseStats.h"
 #include "ScoringObject.h"
 #include "BowVector.h"
 #include "FeatureVector.h"
-
-#include "nlohmann/json.hpp"
-
-using json = nlohmann::json;
+#include "SemanticClasses.h"
 
 namespace DBoW2 {
 
@@ -129,12 +135,110 @@ public:
   inline const TemplatedVocabulary<TDescriptor,F>* getVocabulary() const;
 
   /**
-   * Parses the semantic class file and sets the m_class_map.
-   * @param T class inherited from TemplatedVocabulary<TDescriptor, F>
+   * Parses the semantic class file and registers its classes, with their
+   * anchor flags, super-categories and feature weights (see
+   * SemanticClasses::load). The feature weights are passed on to the
+   * vocabulary, which applies them when building the bow vectors
    * @param classFile json file holding the class information
    */
   inline void parseSemanaticClasses(const std::string &classFile);
 
+  /**
+   * Returns the semantic classes known by the database
+   * @return classes
+   */
+  inline const SemanticClasses& getClassTable() const
+  {
+    return m_classes;
+  }
+
+  /**
+   * Sets the multipliers applied to the L1 score of the words depending on
+   * the classes of the features (see queryL1), and the default weights of
+   * the features of anchor and other classes in the bow vectors
+   * @param weights
+   */
+  inline void setSemanticWeights(const SemanticWeights &weights)
+  {
+    m_classes.setWeights(weights);
+    updateClassWeights();
+  }
+
+  /**
+   * Returns the multipliers applied depending on the semantic classes
+   * @return weights
+   */
+  inline const SemanticWeights& getSemanticWeights() const
+  {
+    return m_classes.getWeights();
+  }
+
+  /**
+   * Sets how L1 queries rank the entries before keeping the best
+   * max_results. Each result gets FusedScore = appearance * Score +
+   * semantic * A, where A is the semantic agreement of the entry: the L1
+   * score with each word weighted by the compatibility of the classes,
+   * normalized like Score. Both scores are accumulated in the same pass
+   * over the inverted file. With a semantic weight of 0 (default), the
+   * results are ranked by Score
+   * @param weights linear combination, e.g. learned from labelled queries
+   */
+  inline void setRankingWeights(const RankingWeights &weights)
+  {
+    m_ranking = weights;
+  }
+
+  /**
+   * Returns how L1 queries rank the entries
+   * @return weights
+   */
+  inline const RankingWeights& getRankingWeights() const
+  {
+    return m_ranking;
+  }
+
+  /**
+   * Enables a coarse semantic filter of the entries before L1 scoring. A
+   * query whose features have anchor classes only scores the entries that
+   * share at least min_anchors of them. A 64-bit class-presence signature
+   * per entry discards most entries; if more than 64 classes are
+   * registered, the classes of the remaining ones are counted exactly.
+   * Queries without anchor classes are not filtered
+   * @param min_anchors number of anchor classes in common; 0 disables the
+   *   filter (default)
+   */
+  inline void setSemanticPrefilter(int min_anchors)
+  {
+    m_prefilter_anchors = min_anchors;
+  }
+
+  /**
+   * Returns the number of anchor classes an entry must share with the
+   * query to be scored, 0 if the filter is disabled
+   * @return min anchors
+   */
+  inline int getSemanticPrefilter() const
+  {
+    return m_prefilter_anchors;
+  }
+
+  /**
+   * Sets where the postings of the inverted file are allocated. With
+   * ARENA_ALLOCATION, they are taken from slabs of a pool that is emptied
+   * when the database is cleared. The current content is kept
+   * @param policy allocation policy
+   */
+  void setAllocationPolicy(AllocationPolicy policy);
+
+  /**
+   * Returns the allocation policy of the postings
+   * @return allocation policy
+   */
+  inline AllocationPolicy getAllocationPolicy() const
+  {
+    return (m_pool ? ARENA_ALLOCATION : HEAP_ALLOCATION);
+  }
+
   /**
    * Allocates some memory for the direct and inverted indexes
    * @param nd number of expected image entries in the database
@@ -144,7 +248,10 @@ public:
   void allocate(int nd = 0, int ni = 0);
 
   /**
-   * Adds an entry to the database and returns its index
+   * Adds an entry to the database and returns its index. If the features
+   * carry semantic classes, each word gets the most frequent class of its
+   * features in the inverted file, and the direct index keeps the class of
+   * every feature
    * @param features features of the new entry
    * @param bowvec if given, the bow vector of these features is returned
    * @param fvec if given, the vector of nodes and feature indexes is returned
@@ -154,7 +261,22 @@ public:
     BowVector *bowvec = NULL, FeatureVector *fvec = NULL);
 
   /**
-   * Adds an entry to the database and returns its index
+   * Adds an entry to the database like add(features, bowvec, fvec), using
+   * the given context to quantize semantic features. Reusing a context
+   * (one per thread) avoids allocating its buffers for every entry
+   * @param features features of the new entry
+   * @param ctx scratch context
+   * @param bowvec if given, the bow vector of these features is returned
+   * @param fvec if given, the vector of nodes and feature indexes is returned
+   * @return id of new entry
+   */
+  EntryId add(const std::vector<TDescriptor> &features,
+    TransformContext &ctx, BowVector *bowvec = NULL,
+    FeatureVector *fvec = NULL);
+
+  /**
+   * Adds an entry to the database and returns its index. No semantic
+   * classes are recorded
    * @param vec bow vector
    * @param fec feature vector to add the entry. Only necessary if using the
    *   direct index
@@ -164,14 +286,57 @@ public:
     const FeatureVector &fec = FeatureVector() );
 
   /**
-   * Adds an entry to the database and returns its index
-   * @param Tdescriptor vector
-   * @param vec bow vector
+   * Adds an entry to the database and returns its index, recording the
+   * semantic classes of the features like add(features). The features are
+   * quantized again to know the word of each one
+   * @param vec bow vector of the features
+   * @param features
    * @return id of new entry
    */
   EntryId add(const BowVector &vec,
     const std::vector<TDescriptor> &features);
 
+  /**
+   * Adds an entry like add(vec, features), quantizing the features with the
+   * given context
+   * @param vec bow vector of the features
+   * @param features
+   * @param ctx scratch context
+   * @return id of new entry
+   */
+  EntryId add(const BowVector &vec,
+    const std::vector<TDescriptor> &features, TransformContext &ctx);
+
+  /**
+   * Adds an entry to the database from the rows of a descriptor matrix,
+   * such as the one returned by cv::ORB, without creating a cv::Mat per
+   * descriptor. Only available for descriptor classes with
+   * DescriptorTraits<F>::has_batch_distance (FORB, FSORB, FBrief)
+   * @param descriptors N x DescriptorTraits<F>::bytes CV_8U matrix
+   * @param classes if given, semantic class of each row (e.g. looked up in
+   *   a segmentation mask), recorded like the classes of semantic features
+   * @param bowvec if given, the bow vector of these features is returned
+   * @param fvec if given, the vector of nodes and feature indexes is returned
+   * @return id of new entry
+   */
+  EntryId add(const cv::Mat &descriptors, const int *classes = NULL,
+    BowVector *bowvec = NULL, FeatureVector *fvec = NULL);
+
+  /**
+   * Adds an entry from a descriptor matrix like add(descriptors, classes,
+   * bowvec, fvec), quantizing the rows with the given context if they have
+   * classes
+   * @param descriptors N x DescriptorTraits<F>::bytes CV_8U matrix
+   * @param classes semantic class of each row, or NULL
+   * @param ctx scratch context
+   * @param bowvec if given, the bow vector of these features is returned
+   * @param fvec if given, the vector of nodes and feature indexes is returned
+   * @return id of new entry
+   */
+  EntryId add(const cv::Mat &descriptors, const int *classes,
+    TransformContext &ctx, BowVector *bowvec = NULL,
+    FeatureVector *fvec = NULL);
+
   /**
    * Empties the database
    */
@@ -206,6 +371,19 @@ public:
   void query(const std::vector<TDescriptor> &features, QueryResults &ret,
     int max_results = 1, int max_id = -1) const;
 
+  /**
+   * Queries the database with some features like query(features, ret),
+   * quantizing semantic features with the given context
+   * @param features query features
+   * @param ctx scratch context
+   * @param ret (out) query results
+   * @param max_results number of results to return. <= 0 means all
+   * @param max_id only entries with id <= max_id are returned in ret.
+   *   < 0 means all
+   */
+  void query(const std::vector<TDescriptor> &features, TransformContext &ctx,
+    QueryResults &ret, int max_results = 1, int max_id = -1) const;
+
   /**
    * Queries the database with a vector
    * @param vec bow vector already normalized
@@ -217,6 +395,120 @@ public:
   void query(const BowVector &vec, const std::vector<TDescriptor> &features, QueryResults &ret,
     int max_results = 1, int max_id = -1) const;
 
+  /**
+   * Queries the database with a vector like query(vec, features, ret),
+   * quantizing the features with the given context
+   * @param vec bow vector already normalized
+   * @param features features of vec
+   * @param ctx scratch context
+   * @param ret results
+   * @param max_results number of results to return. <= 0 means all
+   * @param max_id only entries with id <= max_id are returned in ret.
+   *   < 0 means all
+   */
+  void query(const BowVector &vec, const std::vector<TDescriptor> &features,
+    TransformContext &ctx, QueryResults &ret, int max_results = 1,
+    int max_id = -1) const;
+
+  /**
+   * Queries the database with a vector and the semantic classes of its
+   * words (see TransformContext::wordClasses)
+   * @param vec bow vector already normalized
+   * @param classes semantic class of each word of vec, in ascending word id
+   *   order, or NULL
+   * @param ret results
+   * @param max_results number of results to return. <= 0 means all
+   * @param max_id only entries with id <= max_id are returned in ret.
+   *   < 0 means all
+   */
+  void query(const BowVector &vec, const int *classes, QueryResults &ret,
+    int max_results = 1, int max_id = -1) const;
+
+  /**
+   * Queries the database with the rows of a descriptor matrix, without
+   * creating a cv::Mat per descriptor
+   * @param descriptors NxL CV_8U matrix
+   * @param classes semantic class of each row, or NULL
+   * @param ret (out) query results
+   * @param max_results number of results to return. <= 0 means all
+   * @param max_id only entries with id <= max_id are returned in ret.
+   *   < 0 means all
+   */
+  void query(const cv::Mat &descriptors, const int *classes,
+    QueryResults &ret, int max_results = 1, int max_id = -1) const;
+
+  /**
+   * Queries the database with a descriptor matrix like query(descriptors,
+   * classes, ret), quantizing the rows with the given context if they have
+   * classes
+   * @param descriptors NxL CV_8U matrix
+   * @param classes semantic class of each row, or NULL
+   * @param ctx scratch context
+   * @param ret (out) query results
+   * @param max_results number of results to return. <= 0 means all
+   * @param max_id only entries with id <= max_id are returned in ret.
+   *   < 0 means all
+   */
+  void query(const cv::Mat &descriptors, const int *classes,
+    TransformContext &ctx, QueryResults &ret, int max_results = 1,
+    int max_id = -1) const;
+
+  /**
+   * Estimates the memory used by the inverted file, the direct file and the
+   * semantic data, and computes the length of the posting lists
+   * @param top_words number of heaviest words to report
+   * @return statistics
+   */
+  DatabaseStats computeStats(size_t top_words = 10) const;
+
+  /**
+   * Computes the statistics of the vocabulary, including how the entries of
+   * the database are distributed among its words
+   * @return statistics
+   */
+  VocabularyStats computeVocabularyStats() const;
+
+  /**
+   * Prunes the vocabulary of the database to at most target_words words,
+   * removing first the words that occur in fewer entries (see
+   * TemplatedVocabulary::prune), and remaps the entries to the new words
+   * as setPrunedVocabulary does
+   * @param target_words words to keep
+   * @param remap (out) if given, the remap table, to keep other databases
+   *   built with the same vocabulary
+   * @return number of words removed
+   */
+  unsigned int pruneVocabulary(unsigned int target_words,
+    VocabularyRemap *remap = NULL);
+
+  /**
+   * Replaces the vocabulary with a pruned version of it, keeping the
+   * entries. The postings of the words that were merged are merged too: an
+   * entry gets the sum of its weights and the class of its heaviest
+   * posting, and the nodes of the direct index are mapped to those that
+   * took their features. The weights are still those computed with the
+   * original vocabulary; adding the images again gives the exact ones
+   * @param T class inherited from TemplatedVocabulary<TDescriptor, F>
+   * @param voc pruned vocabulary
+   * @param remap table written when the vocabulary was pruned
+   * @throw std::string if the table does not match the vocabularies or the
+   *   direct index
+   */
+  template<class T>
+  void setPrunedVocabulary(const T &voc, const VocabularyRemap &remap);
+
+  /**
+   * Returns a snapshot of the profiles of the queries made so far. Queries
+   * are only profiled if DBOW2_QUERY_PROFILING is defined
+   * @return query profiler
+   */
+  QueryProfiler getQueryProfiler() const;
+
+  /**
+   * Discards the profiles of the queries made so far
+   */
+  void clearQueryProfiler();
+
   /**
    * Returns the a feature vector associated with a database entry
    * @param id entry id (must be < size())
@@ -225,6 +517,18 @@ public:
    */
   const FeatureVector& retrieveFeatures(EntryId id) const;
 
+  /**
+   * Returns the semantic classes of the features of a database entry, in
+   * the order of the feature indexes of retrieveFeatures. The classes are
+   * slots of getClassTable() (getClassTable().getClass(slot).id is the
+   * class id)
+   * @param id entry id (must be < size())
+   * @return class slot of each feature, or an empty vector if the entry
+   *   has no semantic classes or the direct index is not used
+   */
+  const std::vector<SemanticClasses::Index>& retrieveClasses(EntryId id)
+    const;
+
   /**
    * Stores the database in a file
    * @param filename
@@ -253,10 +557,171 @@ public:
   virtual void load(const cv::FileStorage &fs,
     const std::string &name = "database");
 
+  /**
+   * Stores the vocabulary, the semantic classes and, optionally, the entries
+   * in a single bundle file (see Bundle)
+   * @param filename
+   * @param with_entries whether to store the entries too, or only what is
+   *   needed to create an empty database
+   */
+  void saveBundle(const std::string &filename, bool with_entries = true)
+    const;
+
+  /**
+   * Loads the vocabulary, the semantic classes and the entries from a
+   * bundle file. The database is left empty if the bundle has no entries.
+   * On error, the database is not modified
+   * @param filename
+   * @throw std::string if the file cannot be read or is not valid
+   */
+  void loadBundle(const std::string &filename);
+
+  /**
+   * Loads the database from the sections of an open bundle. The sections
+   * are parsed into a new database that replaces the content of this one
+   * once all of them are valid, so on error the database is not modified.
+   * The vocabulary becomes a TemplatedVocabulary
+   * @param bundle
+   * @throw std::string if the bundle is not valid
+   */
+  void loadBundle(const Bundle &bundle);
+
+  /**
+   * Writes the entries (inverted file, signatures and direct file) in the
+   * binary format of the bundle sections
+   * @param out stream
+   */
+  void saveBinary(std::ostream &out) const;
+
+  /**
+   * Replaces the entries with those written by saveBinary. The vocabulary
+   * and the semantic classes must be the ones the database had then
+   * @param section data
+   * @throw std::string if the data is not valid
+   */
+  void loadBinary(BundleSection section);
+
 protected:
 
+  /// Whether the features carry semantic classes, as a type
+  typedef std::integral_constant<bool, DescriptorTraits<F>::is_semantic>
+    SemanticFeatures;
+
+  /**
+   * Returns the semantic classes of the features
+   * @param features
+   * @param classes (out) class of each feature, or empty if the features
+   *   carry no semantic information
+   */
+  static void getSemanticClasses(const std::vector<TDescriptor> &features,
+    std::vector<int> &classes);
+
+  /**
+   * Returns the semantic classes of features that carry one. A template, so
+   * that it is only instantiated for semantic features
+   * @param features
+   * @param classes (out) class of each feature
+   */
+  template<class T>
+  static void getSemanticClasses(const std::vector<T> &features,
+    std::vector<int> &classes, std::true_type);
+
+  /**
+   * Returns no classes for features without semantic information
+   * @param features
+   * @param classes (out) empty
+   */
+  template<class T>
+  static void getSemanticClasses(const std::vector<T> &features,
+    std::vector<int> &classes, std::false_type);
+
+  /**
+   * Gives each word of a bow vector the most frequent class of the features
+   * assigned to it
+   * @param vec bow vector
+   * @param ctx transform of the features of vec
+   * @param classes semantic class of each feature
+   * @param word_classes (out) class of each word of vec
+   */
+  static void getWordClasses(const BowVector &vec,
+    const TransformContext &ctx, const int *classes,
+    std::vector<int> &word_classes);
+
+  /**
+   * Adds an entry to the inverted file and, if used, to the direct file
+   * @param vec bow vector
+   * @param fv nodes of the features, or NULL
+   * @param classes semantic class of each feature, or NULL
+   * @param n number of features
+   * @param ctx transform of the features, needed if classes are given
+   * @return id of new entry
+   * @throw std::string if a class cannot be registered (see
+   *   SemanticClasses::insert), before the database is modified
+   */
+  EntryId addEntry(const BowVector &vec, const FeatureVector *fv,
+    const int *classes, size_t n, const TransformContext *ctx);
+
+  /**
+   * Adds an entry with semantic classes from the transform of its features
+   * @param ctx transform of the features
+   * @param classes semantic class of each feature
+   * @param n number of features
+   * @param v (out) bow vector
+   * @param fvec if given, the vector of nodes and feature indexes is returned
+   * @return id of new entry
+   */
+  EntryId addSemantic(const TransformContext &ctx, const int *classes,
+    size_t n, BowVector &v, FeatureVector *fvec);
+
+  /**
+   * Sets the classes and the class-presence signature of an entry
+   * @param entry_id
+   * @param classes classes of the features of the entry, without the
+   *   dropped ones. They are sorted, made unique and moved
+   */
+  void setEntryClasses(EntryId entry_id,
+    std::vector<SemanticClasses::Index> &classes);
+
+  /**
+   * Selects the entries that share enough anchor classes with the query
+   * (see setSemanticPrefilter)
+   * @param vec query vector
+   * @param word_classes class of each word of vec
+   * @param shortlist (out) shortlist[entry_id] != 0 if the entry passes,
+   *   or empty if the query has no anchor classes
+   */
+  void getShortlist(const BowVector &vec, const int *word_classes,
+    std::vector<unsigned char> &shortlist) const;
+
+  /**
+   * Passes the weights of the features of the classes on to the vocabulary
+   */
+  void updateClassWeights();
+
+  /**
+   * Moves the postings and the direct index to the words and nodes of a
+   * pruned vocabulary. Nothing changes if an exception is thrown
+   * @param remap remap table of the vocabulary of the database
+   * @param words number of words of the pruned vocabulary
+   * @throw std::string if the table does not match
+   */
+  void remapEntries(const VocabularyRemap &remap, unsigned int words);
+
+  /// Scores of an entry accumulated by queryL1
+  struct L1Score
+  {
+    /// Sum of the L1 terms of the common words
+    double appearance;
+    /// Sum of the terms weighted by the compatibility of the classes
+    double semantic;
+    /// Number of common words whose features have a class
+    int semantic_words;
+
+    L1Score(): appearance(0), semantic(0), semantic_words(0) {}
+  };
+
   /// Query with L1 scoring
-  void queryL1(const BowVector &vec, const std::vector<TDescriptor> &features,
+  void queryL1(const BowVector &vec, const int *word_classes,
     QueryResults &ret, int max_results, int max_id) const;
 
   /// Query with L2 scoring
@@ -289,12 +754,14 @@ protected:
     /// Entry id
     EntryId entry_id;
 
+    /// Slot of the semantic class of the feature in the class table
+    /// (SemanticClasses::NO_CLASS if it has none). It fits in the padding
+    /// before the weight
+    SemanticClasses::Index semanticClass;
+
     /// Word weight in this entry
     WordValue word_weight;
 
-    // Enum which indicated whether it is a semantic feature, and if so, if it is an anchor or non anchor semantic feature
-    int semanticClass;
-
     /**
      * Creates an empty pair
      */
@@ -304,8 +771,11 @@ protected:
      * Creates an inverted file pair
      * @param eid entry id
      * @param wv word weight
+     * @param sc slot of the semantic class
      */
-    IFPair(EntryId eid, WordValue wv, int sc = -1): entry_id(eid), word_weight(wv), semanticClass(sc) {}
+    IFPair(EntryId eid, WordValue wv,
+      SemanticClasses::Index sc = SemanticClasses::NO_CLASS)
+      : entry_id(eid), semanticClass(sc), word_weight(wv) {}
 
     /**
      * Compares the entry ids
@@ -316,7 +786,7 @@ protected:
   };
 
   /// Row of InvertedFile
-  typedef std::list<IFPair> IFRow;
+  typedef std::list<IFPair, PoolAllocator<IFPair> > IFRow;
   // IFRows are sorted in ascending entry_id order
 
   /// Inverted index
@@ -329,6 +799,10 @@ protected:
   typedef std::vector<FeatureVector> DirectFile;
   // DirectFile[entry_id] --> [ directentry, ... ]
 
+  /// Semantic classes of the direct index
+  typedef std::vector<std::vector<SemanticClasses::Index> > DirectClasses;
+  // DirectClasses[entry_id][i_feature] --> class slot
+
 protected:
 
   /// Associated vocabulary
@@ -344,14 +818,45 @@ protected:
   /// Inverted file (must have size() == |words|)
   InvertedFile m_ifile;
 
+  /// Pool of the postings (NULL if using the global allocator)
+  SlabPool *m_pool;
+
   /// Direct file (resized for allocation)
   DirectFile m_dfile;
 
+  /// Classes of the features of the direct file
+  DirectClasses m_dclasses;
+
   /// Number of valid entries in m_dfile
   int m_nentries;
 
-  // Semnatic class map
-  std::unordered_map<int, bool> m_semantic_class_map;
+  /// Semantic classes and their compatibility matrix
+  SemanticClasses m_classes;
+
+  /// Combination of scores that ranks the results of L1 queries
+  RankingWeights m_ranking;
+
+  /// Class-presence signature of each entry (see SemanticClasses::signature)
+  std::vector<uint64_t> m_signatures;
+
+  /// Distinct classes of the features of each entry, in ascending slot
+  /// order, without the dropped ones. The prefilter counts the anchors an
+  /// entry shares with the query here when the signatures cannot tell
+  DirectClasses m_entry_classes;
+
+  /// Anchor classes an entry must share with the query to be scored by
+  /// L1 queries (0: no filter)
+  int m_prefilter_anchors;
+
+  /// Features left out of the entries because their class has weight 0,
+  /// by slot of the class
+  std::vector<unsigned long> m_dropped_features;
+
+  /// Features indexed with a class weight below 1
+  unsigned long m_weighted_features;
+
+  /// Profiles of the queries (empty unless DBOW2_QUERY_PROFILING)
+  mutable QueryProfiler m_profiler;
 };
 
 // --------------------------------------------------------------------------
@@ -359,7 +864,8 @@ protected:
 template<class TDescriptor, class F>
 TemplatedDatabase<TDescriptor, F>::TemplatedDatabase
   (bool use_di, int di_levels)
-  : m_voc(NULL), m_use_di(use_di), m_dilevels(di_levels), m_nentries(0)
+  : m_voc(NULL), m_use_di(use_di), m_dilevels(di_levels), m_pool(NULL),
+    m_nentries(0), m_prefilter_anchors(0), m_weighted_features(0)
 {
 }
 
@@ -369,7 +875,8 @@ template<class TDescriptor, class F>
 template<class T>
 TemplatedDatabase<TDescriptor, F>::TemplatedDatabase
   (const T &voc, bool use_di, int di_levels)
-  : m_voc(NULL), m_use_di(use_di), m_dilevels(di_levels)
+  : m_voc(NULL), m_use_di(use_di), m_dilevels(di_levels), m_pool(NULL),
+    m_prefilter_anchors(0), m_weighted_features(0)
 {
   setVocabulary(voc);
   clear();
@@ -377,7 +884,7 @@ TemplatedDatabase<TDescriptor, F>::TemplatedDatabase
 
 template<class TDescriptor, class F>
 template<class T>
-TemplatedDatabase<TDescriptor, F>::TemplatedDatabase(const T &voc, std::string &classFile, bool use_di, int di_levels) : m_voc(NULL), m_use_di(use_di), m_dilevels(di_levels)
+TemplatedDatabase<TDescriptor, F>::TemplatedDatabase(const T &voc, std::string &classFile, bool use_di, int di_levels) : m_voc(NULL), m_use_di(use_di), m_dilevels(di_levels), m_pool(NULL), m_prefilter_anchors(0), m_weighted_features(0)
 {
     setVocabulary(voc);
     parseSemanaticClasses(classFile);
@@ -388,7 +895,8 @@ TemplatedDatabase<TDescriptor, F>::TemplatedDatabase(const T &voc, std::string &
 template<class TDescriptor, class F>
 TemplatedDatabase<TDescriptor,F>::TemplatedDatabase
   (const TemplatedDatabase<TDescriptor,F> &db)
-  : m_voc(NULL)
+  : m_voc(NULL), m_pool(NULL), m_prefilter_anchors(0),
+    m_weighted_features(0)
 {
   *this = db;
 }
@@ -398,7 +906,8 @@ TemplatedDatabase<TDescriptor,F>::TemplatedDatabase
 template<class TDescriptor, class F>
 TemplatedDatabase<TDescriptor, F>::TemplatedDatabase
   (const std::string &filename)
-  : m_voc(NULL)
+  : m_voc(NULL), m_pool(NULL), m_prefilter_anchors(0),
+    m_weighted_features(0)
 {
   load(filename);
 }
@@ -408,7 +917,8 @@ TemplatedDatabase<TDescriptor, F>::TemplatedDatabase
 template<class TDescriptor, class F>
 TemplatedDatabase<TDescriptor, F>::TemplatedDatabase
   (const char *filename)
-  : m_voc(NULL)
+  : m_voc(NULL), m_pool(NULL), m_prefilter_anchors(0),
+    m_weighted_features(0)
 {
   load(filename);
 }
@@ -419,6 +929,8 @@ template<class TDescriptor, class F>
 TemplatedDatabase<TDescriptor, F>::~TemplatedDatabase(void)
 {
   delete m_voc;
+  m_ifile.clear(); // the postings must go back to the pool before deleting it
+  delete m_pool;
 }
 
 // --------------------------------------------------------------------------
@@ -429,12 +941,28 @@ TemplatedDatabase<TDescriptor,F>& TemplatedDatabase<TDescriptor,F>::operator=
 {
   if(this != &db)
   {
+    // setting the vocabulary clears the database, so it goes first
+    setVocabulary(*db.m_voc);
+
     m_dfile = db.m_dfile;
+    m_dclasses = db.m_dclasses;
     m_dilevels = db.m_dilevels;
-    m_ifile = db.m_ifile;
     m_nentries = db.m_nentries;
     m_use_di = db.m_use_di;
-    setVocabulary(*db.m_voc);
+    m_classes = db.m_classes;
+    m_ranking = db.m_ranking;
+    m_signatures = db.m_signatures;
+    m_entry_classes = db.m_entry_classes;
+    m_prefilter_anchors = db.m_prefilter_anchors;
+    m_dropped_features = db.m_dropped_features;
+    m_weighted_features = db.m_weighted_features;
+
+    // the rows are copied one by one so that they keep the pool of this
+    // database
+    for(size_t i = 0; i < m_ifile.size() && i < db.m_ifile.size(); ++i)
+      m_ifile[i].assign(db.m_ifile[i].begin(), db.m_ifile[i].end());
+
+    setAllocationPolicy(db.getAllocationPolicy());
   }
   return *this;
 }
@@ -445,11 +973,31 @@ template<class TDescriptor, class F>
 EntryId TemplatedDatabase<TDescriptor, F>::add(
   const std::vector<TDescriptor> &features,
   BowVector *bowvec, FeatureVector *fvec)
+{
+  TransformContext ctx;
+  return add(features, ctx, bowvec, fvec);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+EntryId TemplatedDatabase<TDescriptor, F>::add(
+  const std::vector<TDescriptor> &features, TransformContext &ctx,
+  BowVector *bowvec, FeatureVector *fvec)
 {
   BowVector aux;
   BowVector& v = (bowvec ? *bowvec : aux);
 
-  if(m_use_di && fvec != NULL)
+  std::vector<int> classes;
+  getSemanticClasses(features, classes);
+
+  if(!classes.empty())
+  {
+    // the word of each feature is needed to give classes to the words
+    m_voc->transform(features, ctx, m_dilevels);
+    return addSemantic(ctx, &classes[0], classes.size(), v, fvec);
+  }
+  else if(m_use_di && fvec != NULL)
   {
     m_voc->transform(features, v, *fvec, m_dilevels); // with features
     return add(v, *fvec);
@@ -465,11 +1013,6 @@ EntryId TemplatedDatabase<TDescriptor, F>::add(
     m_voc->transform(features, v, *fvec, m_dilevels); // with features
     return add(v);
   }
-  else if(F::isSemantic()) // Semantic features
-  {
-    m_voc->transform(features, v); // with features
-    return add(v, features);
-  }
   else
   {
     m_voc->transform(features, v); // with features
@@ -483,23 +1026,151 @@ template<class TDescriptor, class F>
 EntryId TemplatedDatabase<TDescriptor, F>::add(const BowVector &v,
   const std::vector<TDescriptor> &features)
 {
-  EntryId entry_id = m_nentries++;
+  TransformContext ctx;
+  return add(v, features, ctx);
+}
 
-  BowVector::const_iterator vit;
-  // update inverted file
-  int feature_idx = 0;
-  for(vit = v.begin(); vit != v.end(); ++vit)
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+EntryId TemplatedDatabase<TDescriptor, F>::add(const BowVector &v,
+  const std::vector<TDescriptor> &features, TransformContext &ctx)
+{
+  if(!DescriptorTraits<F>::is_semantic) return add(v);
+
+  std::vector<int> classes;
+  getSemanticClasses(features, classes);
+  if(classes.empty()) return add(v);
+
+  m_voc->transform(features, ctx, m_dilevels);
+
+  FeatureVector fv;
+  if(m_use_di) ctx.toFeatureVector(fv);
+
+  return addEntry(v, m_use_di ? &fv : NULL, &classes[0], classes.size(),
+    &ctx);
+}
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+inline void TemplatedDatabase<TDescriptor, F>::getSemanticClasses(
+  const std::vector<TDescriptor> &features, std::vector<int> &classes)
+{
+  getSemanticClasses(features, classes, SemanticFeatures());
+}
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+template<class T>
+void TemplatedDatabase<TDescriptor, F>::getSemanticClasses(
+  const std::vector<T> &features, std::vector<int> &classes,
+  std::true_type)
+{
+  classes.resize(features.size());
+  for(size_t i = 0; i < features.size(); ++i)
+    classes[i] = features[i].second;
+}
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+template<class T>
+void TemplatedDatabase<TDescriptor, F>::getSemanticClasses(
+  const std::vector<T> &, std::vector<int> &classes,
+  std::false_type)
+{
+  classes.clear();
+}
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+EntryId TemplatedDatabase<TDescriptor, F>::add(const cv::Mat &descriptors,
+  const int *classes, BowVector *bowvec, FeatureVector *fvec)
+{
+  TransformContext ctx;
+  return add(descriptors, classes, ctx, bowvec, fvec);
+}
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+EntryId TemplatedDatabase<TDescriptor, F>::add(const cv::Mat &descriptors,
+  const int *classes, TransformContext &ctx, BowVector *bowvec,
+  FeatureVector *fvec)
+{
+  BowVector aux;
+  BowVector& v = (bowvec ? *bowvec : aux);
+
+  if(classes)
   {
-    const WordId& word_id = vit->first;
-    const WordValue& word_weight = vit->second;
+    m_voc->transform(descriptors, ctx, m_dilevels, classes);
+    return addSemantic(ctx, classes, descriptors.rows, v, fvec);
+  }
+  else if(m_use_di && fvec != NULL)
+  {
+    m_voc->transform(descriptors, v, *fvec, m_dilevels);
+    return add(v, *fvec);
+  }
+  else if(m_use_di)
+  {
+    FeatureVector fv;
+    m_voc->transform(descriptors, v, fv, m_dilevels);
+    return add(v, fv);
+  }
+  else if(fvec != NULL)
+  {
+    m_voc->transform(descriptors, v, *fvec, m_dilevels);
+  }
+  else
+  {
+    m_voc->transform(descriptors, v);
+  }
 
-    int semanticClass = F::isSemantic() ? features[feature_idx++].second : -1;
+  return add(v);
+}
 
-    IFRow& ifrow = m_ifile[word_id];
-    ifrow.emplace_back(entry_id, word_weight, semanticClass);
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::getWordClasses(const BowVector &vec,
+  const TransformContext &ctx, const int *classes,
+  std::vector<int> &word_classes)
+{
+  std::vector<int> ctx_classes;
+  ctx.wordClasses(classes, ctx_classes);
+
+  // vec and the words of ctx are both sorted by word id. They are the same
+  // words if vec comes from the features of ctx
+  const TransformContext::Words &words = ctx.words();
+  word_classes.assign(vec.size(), 0);
+
+  size_t i = 0, j = 0;
+  BowVector::const_iterator vit;
+  for(vit = vec.begin(); vit != vec.end(); ++vit, ++i)
+  {
+    while(j < words.size() && words[j].first < vit->first) ++j;
+    if(j < words.size() && words[j].first == vit->first)
+      word_classes[i] = ctx_classes[j];
   }
+}
 
-  return entry_id;
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+EntryId TemplatedDatabase<TDescriptor, F>::addSemantic(
+  const TransformContext &ctx, const int *classes, size_t n, BowVector &v,
+  FeatureVector *fvec)
+{
+  ctx.toBowVector(v);
+
+  FeatureVector aux;
+  FeatureVector *fv = (fvec ? fvec : &aux);
+  if(m_use_di || fvec) ctx.toFeatureVector(*fv);
+
+  return addEntry(v, m_use_di ? fv : NULL, classes, n, &ctx);
 }
 
 // ---------------------------------------------------------------------------
@@ -508,33 +1179,88 @@ template<class TDescriptor, class F>
 EntryId TemplatedDatabase<TDescriptor, F>::add(const BowVector &v,
   const FeatureVector &fv)
 {
+  return addEntry(v, &fv, NULL, 0, NULL);
+}
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+EntryId TemplatedDatabase<TDescriptor, F>::addEntry(const BowVector &v,
+  const FeatureVector *fv, const int *classes, size_t n,
+  const TransformContext *ctx)
+{
+  // map the classes first: registering a class may throw, and that must
+  // not leave an entry without postings behind. The class of each word is
+  // one of its features', so it is already registered afterwards
+  std::vector<SemanticClasses::Index> slots;
+  std::vector<SemanticClasses::Index> word_slots;
+  if(classes)
+  {
+    slots.resize(n);
+    for(size_t i = 0; i < n; ++i) slots[i] = m_classes.insert(classes[i]);
+
+    std::vector<int> word_classes;
+    getWordClasses(v, *ctx, classes, word_classes);
+    word_slots.resize(word_classes.size());
+    for(size_t i = 0; i < word_classes.size(); ++i)
+      word_slots[i] = m_classes.insert(word_classes[i]);
+  }
+
   EntryId entry_id = m_nentries++;
 
   BowVector::const_iterator vit;
 
+  std::vector<SemanticClasses::Index> present;
+  for(size_t i = 0; i < slots.size(); ++i)
+  {
+    // the vocabulary left out the features of classes of weight 0, such
+    // as dynamic objects, so they do not count in the signature either
+    const WordValue w = m_voc->getClassWeight(classes[i]);
+    if(w <= 0)
+    {
+      if(m_dropped_features.size() <= slots[i])
+        m_dropped_features.resize(slots[i] + 1, 0);
+      ++m_dropped_features[slots[i]];
+      continue;
+    }
+    else if(w < 1) ++m_weighted_features;
+
+    if(slots[i] != SemanticClasses::NO_CLASS &&
+      slots[i] != SemanticClasses::UNKNOWN_CLASS) present.push_back(slots[i]);
+  }
+
+  setEntryClasses(entry_id, present);
+
   if(m_use_di)
   {
-    // update direct file
+    // update direct file, keeping the class of each feature
     if(entry_id == m_dfile.size())
     {
-      m_dfile.push_back(fv);
+      m_dfile.push_back(fv ? *fv : FeatureVector());
+      m_dclasses.push_back(std::vector<SemanticClasses::Index>());
     }
     else
     {
-      m_dfile[entry_id] = fv;
+      m_dfile[entry_id] = (fv ? *fv : FeatureVector());
+      m_dclasses.resize(m_dfile.size());
     }
+    m_dclasses[entry_id].swap(slots);
   }
-  
+
   // update inverted file
-  for(vit = v.begin(); vit != v.end(); ++vit)
+  size_t i = 0;
+  for(vit = v.begin(); vit != v.end(); ++vit, ++i)
   {
     const WordId& word_id = vit->first;
     const WordValue& word_weight = vit->second;
-    
+
+    const SemanticClasses::Index semanticClass = (word_slots.empty() ?
+      SemanticClasses::NO_CLASS : word_slots[i]);
+
     IFRow& ifrow = m_ifile[word_id];
-    ifrow.push_back(IFPair(entry_id, word_weight));
+    ifrow.push_back(IFPair(entry_id, word_weight, semanticClass));
   }
-  
+
   return entry_id;
 }
 
@@ -547,19 +1273,27 @@ inline void TemplatedDatabase<TDescriptor, F>::setVocabulary
 {
   delete m_voc;
   m_voc = new T(voc);
+  updateClassWeights();
   clear();
 }
 
 template<class TDescriptor, class F>
 inline void TemplatedDatabase<TDescriptor, F>::parseSemanaticClasses(const std::string &classFile)
 {
-    std::ifstream f(classFile);
-    json data = json::parse(f);
-    json categories = data["categories"];
-    for ( auto &category: categories )
-    {
-        m_semantic_class_map[category["id"]] = category["is_anchor"];
-    }
+  m_classes.load(classFile);
+  updateClassWeights();
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::updateClassWeights()
+{
+  if(!m_voc) return;
+
+  std::vector<float> weights;
+  m_classes.getFeatureWeights(weights);
+  m_voc->setClassWeights(weights);
 }
 
 // --------------------------------------------------------------------------
@@ -573,6 +1307,7 @@ inline void TemplatedDatabase<TDescriptor, F>::setVocabulary
   m_dilevels = di_levels;
   delete m_voc;
   m_voc = new T(voc);
+  updateClassWeights();
   clear();
 }
 
@@ -592,13 +1327,50 @@ inline void TemplatedDatabase<TDescriptor, F>::clear()
 {
   // resize vectors
   m_ifile.resize(0);
-  m_ifile.resize(m_voc->size());
+  if(m_pool) m_pool->purge();
+  m_ifile.resize(m_voc->size(), IFRow(PoolAllocator<IFPair>(m_pool)));
   m_dfile.resize(0);
+  m_dclasses.resize(0);
+  m_signatures.resize(0);
+  m_entry_classes.resize(0);
+  m_dropped_features.clear();
+  m_weighted_features = 0;
   m_nentries = 0;
 }
 
 // --------------------------------------------------------------------------
 
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::setAllocationPolicy(
+  AllocationPolicy policy)
+{
+  if(policy == HEAP_ALLOCATION && !m_pool) return;
+
+  // std::list nodes hold two pointers besides the posting
+  SlabPool *pool = NULL;
+  if(policy == ARENA_ALLOCATION)
+    pool = new SlabPool(sizeof(IFPair) + 2 * sizeof(void*));
+
+  // move the postings to the new rows, in word order
+  InvertedFile ifile;
+  ifile.reserve(m_ifile.size());
+
+  typename InvertedFile::const_iterator iit;
+  for(iit = m_ifile.begin(); iit != m_ifile.end(); ++iit)
+  {
+    ifile.push_back(IFRow(PoolAllocator<IFPair>(pool)));
+    ifile.back().assign(iit->begin(), iit->end());
+  }
+
+  m_ifile.swap(ifile);
+  ifile.clear();
+
+  delete m_pool;
+  m_pool = pool;
+}
+
+// --------------------------------------------------------------------------
+
 template<class TDescriptor, class F>
 void TemplatedDatabase<TDescriptor, F>::allocate(int nd, int ni)
 {
@@ -620,6 +1392,7 @@ void TemplatedDatabase<TDescriptor, F>::allocate(int nd, int ni)
   if(m_use_di && (int)m_dfile.size() < nd)
   {
     m_dfile.resize(nd);
+    m_dclasses.resize(nd);
   }
 }
 
@@ -653,10 +1426,76 @@ template<class TDescriptor, class F>
 void TemplatedDatabase<TDescriptor, F>::query(
   const std::vector<TDescriptor> &features,
   QueryResults &ret, int max_results, int max_id) const
+{
+  TransformContext ctx;
+  query(features, ctx, ret, max_results, max_id);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::query(
+  const std::vector<TDescriptor> &features, TransformContext &ctx,
+  QueryResults &ret, int max_results, int max_id) const
 {
   BowVector vec;
-  m_voc->transform(features, vec);
-  query(vec, features, ret, max_results, max_id);
+
+  // only the L1 query weights the semantic classes
+  std::vector<int> classes;
+  if(DescriptorTraits<F>::is_semantic && m_voc->getScoringType() == L1_NORM)
+    getSemanticClasses(features, classes);
+
+  if(classes.empty())
+  {
+    m_voc->transform(features, vec);
+    query(vec, (const int*)NULL, ret, max_results, max_id);
+  }
+  else
+  {
+    m_voc->transform(features, ctx);
+    ctx.toBowVector(vec);
+
+    std::vector<int> word_classes;
+    getWordClasses(vec, ctx, &classes[0], word_classes);
+    query(vec, word_classes.empty() ? NULL : &word_classes[0], ret,
+      max_results, max_id);
+  }
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::query(const cv::Mat &descriptors,
+  const int *classes, QueryResults &ret, int max_results, int max_id) const
+{
+  TransformContext ctx;
+  query(descriptors, classes, ctx, ret, max_results, max_id);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::query(const cv::Mat &descriptors,
+  const int *classes, TransformContext &ctx, QueryResults &ret,
+  int max_results, int max_id) const
+{
+  BowVector vec;
+
+  if(!classes || m_voc->getScoringType() != L1_NORM)
+  {
+    m_voc->transform(descriptors, vec, classes);
+    query(vec, (const int*)NULL, ret, max_results, max_id);
+  }
+  else
+  {
+    m_voc->transform(descriptors, ctx, 0, classes);
+    ctx.toBowVector(vec);
+
+    std::vector<int> word_classes;
+    getWordClasses(vec, ctx, classes, word_classes);
+    query(vec, word_classes.empty() ? NULL : &word_classes[0], ret,
+      max_results, max_id);
+  }
 }
 
 // --------------------------------------------------------------------------
@@ -666,13 +1505,51 @@ void TemplatedDatabase<TDescriptor, F>::query(
   const BowVector &vec,
   const std::vector<TDescriptor> &features, QueryResults &ret,
   int max_results, int max_id) const
+{
+  TransformContext ctx;
+  query(vec, features, ctx, ret, max_results, max_id);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::query(
+  const BowVector &vec, const std::vector<TDescriptor> &features,
+  TransformContext &ctx, QueryResults &ret, int max_results,
+  int max_id) const
+{
+  // only the L1 query weights the semantic classes
+  std::vector<int> classes;
+  if(DescriptorTraits<F>::is_semantic && m_voc->getScoringType() == L1_NORM)
+    getSemanticClasses(features, classes);
+
+  if(classes.empty())
+  {
+    query(vec, (const int*)NULL, ret, max_results, max_id);
+    return;
+  }
+
+  // the features are quantized again to know the word of each one
+  m_voc->transform(features, ctx);
+
+  std::vector<int> word_classes;
+  getWordClasses(vec, ctx, &classes[0], word_classes);
+  query(vec, word_classes.empty() ? NULL : &word_classes[0], ret,
+    max_results, max_id);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::query(const BowVector &vec,
+  const int *classes, QueryResults &ret, int max_results, int max_id) const
 {
   ret.resize(0);
 
   switch(m_voc->getScoringType())
   {
     case L1_NORM:
-      queryL1(vec, features, ret, max_results, max_id);
+      queryL1(vec, classes, ret, max_results, max_id);
       break;
 
     case L2_NORM:
@@ -699,33 +1576,127 @@ void TemplatedDatabase<TDescriptor, F>::query(
 
 // --------------------------------------------------------------------------
 
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::getShortlist(const BowVector &vec,
+  const int *word_classes, std::vector<unsigned char> &shortlist) const
+{
+  uint64_t anchors = 0;
+  std::vector<SemanticClasses::Index> query_anchors;
+  for(size_t i = 0; i < vec.size(); ++i)
+  {
+    const SemanticClasses::Index c = m_classes.index(word_classes[i]);
+    if(m_classes.isAnchor(c))
+    {
+      anchors |= SemanticClasses::signature(c);
+      query_anchors.push_back(c);
+    }
+  }
+
+  shortlist.clear();
+  if(anchors == 0) return;
+
+  std::sort(query_anchors.begin(), query_anchors.end());
+  query_anchors.erase(std::unique(query_anchors.begin(),
+    query_anchors.end()), query_anchors.end());
+
+  // with at most 64 classes, each one has its own bit and the signatures
+  // count the shared anchors. Otherwise, they only discard the entries
+  // without any of them, and the classes of the rest are intersected
+  const bool exact_bits = (m_classes.size() - 2 <= 64);
+
+  // a scan of 8 bytes per entry, cheaper than scoring the entries
+  shortlist.resize(m_signatures.size());
+  for(size_t i = 0; i < m_signatures.size(); ++i)
+  {
+    const uint64_t common = m_signatures[i] & anchors;
+
+    int shared;
+    if(common == 0)
+      shared = 0;
+    else if(exact_bits)
+      shared = (int)std::bitset<64>(common).count();
+    else
+    {
+      const std::vector<SemanticClasses::Index> &classes =
+        m_entry_classes[i];
+
+      shared = 0;
+      std::vector<SemanticClasses::Index>::const_iterator qit, cit;
+      qit = query_anchors.begin();
+      cit = classes.begin();
+      while(qit != query_anchors.end() && cit != classes.end())
+      {
+        if(*qit < *cit) ++qit;
+        else if(*cit < *qit) ++cit;
+        else
+        {
+          ++shared;
+          ++qit;
+          ++cit;
+        }
+      }
+    }
+
+    shortlist[i] = (shared >= m_prefilter_anchors ? 1 : 0);
+  }
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::setEntryClasses(EntryId entry_id,
+  std::vector<SemanticClasses::Index> &classes)
+{
+  std::sort(classes.begin(), classes.end());
+  classes.erase(std::unique(classes.begin(), classes.end()), classes.end());
+
+  uint64_t signature = 0;
+  for(size_t i = 0; i < classes.size(); ++i)
+    signature |= SemanticClasses::signature(classes[i]);
+
+  if(m_signatures.size() <= entry_id)
+  {
+    m_signatures.resize(entry_id + 1);
+    m_entry_classes.resize(entry_id + 1);
+  }
+  m_signatures[entry_id] = signature;
+  m_entry_classes[entry_id].swap(classes);
+}
+
+// --------------------------------------------------------------------------
+
 template<class TDescriptor, class F>
 void TemplatedDatabase<TDescriptor, F>::queryL1(const BowVector &vec,
-  const std::vector<TDescriptor> &features, QueryResults &ret,
-  int max_results, int max_id) const
+  const int *word_classes, QueryResults &ret, int max_results, int max_id)
+  const
 {
   BowVector::const_iterator vit;
   typename IFRow::const_iterator rit;
 
-  std::map<EntryId, double> pairs;
-  std::map<EntryId, double>::iterator pit;
-  std::map<EntryId, std::pair<double, int>> semanticPairs;
+  // appearance and semantic scores are accumulated in the same pass
+  std::map<EntryId, L1Score> scores;
+  typename std::map<EntryId, L1Score>::const_iterator sit;
 
-  double classMismatchPentaly = -2;
-  double classMatchMultiplier = 2;
-  double anchorMatchMultiplier = 5;
+  // entries that pass the semantic filter (empty: all)
+  std::vector<unsigned char> shortlist;
+  if(word_classes && m_prefilter_anchors > 0)
+    getShortlist(vec, word_classes, shortlist);
+
+  int word_idx = 0;
+  DBOW2_PROFILE(QueryProfile profile;
+    const QueryProfile::Clock::time_point start = QueryProfile::Clock::now();)
 
-  int feature_idx = 0;
   for(vit = vec.begin(); vit != vec.end(); ++vit)
   {
     const WordId word_id = vit->first;
     const WordValue& qvalue = vit->second;
 
-    int qSemanticClass = features[feature_idx++].second;
-    bool qIsAnchor = m_semantic_class_map.count(qSemanticClass) > 0 ?
-        m_semantic_class_map.at(qSemanticClass) : false;
+    const SemanticClasses::Index qSemanticClass =
+      (word_classes ? m_classes.index(word_classes[word_idx++]) :
+        SemanticClasses::NO_CLASS);
 
     const IFRow& row = m_ifile[word_id];
+    DBOW2_PROFILE(profile.addRow(word_id, row.size());)
 
     // IFRows are sorted in ascending entry_id order
 
@@ -734,69 +1705,68 @@ void TemplatedDatabase<TDescriptor, F>::queryL1(const BowVector &vec,
       const EntryId entry_id = rit->entry_id;
       const WordValue& dvalue = rit->word_weight;
 
-      int dbSemanticClass = rit->semanticClass;
+      const SemanticClasses::Index dbSemanticClass = rit->semanticClass;
 
-      if((int)entry_id < max_id || max_id == -1)
+      if(((int)entry_id < max_id || max_id == -1) &&
+        (shortlist.empty() || shortlist[entry_id]))
       {
         double value = fabs(qvalue - dvalue) - fabs(qvalue) - fabs(dvalue);
-        pairs[entry_id] += value;
+        L1Score &score = scores[entry_id];
+        score.appearance += value;
 
-        // Check if it is a sematic class
-        if ( qSemanticClass > 0 || dbSemanticClass > 0 )
+        // pairs of features without class are not scored; the others are
+        // weighted by the compatibility of their classes (anchor match,
+        // match, same super-category or mismatch)
+        if((qSemanticClass | dbSemanticClass) != SemanticClasses::NO_CLASS)
         {
-            semanticPairs[entry_id].second++;
-
-            // Check if classes match
-            if ( qSemanticClass == dbSemanticClass )
-            {
-                // Check if it is an anchor
-                if(qIsAnchor)
-                {
-                    semanticPairs[entry_id].first += value * anchorMatchMultiplier;
-                }
-                else
-                {
-                    semanticPairs[entry_id].first += value * classMatchMultiplier;
-                }
-            }
-            // if the semantic classes do not match then penalize the score
-            else
-            {
-                semanticPairs[entry_id].first += value * classMismatchPentaly;
-            }
+          DBOW2_PROFILE(++profile.semantic_postings;)
+          score.semantic += value *
+            m_classes.compatibility(qSemanticClass, dbSemanticClass);
+          score.semantic_words++;
         }
       }
 
     } // for each inverted row
   } // for each query word
 
-  // move to vector
-  ret.reserve(pairs.size());
-  for(pit = pairs.begin(); pit != pairs.end(); ++pit)
+  DBOW2_PROFILE(profile.entries = scores.size();
+    profile.accumulation_time = QueryProfile::seconds(start);
+    QueryProfile::Clock::time_point stage = QueryProfile::Clock::now();)
+
+  // move to vector. The appearance scores go from [-2 best .. 0 worst] to
+  // [0 worst .. 1 best]; the semantic agreement is normalized the same way,
+  // so it equals Score if all the words match with multiplier 1
+  ret.reserve(scores.size());
+  for(sit = scores.begin(); sit != scores.end(); ++sit)
   {
-    ret.push_back(Result(pit->first, pit->second));
+    const L1Score &score = sit->second;
+
+    ret.push_back(Result(sit->first, -score.appearance / 2.0,
+      score.semantic_words > 0 ? score.semantic / score.semantic_words : 0));
+    ret.back().FusedScore = m_ranking.appearance * ret.back().Score +
+      m_ranking.semantic * (-score.semantic / 2.0);
   }
 
-  // resulting "scores" are now in [-2 best .. 0 worst]
-  std::sort(ret.begin(), ret.end());
+  DBOW2_PROFILE(profile.semantic_time = QueryProfile::seconds(stage);
+    stage = QueryProfile::Clock::now();)
 
-  // cut vector
-  if(max_results > 0 && (int)ret.size() > max_results)
-    ret.resize(max_results);
+  // only the best max_results entries are sorted
+  bool (*better)(const Result &, const Result &) =
+    (m_ranking.semantic != 0 ? &Result::gtFused : &Result::gt);
 
-  // Normalize feature score and semantic scores keep them separate for now
-  QueryResults::iterator qit;
-  for(qit = ret.begin(); qit != ret.end(); qit++)
+  if(max_results > 0 && (int)ret.size() > max_results)
   {
-    qit->Score = -qit->Score/2.0;
-    EntryId entry_id = qit->Id;
-    // Check if the entry_id exists in the semanticPairs map
-    if ( semanticPairs.count(entry_id) > 0 )
-    {
-        double final_score = semanticPairs[entry_id].first / semanticPairs[entry_id].second;
-        qit->SemanticScore = final_score;
-    }
+    std::partial_sort(ret.begin(), ret.begin() + max_results, ret.end(),
+      better);
+    ret.resize(max_results);
   }
+  else
+    std::sort(ret.begin(), ret.end(), better);
+
+  DBOW2_PROFILE(profile.sort_time = QueryProfile::seconds(stage);)
+
+  DBOW2_PROFILE(profile.total_time = QueryProfile::seconds(start);
+    m_profiler.record(profile);)
 }
 
 // --------------------------------------------------------------------------
@@ -814,12 +1784,16 @@ void TemplatedDatabase<TDescriptor, F>::queryL2(const BowVector &vec,
   //map<EntryId, int> counters;
   //map<EntryId, int>::iterator cit;
 
+  DBOW2_PROFILE(QueryProfile profile;
+    const QueryProfile::Clock::time_point start = QueryProfile::Clock::now();)
+
   for(vit = vec.begin(); vit != vec.end(); ++vit)
   {
     const WordId word_id = vit->first;
     const WordValue& qvalue = vit->second;
 
     const IFRow& row = m_ifile[word_id];
+    DBOW2_PROFILE(profile.addRow(word_id, row.size());)
 
     // IFRows are sorted in ascending entry_id order
 
@@ -852,6 +1826,10 @@ void TemplatedDatabase<TDescriptor, F>::queryL2(const BowVector &vec,
     } // for each inverted row
   } // for each query word
 
+  DBOW2_PROFILE(profile.entries = pairs.size();
+    profile.accumulation_time = QueryProfile::seconds(start);
+    QueryProfile::Clock::time_point stage = QueryProfile::Clock::now();)
+
   // move to vector
   ret.reserve(pairs.size());
   //cit = counters.begin();
@@ -870,6 +1848,8 @@ void TemplatedDatabase<TDescriptor, F>::queryL2(const BowVector &vec,
   if(max_results > 0 && (int)ret.size() > max_results)
     ret.resize(max_results);
 
+  DBOW2_PROFILE(profile.sort_time = QueryProfile::seconds(stage);)
+
   // complete and scale score to [0 worst .. 1 best]
   // ||v - w||_{L2} = sqrt( 2 - 2 * Sum(v_i * w_i)
 	//		for all i | v_i != 0 and w_i != 0 )
@@ -885,6 +1865,8 @@ void TemplatedDatabase<TDescriptor, F>::queryL2(const BowVector &vec,
       // value = - qvalue * dvalue
   }
 
+  DBOW2_PROFILE(profile.total_time = QueryProfile::seconds(start);
+    m_profiler.record(profile);)
 }
 
 // --------------------------------------------------------------------------
@@ -907,12 +1889,16 @@ void TemplatedDatabase<TDescriptor, F>::queryChiSquare(const BowVector &vec,
   //map<EntryId, double> expected;
   //map<EntryId, double>::iterator eit;
 
+  DBOW2_PROFILE(QueryProfile profile;
+    const QueryProfile::Clock::time_point start = QueryProfile::Clock::now();)
+
   for(vit = vec.begin(); vit != vec.end(); ++vit)
   {
     const WordId word_id = vit->first;
     const WordValue& qvalue = vit->second;
 
     const IFRow& row = m_ifile[word_id];
+    DBOW2_PROFILE(profile.addRow(word_id, row.size());)
 
     // IFRows are sorted in ascending entry_id order
 
@@ -957,6 +1943,10 @@ void TemplatedDatabase<TDescriptor, F>::queryChiSquare(const BowVector &vec,
     } // for each inverted row
   } // for each query word
 
+  DBOW2_PROFILE(profile.entries = pairs.size();
+    profile.accumulation_time = QueryProfile::seconds(start);
+    QueryProfile::Clock::time_point stage = QueryProfile::Clock::now();)
+
   // move to vector
   ret.reserve(pairs.size());
   sit = sums.begin();
@@ -986,6 +1976,8 @@ void TemplatedDatabase<TDescriptor, F>::queryChiSquare(const BowVector &vec,
   if(max_results > 0 && (int)ret.size() > max_results)
     ret.resize(max_results);
 
+  DBOW2_PROFILE(profile.sort_time = QueryProfile::seconds(stage);)
+
   // complete and scale score to [0 worst .. 1 best]
   QueryResults::iterator qit;
   for(qit = ret.begin(); qit != ret.end(); qit++)
@@ -996,6 +1988,8 @@ void TemplatedDatabase<TDescriptor, F>::queryChiSquare(const BowVector &vec,
     qit->chiScore = qit->Score;
   }
 
+  DBOW2_PROFILE(profile.total_time = QueryProfile::seconds(start);
+    m_profiler.record(profile);)
 }
 
 // --------------------------------------------------------------------------
@@ -1010,12 +2004,16 @@ void TemplatedDatabase<TDescriptor, F>::queryKL(const BowVector &vec,
   std::map<EntryId, double> pairs;
   std::map<EntryId, double>::iterator pit;
 
+  DBOW2_PROFILE(QueryProfile profile;
+    const QueryProfile::Clock::time_point start = QueryProfile::Clock::now();)
+
   for(vit = vec.begin(); vit != vec.end(); ++vit)
   {
     const WordId word_id = vit->first;
     const WordValue& vi = vit->second;
 
     const IFRow& row = m_ifile[word_id];
+    DBOW2_PROFILE(profile.addRow(word_id, row.size());)
 
     // IFRows are sorted in ascending entry_id order
 
@@ -1075,6 +2073,10 @@ void TemplatedDatabase<TDescriptor, F>::queryKL(const BowVector &vec,
     ret.push_back(Result(pit->first, pit->second));
   }
 
+  DBOW2_PROFILE(profile.entries = pairs.size();
+    profile.accumulation_time = QueryProfile::seconds(start);
+    QueryProfile::Clock::time_point stage = QueryProfile::Clock::now();)
+
   // real scores are now in [0 best .. X worst]
 
   // sort vector in ascending order
@@ -1085,8 +2087,12 @@ void TemplatedDatabase<TDescriptor, F>::queryKL(const BowVector &vec,
   if(max_results > 0 && (int)ret.size() > max_results)
     ret.resize(max_results);
 
+  DBOW2_PROFILE(profile.sort_time = QueryProfile::seconds(stage);)
+
   // cannot scale scores
 
+  DBOW2_PROFILE(profile.total_time = QueryProfile::seconds(start);
+    m_profiler.record(profile);)
 }
 
 // --------------------------------------------------------------------------
@@ -1104,12 +2110,16 @@ void TemplatedDatabase<TDescriptor, F>::queryBhattacharyya(
   std::map<EntryId, std::pair<double, int> > pairs; // <eid, <score, counter> >
   std::map<EntryId, std::pair<double, int> >::iterator pit;
 
+  DBOW2_PROFILE(QueryProfile profile;
+    const QueryProfile::Clock::time_point start = QueryProfile::Clock::now();)
+
   for(vit = vec.begin(); vit != vec.end(); ++vit)
   {
     const WordId word_id = vit->first;
     const WordValue& qvalue = vit->second;
 
     const IFRow& row = m_ifile[word_id];
+    DBOW2_PROFILE(profile.addRow(word_id, row.size());)
 
     // IFRows are sorted in ascending entry_id order
 
@@ -1139,6 +2149,10 @@ void TemplatedDatabase<TDescriptor, F>::queryBhattacharyya(
     } // for each inverted row
   } // for each query word
 
+  DBOW2_PROFILE(profile.entries = pairs.size();
+    profile.accumulation_time = QueryProfile::seconds(start);
+    QueryProfile::Clock::time_point stage = QueryProfile::Clock::now();)
+
   // move to vector
   ret.reserve(pairs.size());
   for(pit = pairs.begin(); pit != pairs.end(); ++pit)
@@ -1160,6 +2174,9 @@ void TemplatedDatabase<TDescriptor, F>::queryBhattacharyya(
   if(max_results > 0 && (int)ret.size() > max_results)
     ret.resize(max_results);
 
+  DBOW2_PROFILE(profile.sort_time = QueryProfile::seconds(stage);
+    profile.total_time = QueryProfile::seconds(start);
+    m_profiler.record(profile);)
 }
 
 // ---------------------------------------------------------------------------
@@ -1174,12 +2191,16 @@ void TemplatedDatabase<TDescriptor, F>::queryDotProduct(
   std::map<EntryId, double> pairs;
   std::map<EntryId, double>::iterator pit;
 
+  DBOW2_PROFILE(QueryProfile profile;
+    const QueryProfile::Clock::time_point start = QueryProfile::Clock::now();)
+
   for(vit = vec.begin(); vit != vec.end(); ++vit)
   {
     const WordId word_id = vit->first;
     const WordValue& qvalue = vit->second;
 
     const IFRow& row = m_ifile[word_id];
+    DBOW2_PROFILE(profile.addRow(word_id, row.size());)
 
     // IFRows are sorted in ascending entry_id order
 
@@ -1211,6 +2232,10 @@ void TemplatedDatabase<TDescriptor, F>::queryDotProduct(
     } // for each inverted row
   } // for each query word
 
+  DBOW2_PROFILE(profile.entries = pairs.size();
+    profile.accumulation_time = QueryProfile::seconds(start);
+    QueryProfile::Clock::time_point stage = QueryProfile::Clock::now();)
+
   // move to vector
   ret.reserve(pairs.size());
   for(pit = pairs.begin(); pit != pairs.end(); ++pit)
@@ -1227,7 +2252,244 @@ void TemplatedDatabase<TDescriptor, F>::queryDotProduct(
   if(max_results > 0 && (int)ret.size() > max_results)
     ret.resize(max_results);
 
+  DBOW2_PROFILE(profile.sort_time = QueryProfile::seconds(stage);)
+
   // these scores cannot be scaled
+
+  DBOW2_PROFILE(profile.total_time = QueryProfile::seconds(start);
+    m_profiler.record(profile);)
+}
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+DatabaseStats TemplatedDatabase<TDescriptor, F>::computeStats(
+  size_t top_words) const
+{
+  DatabaseStats stats;
+
+  // list nodes hold two pointers besides the element, and tree nodes three
+  // pointers and the color
+  const size_t list_node = 2 * sizeof(void*);
+  const size_t tree_node = 4 * sizeof(void*);
+  // IFPair::semanticClass
+  const size_t semantic_field = sizeof(SemanticClasses::Index);
+
+  // inverted file
+  std::vector<unsigned long> lengths(m_ifile.size());
+  for(WordId wid = 0; wid < m_ifile.size(); ++wid)
+  {
+    lengths[wid] = m_ifile[wid].size();
+    stats.postings += lengths[wid];
+    stats.posting_lengths.add(lengths[wid]);
+  }
+  stats.findHeaviestWords(lengths, top_words);
+
+  // features left out by the class weights
+  for(size_t i = 0; i < m_dropped_features.size(); ++i)
+  {
+    if(m_dropped_features[i] == 0) continue;
+    stats.dropped_features += m_dropped_features[i];
+    stats.dropped_classes.push_back(std::make_pair(
+      (int)m_classes.getClass((SemanticClasses::Index)i).id,
+      m_dropped_features[i]));
+  }
+  stats.sortDroppedClasses();
+  stats.weighted_features = m_weighted_features;
+
+  stats.inverted_file = m_ifile.size() * sizeof(IFRow) +
+    stats.postings * (sizeof(IFPair) - semantic_field + list_node);
+
+  // direct file
+  typename DirectFile::const_iterator dit;
+  FeatureVector::const_iterator fit;
+  for(dit = m_dfile.begin(); dit != m_dfile.end(); ++dit)
+  {
+    stats.direct_file += sizeof(FeatureVector) +
+      dit->size() * (tree_node + sizeof(FeatureVector::value_type));
+
+    for(fit = dit->begin(); fit != dit->end(); ++fit)
+      stats.direct_file += fit->second.capacity() * sizeof(unsigned int);
+  }
+
+  // semantic data
+  stats.semantic = stats.postings * semantic_field + m_classes.bytes() +
+    m_dclasses.capacity() * sizeof(typename DirectClasses::value_type);
+
+  typename DirectClasses::const_iterator cit;
+  for(cit = m_dclasses.begin(); cit != m_dclasses.end(); ++cit)
+    stats.semantic += cit->capacity() * sizeof(SemanticClasses::Index);
+
+  stats.semantic += m_signatures.capacity() * sizeof(uint64_t) +
+    m_entry_classes.capacity() * sizeof(typename DirectClasses::value_type);
+  for(cit = m_entry_classes.begin(); cit != m_entry_classes.end(); ++cit)
+    stats.semantic += cit->capacity() * sizeof(SemanticClasses::Index);
+
+  // overhead
+  stats.overhead = sizeof(*this) +
+    (m_ifile.capacity() - m_ifile.size()) * sizeof(IFRow) +
+    (m_dfile.capacity() - m_dfile.size()) * sizeof(FeatureVector);
+
+  return stats;
+}
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+VocabularyStats TemplatedDatabase<TDescriptor, F>::computeVocabularyStats()
+  const
+{
+  VocabularyStats stats = m_voc->computeStats();
+
+  // an entry appears once in the row of each of its words
+  std::vector<double> frequency;
+  frequency.reserve(m_ifile.size());
+
+  typename InvertedFile::const_iterator iit;
+  for(iit = m_ifile.begin(); iit != m_ifile.end(); ++iit)
+    frequency.push_back(iit->size());
+
+  stats.word_frequency.compute(frequency);
+  return stats;
+}
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+unsigned int TemplatedDatabase<TDescriptor, F>::pruneVocabulary(
+  unsigned int target_words, VocabularyRemap *remap)
+{
+  // entries where each word occurs
+  std::vector<double> frequency(m_ifile.size());
+  for(size_t wid = 0; wid < m_ifile.size(); ++wid)
+    frequency[wid] = m_ifile[wid].size();
+
+  VocabularyRemap table;
+  const unsigned int removed = m_voc->prune(frequency, target_words, table);
+  remapEntries(table, m_voc->size());
+
+  if(remap) *remap = table;
+  return removed;
+}
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+template<class T>
+void TemplatedDatabase<TDescriptor, F>::setPrunedVocabulary(const T &voc,
+  const VocabularyRemap &remap)
+{
+  if(remap.words.size() != m_voc->size() || remap.prunedWords() > voc.size())
+  {
+    std::stringstream ss;
+    ss << "The remap table maps " << remap.words.size() << " words to "
+      << remap.prunedWords() << ", but the vocabularies have "
+      << m_voc->size() << " and " << voc.size();
+    throw ss.str();
+  }
+
+  remapEntries(remap, voc.size());
+
+  delete m_voc;
+  m_voc = new T(voc);
+  updateClassWeights();
+}
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::remapEntries(
+  const VocabularyRemap &remap, unsigned int words)
+{
+  if(remap.words.size() != m_ifile.size() || remap.prunedWords() > words)
+    throw std::string("The remap table does not match the vocabulary");
+
+  // direct index, by the nodes that took the features
+  DirectFile dfile(m_dfile.size());
+  for(size_t eid = 0; eid < m_dfile.size(); ++eid)
+  {
+    FeatureVector::const_iterator fit;
+    for(fit = m_dfile[eid].begin(); fit != m_dfile[eid].end(); ++fit)
+    {
+      if(fit->first >= remap.nodes.size())
+        throw std::string("The remap table does not match the direct index");
+
+      std::vector<unsigned int> &features =
+        dfile[eid][remap.nodes[fit->first]];
+      features.insert(features.end(), fit->second.begin(), fit->second.end());
+    }
+
+    FeatureVector::iterator it;
+    for(it = dfile[eid].begin(); it != dfile[eid].end(); ++it)
+      std::sort(it->second.begin(), it->second.end());
+  }
+
+  // postings, by the words that took them
+  std::vector<std::vector<WordId> > sources(words);
+  for(WordId wid = 0; wid < remap.words.size(); ++wid)
+    sources[remap.words[wid]].push_back(wid);
+
+  InvertedFile ifile(words, IFRow(PoolAllocator<IFPair>(m_pool)));
+  std::vector<IFPair> postings;
+
+  for(WordId wid = 0; wid < words; ++wid)
+  {
+    const std::vector<WordId> &src = sources[wid];
+    if(src.size() == 1)
+    {
+      ifile[wid].assign(m_ifile[src[0]].begin(), m_ifile[src[0]].end());
+      continue;
+    }
+
+    postings.clear();
+    for(size_t i = 0; i < src.size(); ++i)
+      postings.insert(postings.end(), m_ifile[src[i]].begin(),
+        m_ifile[src[i]].end());
+
+    std::stable_sort(postings.begin(), postings.end(),
+      [](const IFPair &a, const IFPair &b)
+      { return a.entry_id < b.entry_id; });
+
+    // an entry gets the sum of its weights and the class of its heaviest
+    // posting
+    for(size_t i = 0; i < postings.size(); )
+    {
+      IFPair merged = postings[i];
+      WordValue heaviest = postings[i].word_weight;
+
+      for(++i; i < postings.size() &&
+        postings[i].entry_id == merged.entry_id; ++i)
+      {
+        merged.word_weight += postings[i].word_weight;
+        if(postings[i].word_weight > heaviest)
+        {
+          heaviest = postings[i].word_weight;
+          merged.semanticClass = postings[i].semanticClass;
+        }
+      }
+
+      ifile[wid].push_back(merged);
+    }
+  }
+
+  m_ifile.swap(ifile);
+  m_dfile.swap(dfile);
+}
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+QueryProfiler TemplatedDatabase<TDescriptor, F>::getQueryProfiler() const
+{
+  return m_profiler;
+}
+
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::clearQueryProfiler()
+{
+  m_profiler.clear();
 }
 
 // ---------------------------------------------------------------------------
@@ -1240,6 +2502,18 @@ const FeatureVector& TemplatedDatabase<TDescriptor, F>::retrieveFeatures
   return m_dfile[id];
 }
 
+// ---------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+const std::vector<SemanticClasses::Index>&
+TemplatedDatabase<TDescriptor, F>::retrieveClasses(EntryId id) const
+{
+  assert(id < size());
+
+  static const std::vector<SemanticClasses::Index> none;
+  return (id < m_dclasses.size() ? m_dclasses[id] : none);
+}
+
 // --------------------------------------------------------------------------
 
 template<class TDescriptor, class F>
@@ -1270,6 +2544,7 @@ void TemplatedDatabase<TDescriptor, F>::save(cv::FileStorage &fs,
   //        {
   //          imageId:
   //          weight:
+  //          class: (only if the feature has a semantic class)
   //        }
   //     ]
   //   ]
@@ -1282,10 +2557,31 @@ void TemplatedDatabase<TDescriptor, F>::save(cv::FileStorage &fs,
   //        }
   //      ]
   //   ]
+  //   directClasses
+  //   [
+  //     [ ]
+  //   ]
+  //   entryClasses
+  //   [
+  //     [ ]
+  //   ]
+  //   weightedFeatures:
+  //   droppedFeatures
+  //   [
+  //     {
+  //       class:
+  //       features:
+  //     }
+  //   ]
 
   // invertedIndex[i] is for the i-th word
   // directIndex[i] is for the i-th entry
   // directIndex may be empty if not using direct index
+  // directClasses[i] has the class id of each feature of the i-th entry, or
+  // is empty if the entry has no semantic classes
+  // entryClasses[i] has the distinct class ids of the features of the i-th
+  // entry that were not dropped (see setSemanticPrefilter)
+  // weightedFeatures and droppedFeatures are the counters of computeStats
   //
   // imageId's and nodeId's must be stored in ascending order
   // (according to the construction of the indexes)
@@ -1309,8 +2605,10 @@ void TemplatedDatabase<TDescriptor, F>::save(cv::FileStorage &fs,
     {
       fs << "{:"
         << "imageId" << (int)irit->entry_id
-        << "weight" << irit->word_weight
-        << "}";
+        << "weight" << irit->word_weight;
+      if(irit->semanticClass != SemanticClasses::NO_CLASS)
+        fs << "class" << (int)m_classes.getClass(irit->semanticClass).id;
+      fs << "}";
     }
     fs << "]"; // word of IF
   }
@@ -1345,6 +2643,47 @@ void TemplatedDatabase<TDescriptor, F>::save(cv::FileStorage &fs,
 
   fs << "]"; // directIndex
 
+  fs << "directClasses" << "[";
+
+  typename DirectClasses::const_iterator cit;
+  for(cit = m_dclasses.begin(); cit != m_dclasses.end(); ++cit)
+  {
+    std::vector<int> ids(cit->size());
+    for(size_t i = 0; i < cit->size(); ++i)
+      ids[i] = m_classes.getClass((*cit)[i]).id;
+
+    fs << "[" << ids << "]";
+  }
+
+  fs << "]"; // directClasses
+
+  fs << "entryClasses" << "[";
+
+  for(cit = m_entry_classes.begin(); cit != m_entry_classes.end(); ++cit)
+  {
+    std::vector<int> ids(cit->size());
+    for(size_t i = 0; i < cit->size(); ++i)
+      ids[i] = m_classes.getClass((*cit)[i]).id;
+
+    fs << "[" << ids << "]";
+  }
+
+  fs << "]"; // entryClasses
+
+  fs << "weightedFeatures" << (int)m_weighted_features;
+  fs << "droppedFeatures" << "[";
+
+  for(size_t i = 0; i < m_dropped_features.size(); ++i)
+  {
+    if(m_dropped_features[i] == 0) continue;
+    fs << "{:"
+      << "class" << (int)m_classes.getClass((SemanticClasses::Index)i).id
+      << "features" << (int)m_dropped_features[i]
+      << "}";
+  }
+
+  fs << "]"; // droppedFeatures
+
   fs << "}"; // database
 }
 
@@ -1379,6 +2718,7 @@ void TemplatedDatabase<TDescriptor, F>::load(const cv::FileStorage &fs,
   m_nentries = (int)fdb["nEntries"];
   m_use_di = (int)fdb["usingDI"] != 0;
   m_dilevels = (int)fdb["diLevels"];
+  DirectClasses entry_classes(m_nentries);
 
   cv::FileNode fn = fdb["invertedIndex"];
   for(WordId wid = 0; wid < fn.size(); ++wid)
@@ -1390,7 +2730,14 @@ void TemplatedDatabase<TDescriptor, F>::load(const cv::FileStorage &fs,
       EntryId eid = (int)fw[i]["imageId"];
       WordValue v = fw[i]["weight"];
 
-      m_ifile[wid].push_back(IFPair(eid, v));
+      cv::FileNode fc = fw[i]["class"];
+      const SemanticClasses::Index sc =
+        (fc.empty() ? SemanticClasses::NO_CLASS : m_classes.insert((int)fc));
+
+      m_ifile[wid].push_back(IFPair(eid, v, sc));
+
+      if(entry_classes.size() <= eid) entry_classes.resize(eid + 1);
+      if(sc != SemanticClasses::NO_CLASS) entry_classes[eid].push_back(sc);
     }
   }
 
@@ -1433,8 +2780,334 @@ void TemplatedDatabase<TDescriptor, F>::load(const cv::FileStorage &fs,
         }
       }
     } // for each entry
+
+    // databases saved without classes do not have this node
+    fn = fdb["directClasses"];
+    m_dclasses.resize(m_dfile.size());
+
+    for(EntryId eid = 0; eid < fn.size() && eid < m_dclasses.size(); ++eid)
+    {
+      cv::FileNode fc = fn[eid][0];
+      m_dclasses[eid].reserve(fc.size());
+
+      cv::FileNodeIterator fcit;
+      for(fcit = fc.begin(); fcit != fc.end(); ++fcit)
+      {
+        m_dclasses[eid].push_back(m_classes.insert((int)*fcit));
+        if(m_dclasses[eid].back() != SemanticClasses::NO_CLASS)
+          entry_classes[eid].push_back(m_dclasses[eid].back());
+      }
+    }
   } // if use_id
 
+  // the classes of the entries are rebuilt from the postings and the
+  // direct index if the file does not have them, but without the direct
+  // index this misses the classes that were not the majority of any word
+  fn = fdb["entryClasses"];
+  for(EntryId eid = 0; eid < fn.size() && eid < entry_classes.size(); ++eid)
+  {
+    cv::FileNode fc = fn[eid][0];
+    entry_classes[eid].clear();
+
+    cv::FileNodeIterator fcit;
+    for(fcit = fc.begin(); fcit != fc.end(); ++fcit)
+      entry_classes[eid].push_back(m_classes.insert((int)*fcit));
+  }
+
+  for(EntryId eid = 0; eid < entry_classes.size(); ++eid)
+    setEntryClasses(eid, entry_classes[eid]);
+
+  // databases saved without the counters do not have these nodes
+  cv::FileNode fw = fdb["weightedFeatures"];
+  m_weighted_features = (fw.empty() ? 0 : (unsigned long)(int)fw);
+
+  fn = fdb["droppedFeatures"];
+  for(unsigned int i = 0; i < fn.size(); ++i)
+  {
+    const SemanticClasses::Index c = m_classes.insert((int)fn[i]["class"]);
+    if(m_dropped_features.size() <= c) m_dropped_features.resize(c + 1, 0);
+    m_dropped_features[c] += (unsigned long)(int)fn[i]["features"];
+  }
+
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::saveBundle(
+  const std::string &filename, bool with_entries) const
+{
+  BundleWriter writer;
+
+  std::ostringstream vocabulary;
+  m_voc->saveBinary(vocabulary);
+  writer.add(Bundle::VOCABULARY, vocabulary.str());
+
+  std::ostringstream classes;
+  m_classes.saveBinary(classes);
+  writer.add(Bundle::CLASSES, classes.str());
+
+  if(with_entries)
+  {
+    std::ostringstream entries;
+    saveBinary(entries);
+    writer.add(Bundle::DATABASE, entries.str());
+  }
+
+  writer.write(filename);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::loadBundle(const std::string &filename)
+{
+  Bundle bundle(filename);
+  loadBundle(bundle);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::loadBundle(const Bundle &bundle)
+{
+  // the sections are parsed into another database, so that a failure does
+  // not leave the vocabulary of the bundle beside the old entries
+  TemplatedDatabase<TDescriptor, F> db(m_use_di, m_dilevels);
+  db.m_voc = new TemplatedVocabulary<TDescriptor, F>;
+  db.m_voc->loadBinary(bundle.section(Bundle::VOCABULARY));
+
+  if(bundle.has(Bundle::CLASSES))
+    db.m_classes.loadBinary(bundle.section(Bundle::CLASSES));
+  db.updateClassWeights();
+
+  if(bundle.has(Bundle::DATABASE))
+    db.loadBinary(bundle.section(Bundle::DATABASE));
+  else
+    db.clear();
+
+  // the postings keep their pool, and this database its allocation policy
+  const AllocationPolicy policy = getAllocationPolicy();
+
+  std::swap(m_voc, db.m_voc);
+  std::swap(m_classes, db.m_classes);
+  std::swap(m_use_di, db.m_use_di);
+  std::swap(m_dilevels, db.m_dilevels);
+  std::swap(m_nentries, db.m_nentries);
+  std::swap(m_pool, db.m_pool);
+  m_ifile.swap(db.m_ifile);
+  m_dfile.swap(db.m_dfile);
+  m_dclasses.swap(db.m_dclasses);
+  m_signatures.swap(db.m_signatures);
+  m_entry_classes.swap(db.m_entry_classes);
+  m_dropped_features.swap(db.m_dropped_features);
+  std::swap(m_weighted_features, db.m_weighted_features);
+
+  setAllocationPolicy(policy);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::saveBinary(std::ostream &out) const
+{
+  // Format:
+  // nEntries, usingDI, diLevels, number of words: uint32
+  // inverted file, for each word:
+  //   number of postings: uint32
+  //   postings: entry id (uint32), class slot (uint16), padding (uint16),
+  //     weight (double)
+  // classes of each entry (see m_entry_classes):
+  //   number of classes: uint32
+  //   class slots: uint16
+  // features indexed with a class weight below 1: uint64
+  // features dropped by class: number of slots (uint32), count of each
+  //   slot (uint64)
+  // direct file, if usingDI, for each entry:
+  //   number of nodes: uint32
+  //   nodes: node id, number of features, feature indexes: uint32
+  //   number of features with class: uint32
+  //   class slot of each feature: uint16
+
+  BundleSection::write(out, (uint32_t)m_nentries);
+  BundleSection::write(out, (uint32_t)(m_use_di ? 1 : 0));
+  BundleSection::write(out, (int32_t)m_dilevels);
+  BundleSection::write(out, (uint32_t)m_ifile.size());
+
+  typename InvertedFile::const_iterator iit;
+  for(iit = m_ifile.begin(); iit != m_ifile.end(); ++iit)
+  {
+    BundleSection::write(out, (uint32_t)iit->size());
+
+    typename IFRow::const_iterator rit;
+    for(rit = iit->begin(); rit != iit->end(); ++rit)
+    {
+      BundleSection::write(out, (uint32_t)rit->entry_id);
+      BundleSection::write(out, rit->semanticClass);
+      BundleSection::write(out, (uint16_t)0);
+      BundleSection::write(out, (double)rit->word_weight);
+    }
+  }
+
+  for(int i = 0; i < m_nentries; ++i)
+  {
+    static const std::vector<SemanticClasses::Index> none;
+    const std::vector<SemanticClasses::Index> &classes =
+      (i < (int)m_entry_classes.size() ? m_entry_classes[i] : none);
+
+    BundleSection::write(out, (uint32_t)classes.size());
+    if(!classes.empty())
+      out.write(reinterpret_cast<const char*>(&classes[0]),
+        classes.size() * sizeof(SemanticClasses::Index));
+  }
+
+  BundleSection::write(out, (uint64_t)m_weighted_features);
+  BundleSection::write(out, (uint32_t)m_dropped_features.size());
+  for(size_t i = 0; i < m_dropped_features.size(); ++i)
+    BundleSection::write(out, (uint64_t)m_dropped_features[i]);
+
+  if(!m_use_di) return;
+
+  for(int i = 0; i < m_nentries; ++i)
+  {
+    static const FeatureVector no_features;
+    const FeatureVector &fv =
+      (i < (int)m_dfile.size() ? m_dfile[i] : no_features);
+
+    BundleSection::write(out, (uint32_t)fv.size());
+
+    FeatureVector::const_iterator fit;
+    for(fit = fv.begin(); fit != fv.end(); ++fit)
+    {
+      BundleSection::write(out, (uint32_t)fit->first);
+      BundleSection::write(out, (uint32_t)fit->second.size());
+      if(!fit->second.empty())
+        out.write(reinterpret_cast<const char*>(&fit->second[0]),
+          fit->second.size() * sizeof(unsigned int));
+    }
+
+    const std::vector<SemanticClasses::Index> &classes = retrieveClasses(i);
+    BundleSection::write(out, (uint32_t)classes.size());
+    if(!classes.empty())
+      out.write(reinterpret_cast<const char*>(&classes[0]),
+        classes.size() * sizeof(SemanticClasses::Index));
+  }
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedDatabase<TDescriptor, F>::loadBinary(BundleSection section)
+{
+  const uint32_t entries = section.read<uint32_t>();
+  const uint32_t use_di = section.read<uint32_t>();
+  const int32_t di_levels = section.read<int32_t>();
+  const uint32_t words = section.read<uint32_t>();
+
+  if(words != m_voc->size())
+    throw std::string("The database entries belong to another vocabulary");
+
+  clear(); // resizes inverted file
+
+  try
+  {
+    m_nentries = entries;
+    m_use_di = (use_di != 0);
+    m_dilevels = di_levels;
+
+    const size_t nclasses = m_classes.size();
+
+    for(WordId wid = 0; wid < words; ++wid)
+    {
+      IFRow &row = m_ifile[wid];
+      const uint32_t n = section.read<uint32_t>();
+
+      for(uint32_t i = 0; i < n; ++i)
+      {
+        const uint32_t eid = section.read<uint32_t>();
+        const SemanticClasses::Index sc =
+          section.read<SemanticClasses::Index>();
+        section.skip(sizeof(uint16_t));
+        const WordValue weight = section.read<double>();
+
+        if(eid >= entries || sc >= nclasses)
+          throw std::string("Invalid database data");
+
+        row.push_back(IFPair(eid, weight, sc));
+      }
+    }
+
+    m_signatures.reserve(entries);
+    m_entry_classes.reserve(entries);
+    for(uint32_t i = 0; i < entries; ++i)
+    {
+      const uint32_t n = section.read<uint32_t>();
+      const unsigned char *p = section.skip((size_t)n *
+        sizeof(SemanticClasses::Index));
+
+      std::vector<SemanticClasses::Index> classes(n);
+      if(n > 0)
+        std::memcpy(&classes[0], p, n * sizeof(SemanticClasses::Index));
+
+      for(uint32_t j = 0; j < n; ++j)
+        if(classes[j] >= nclasses)
+          throw std::string("Invalid database data");
+
+      setEntryClasses(i, classes);
+    }
+
+    m_weighted_features = (unsigned long)section.read<uint64_t>();
+
+    const uint32_t dropped = section.read<uint32_t>();
+    if(dropped > nclasses) throw std::string("Invalid database data");
+    m_dropped_features.resize(dropped);
+    for(uint32_t i = 0; i < dropped; ++i)
+      m_dropped_features[i] = (unsigned long)section.read<uint64_t>();
+
+    if(m_use_di)
+    {
+      m_dfile.resize(entries);
+      m_dclasses.resize(entries);
+
+      for(uint32_t i = 0; i < entries; ++i)
+      {
+        FeatureVector &fv = m_dfile[i];
+        const uint32_t nodes = section.read<uint32_t>();
+
+        for(uint32_t j = 0; j < nodes; ++j)
+        {
+          const NodeId nid = section.read<uint32_t>();
+          const uint32_t n = section.read<uint32_t>();
+          const unsigned char *p = section.skip((size_t)n *
+            sizeof(unsigned int));
+
+          std::vector<unsigned int> &features = fv.insert(fv.end(),
+            FeatureVector::value_type(nid,
+              std::vector<unsigned int>()))->second;
+          features.resize(n);
+          if(n > 0) std::memcpy(&features[0], p, n * sizeof(unsigned int));
+        }
+
+        const uint32_t n = section.read<uint32_t>();
+        const unsigned char *p = section.skip((size_t)n *
+          sizeof(SemanticClasses::Index));
+
+        std::vector<SemanticClasses::Index> &classes = m_dclasses[i];
+        classes.resize(n);
+        if(n > 0)
+          std::memcpy(&classes[0], p, n * sizeof(SemanticClasses::Index));
+
+        for(uint32_t j = 0; j < n; ++j)
+          if(classes[j] >= nclasses)
+            throw std::string("Invalid database data");
+      }
+    }
+  }
+  catch(...)
+  {
+    clear();
+    throw;
+  }
 }
 
 // --------------------------------------------------------------------------
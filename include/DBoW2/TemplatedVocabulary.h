@@ -11,17 +11,37 @@
 #define __D_T_TEMPLATED_VOCABULARY__
 
 #include <cassert>
+#include <cctype>
+#include <climits>
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <thread>
 #include <vector>
 #include <numeric>
+#include <queue>
 #include <fstream>
+#include <functional>
+#include <ostream>
+#include <sstream>
 #include <string>
 #include <algorithm>
+#include <type_traits>
 #include <opencv2/core.hpp>
 
+#include "Bundle.h"
+#include "DescriptorTraits.h"
 #include "FeatureVector.h"
 #include "BowVector.h"
 #include "ScoringObject.h"
+#include "Allocators.h"
+#include "QuantizationCache.h"
+#include "QuantizedCenters.h"
+#include "TransformContext.h"
+#include "VocabularyStats.h"
+#include "VocabularyRemap.h"
 
 namespace DBoW2 {
 
@@ -133,6 +153,80 @@ public:
   virtual void transform(const std::vector<TDescriptor>& features,
     BowVector &v, FeatureVector &fv, int levelsup) const;
 
+  /**
+   * Transforms a set of descriptors into a bow vector and a feature vector,
+   * resuming the descent of each feature from a hint node, such as the node
+   * the same tracked feature fell in in the previous frame. A hint is
+   * trusted if it is still the closest node among its siblings, so only
+   * the levels below it are visited. Otherwise, the feature is propagated
+   * from the root
+   * @param features
+   * @param hints hints[i] is the hint node of features[i] (0 for no hint).
+   *   It may be shorter than features
+   * @param v (out) bow vector
+   * @param fv (out) feature vector of nodes and feature indexes
+   * @param levelsup levels to go up the vocabulary tree to get the node index
+   * @param new_hints (out) if given, node at level hint_level of each feature,
+   *   to use as hints for the next frame
+   * @param hint_level level of the nodes returned in new_hints. Deeper hints
+   *   save more distance computations but are rejected more often
+   */
+  void transform(const std::vector<TDescriptor>& features,
+    const std::vector<NodeId> &hints, BowVector &v, FeatureVector &fv,
+    int levelsup, std::vector<NodeId> *new_hints = NULL,
+    int hint_level = 2) const;
+
+  /**
+   * Transforms a set of descriptors into a bow vector and a feature vector
+   * stored in the given context. Reusing the context, the transform does
+   * not allocate memory once the context has seen the largest image
+   * @param features
+   * @param ctx (in/out) scratch storage; the result is left in ctx.words()
+   *   and ctx.features()
+   * @param levelsup levels to go up the vocabulary tree to get the node index
+   */
+  void transform(const std::vector<TDescriptor>& features,
+    TransformContext &ctx, int levelsup = 0) const;
+
+  /**
+   * Transforms the rows of a descriptor matrix, such as the one returned by
+   * cv::ORB, into a bow vector. The rows are read in place, without
+   * creating a cv::Mat per descriptor.
+   * Only available for descriptor classes with
+   * DescriptorTraits<F>::has_batch_distance (FORB, FSORB, FBrief)
+   * @param descriptors NxL CV_8U matrix
+   * @param v (out) bow vector
+   * @param classes if given, semantic class of each row, to apply the
+   *   class weights (see setClassWeights)
+   */
+  void transform(const cv::Mat &descriptors, BowVector &v,
+    const int *classes = NULL) const;
+
+  /**
+   * Transforms the rows of a descriptor matrix into a bow vector and a
+   * feature vector. The feature indexes are the row numbers
+   * @param descriptors NxL CV_8U matrix
+   * @param v (out) bow vector
+   * @param fv (out) feature vector of nodes and feature indexes
+   * @param levelsup levels to go up the vocabulary tree to get the node index
+   * @param classes if given, semantic class of each row, to apply the
+   *   class weights (see setClassWeights)
+   */
+  void transform(const cv::Mat &descriptors, BowVector &v, FeatureVector &fv,
+    int levelsup, const int *classes = NULL) const;
+
+  /**
+   * Transforms the rows of a descriptor matrix into a bow vector and a
+   * feature vector stored in the given context
+   * @param descriptors NxL CV_8U matrix
+   * @param ctx (in/out) scratch storage
+   * @param levelsup levels to go up the vocabulary tree to get the node index
+   * @param classes if given, semantic class of each row, to apply the
+   *   class weights (see setClassWeights)
+   */
+  void transform(const cv::Mat &descriptors, TransformContext &ctx,
+    int levelsup = 0, const int *classes = NULL) const;
+
   /**
    * Transforms a single feature into a word (without weight)
    * @param feature
@@ -184,6 +278,32 @@ public:
    */
   float getEffectiveLevels() const;
 
+  /**
+   * Computes statistics of the structure and balance of the tree: branching
+   * per level, depth and weights of the words and the expected cost of
+   * quantizing a descriptor, assuming all the words are equally likely
+   * @return statistics
+   */
+  VocabularyStats computeStats() const;
+
+  /**
+   * Computes the statistics of the tree and the occupancy of its words by
+   * the given training features, which also weights the descent cost
+   * @param training_features features of the training images
+   * @return statistics
+   */
+  VocabularyStats computeStats(
+    const std::vector<std::vector<TDescriptor> > &training_features) const;
+
+  /**
+   * Counts the training features that fall in each word
+   * @param training_features features of the training images
+   * @param occupancy (out) occupancy[wid] = features of word wid
+   */
+  void computeOccupancy(
+    const std::vector<std::vector<TDescriptor> > &training_features,
+    std::vector<double> &occupancy) const;
+
   /**
    * Returns the descriptor of a word
    * @param wid word id
@@ -235,11 +355,41 @@ public:
   void load(const std::string &filename);
 
   /**
-   * Loads the vocabulary from a text file
+   * Loads the vocabulary from a text file in the format of ORB-SLAM
+   * (ORBvoc.txt). The lines of the nodes are parsed in parallel
    * @param filename
+   * @return false if the file cannot be read or is not valid
    */
   bool loadFromTextFile(const std::string &filename);
 
+  /**
+   * Saves the vocabulary to a text file in the format of ORB-SLAM, as read
+   * by loadFromTextFile. The lines of the nodes are written from the node
+   * table in blocks formatted in parallel, with the weights in full
+   * precision
+   * @param filename
+   * @throw std::string if the file cannot be written
+   */
+  void saveToTextFile(const std::string &filename) const;
+
+  /**
+   * Saves the vocabulary to a bundle file with only the VOCABULARY section
+   * (see saveBinary), which is much faster to write and read than the
+   * formats of cv::FileStorage
+   * @param filename
+   * @throw std::string if the file cannot be written or the descriptor
+   *   class has no binary format
+   */
+  void saveToBinaryFile(const std::string &filename) const;
+
+  /**
+   * Loads the vocabulary from a bundle file with a VOCABULARY section, such
+   * as those written by saveToBinaryFile and TemplatedDatabase::saveBundle
+   * @param filename
+   * @throw std::string if the file cannot be read or is not valid
+   */
+  void loadFromBinaryFile(const std::string &filename);
+
   /**
    * Saves the vocabulary to a file storage structure
    * @param fn node in file storage
@@ -256,6 +406,23 @@ public:
   virtual void load(const cv::FileStorage &fs,
     const std::string &name = "vocabulary");
 
+  /**
+   * Writes the vocabulary in the binary format of the bundle sections (see
+   * Bundle). Needs a descriptor class with a known length in bytes (see
+   * DescriptorTraits) and F::toBytes
+   * @param out stream
+   * @throw std::string if the descriptor class has no binary format
+   */
+  void saveBinary(std::ostream &out) const;
+
+  /**
+   * Loads a vocabulary written by saveBinary, such as the VOCABULARY section
+   * of a bundle
+   * @param section data
+   * @throw std::string if the data is not valid
+   */
+  void loadBinary(BundleSection section);
+
   /**
    * Stops those words whose weight is below minWeight.
    * Words are stopped by setting their weight to 0. There are not returned
@@ -270,11 +437,150 @@ public:
    */
   virtual int stopWords(double minWeight);
 
+  /**
+   * Shrinks the vocabulary to at most target_words words. The least used
+   * word is removed repeatedly: its features go to its closest sibling word
+   * or, if it is the last child of its node, the node becomes a word, so
+   * that the subtrees of rarely used words collapse. Nodes and words are
+   * then renumbered in the same order. The weight of a word that takes the
+   * features of others is the lowest of their weights (the idf of the
+   * merged word is at most theirs)
+   * @param usage usage[wid] = how often word wid is used, such as the
+   *   occupancy of the training features (see computeOccupancy) or the
+   *   entries where the word occurs in a database
+   * @param target_words words to keep (at least 1). A word whose siblings
+   *   are all inner nodes is not removed until they collapse, so the target
+   *   may not be reached
+   * @param remap (out) word and node of the pruned vocabulary that stand
+   *   for each word and node of the original one
+   * @return number of words removed
+   * @throw std::string if usage does not have a value per word
+   */
+  unsigned int prune(const std::vector<double> &usage,
+    unsigned int target_words, VocabularyRemap &remap);
+
+  /**
+   * Shrinks the vocabulary by the occupancy of the training features, and
+   * sets the weights of the words from them again
+   * @param training_features features of the training images
+   * @param target_words words to keep
+   * @param remap (out) remap table
+   * @return number of words removed
+   */
+  unsigned int prune(
+    const std::vector<std::vector<TDescriptor> > &training_features,
+    unsigned int target_words, VocabularyRemap &remap);
+
+  /**
+   * Enables a cache of the words assigned to single descriptors, so that
+   * descriptors that were already transformed (e.g. in consecutive frames
+   * of a static scene) are not propagated down the tree again.
+   * The cache is emptied whenever the tree changes
+   * @param capacity maximum number of descriptors to remember
+   */
+  void enableQuantizationCache(size_t capacity = 65536);
+
+  /**
+   * Disables the quantization cache and frees its memory
+   */
+  void disableQuantizationCache();
+
+  /**
+   * Returns the hit and miss counters of the quantization cache
+   * @return statistics (all 0 if the cache is not enabled)
+   */
+  QuantizationCacheStats getQuantizationCacheStats() const;
+
+  /**
+   * Sets where the tree is allocated. With ARENA_ALLOCATION, the links
+   * between nodes are packed into a monotonic arena after the tree is
+   * created or loaded, and released together when it changes
+   * @param policy allocation policy
+   */
+  void setAllocationPolicy(AllocationPolicy policy);
+
+  /**
+   * Returns the allocation policy of the tree
+   * @return allocation policy
+   */
+  inline AllocationPolicy getAllocationPolicy() const
+  {
+    return (m_arena ? ARENA_ALLOCATION : HEAP_ALLOCATION);
+  }
+
+  /**
+   * Sets the precision of the node centers used to propagate features down
+   * the tree. With HALF_PRECISION or INT8_PRECISION, a compact copy of the
+   * centers is made after the tree is created or loaded and the distances
+   * of the descent are computed on it; the nodes keep their full precision
+   * descriptors, which are saved. Only for float descriptors (FFloat)
+   * @param precision
+   * @param exact_leaves if true, the steps of the descent to a set of
+   *   children with some leaf compare full precision descriptors
+   * @throw std::string if the descriptors are not made of floats
+   */
+  void setNodePrecision(NodePrecision precision, bool exact_leaves = true);
+
+  /**
+   * Returns the precision of the node centers used in the descent
+   * @return precision
+   */
+  inline NodePrecision getNodePrecision() const
+  {
+    return (m_quantized ? m_quantized->precision() : FULL_PRECISION);
+  }
+
+  /**
+   * Returns the bytes used by the reduced precision copy of the centers
+   * @return bytes (0 with FULL_PRECISION)
+   */
+  inline size_t getQuantizedCentersSize() const
+  {
+    return (m_quantized ? m_quantized->bytes() : 0);
+  }
+
+  /**
+   * Sets the weight of the features of each semantic class. When a feature
+   * is transformed, the weight of its word is multiplied by the weight of
+   * its class before the vector is normalized, so the words of heavy
+   * classes (e.g. anchors) dominate the vector. Features of classes of
+   * weight 0 are dropped, like the features of stopped words. Classes are
+   * read from semantic features (FSORB) or given with the rows of a
+   * descriptor matrix
+   * @param weights weights[c] is the weight of class c. Classes beyond the
+   *   vector and features without class (c <= 0) have weight 1. An empty
+   *   vector disables the weighting
+   */
+  void setClassWeights(const std::vector<float> &weights);
+
+  /**
+   * Returns the weights of the semantic classes
+   * @return weights by class id (empty if not weighted)
+   */
+  inline const std::vector<float>& getClassWeights() const
+  {
+    return m_class_weights;
+  }
+
+  /**
+   * Returns the weight of the features of a semantic class
+   * @param class_id
+   * @return weight
+   */
+  inline WordValue getClassWeight(int class_id) const
+  {
+    return (class_id > 0 && (size_t)class_id < m_class_weights.size() ?
+      m_class_weights[class_id] : 1.);
+  }
+
 protected:
 
   /// Pointer to descriptor
   typedef const TDescriptor *pDescriptor;
 
+  /// Ids of the children of a node
+  typedef std::vector<NodeId, ArenaAllocator<NodeId> > Children;
+
   /// Tree node
   struct Node
   {
@@ -283,7 +589,7 @@ protected:
     /// Weight if the node is a word
     WordValue weight;
     /// Children
-    std::vector<NodeId> children;
+    Children children;
     /// Parent node (undefined in case of root)
     NodeId parent;
     /// Node descriptor
@@ -344,6 +650,248 @@ protected:
    */
   virtual void transform(const TDescriptor &feature, WordId &id) const;
 
+  /**
+   * Returns the word id associated to a feature, resuming the descent from
+   * a hint node if it is still the closest one among its siblings
+   * @param feature
+   * @param hint node to resume the descent from (0 for no hint)
+   * @param id (out) word id
+   * @param weight (out) word weight
+   * @param nid (out) if given, id of the node "levelsup" levels up
+   * @param levelsup
+   * @param new_hint (out) if given, id of the node at level hint_level
+   * @param hint_level
+   */
+  virtual void transform(const TDescriptor &feature, NodeId hint,
+    WordId &id, WordValue &weight, NodeId *nid, int levelsup,
+    NodeId *new_hint, int hint_level) const;
+
+  /**
+   * Returns the word id associated to a feature given as a descriptor or as
+   * a pointer to its bytes, for which F must provide distance and hash
+   * @param feature
+   * @param id (out) word id
+   * @param weight (out) word weight
+   * @param nid (out) if given, id of the node "levelsup" levels up
+   * @param levelsup
+   */
+  template<class TQuery>
+  void quantize(const TQuery &feature, WordId &id, WordValue &weight,
+    NodeId *nid, int levelsup) const;
+
+  /// Whether F compares the rows of descriptor matrices, as a type
+  typedef std::integral_constant<bool,
+    DescriptorTraits<F>::has_batch_distance> BatchDistance;
+
+  /// Whether the features carry semantic classes, as a type
+  typedef std::integral_constant<bool, DescriptorTraits<F>::is_semantic>
+    SemanticFeatures;
+
+  /**
+   * Returns the weight of the class of a semantic feature. A template, so
+   * that it is only instantiated for semantic features
+   * @param feature
+   * @return class weight
+   */
+  template<class T>
+  inline WordValue classWeight(const T &feature, std::true_type) const
+  {
+    return getClassWeight(feature.second);
+  }
+
+  /**
+   * Returns 1 for features without semantic class
+   * @return 1
+   */
+  template<class T>
+  inline WordValue classWeight(const T &, std::false_type) const
+  {
+    return 1.;
+  }
+
+  /**
+   * Returns whether the class of a feature has weight 0, so that the
+   * feature is left out of the bow vectors without quantizing it
+   * @param feature
+   */
+  inline bool isDropped(const TDescriptor &feature) const
+  {
+    return !m_class_weights.empty() &&
+      classWeight(feature, SemanticFeatures()) <= 0;
+  }
+
+  /**
+   * Returns the word id associated to a row of a descriptor matrix. A
+   * template, so that it is only instantiated if F compares matrix rows
+   * @param descriptors matrix checked by checkDescriptorBlock
+   * @param i row
+   * @param id (out) word id
+   * @param weight (out) word weight
+   * @param nid (out) if given, id of the node "levelsup" levels up
+   * @param levelsup
+   */
+  template<class TMatrix>
+  void quantizeRow(const TMatrix &descriptors, int i, WordId &id,
+    WordValue &weight, NodeId *nid, int levelsup, std::true_type) const;
+
+  /**
+   * Never called: checkDescriptorBlock rejects matrices of descriptors
+   * that F cannot compare in place
+   */
+  template<class TMatrix>
+  void quantizeRow(const TMatrix &descriptors, int i, WordId &id,
+    WordValue &weight, NodeId *nid, int levelsup, std::false_type) const;
+
+  /**
+   * Propagates a feature down the tree until reaching a leaf
+   * @param feature descriptor or pointer to its bytes
+   * @param start node to start from
+   * @return id of the leaf node
+   */
+  template<class TQuery>
+  NodeId descend(const TQuery &feature, NodeId start) const;
+
+  /**
+   * Propagates a float feature down the tree comparing it with the reduced
+   * precision centers
+   * @param feature
+   * @param data floats of the feature
+   * @param start node to start from
+   * @return id of the leaf node
+   */
+  template<class TQuery>
+  NodeId descendQuantized(const TQuery &feature, const float *data,
+    NodeId start) const;
+
+  /**
+   * Makes the reduced precision copy of the node centers
+   * @param precision HALF_PRECISION or INT8_PRECISION
+   */
+  void quantizeCenters(NodePrecision precision);
+
+  /// Whether the descriptors of the text files are written as the values of
+  /// their bytes, so they are parsed with F::fromBytes
+  typedef std::integral_constant<bool, DescriptorTraits<F>::is_binary &&
+    DescriptorTraits<F>::bytes == F::L> ByteTokens;
+
+  /**
+   * Parses the line of a node of a text vocabulary file
+   * @param p first character of the line
+   * @param end end of the line
+   * @param node (out) node whose parent, weight and descriptor are set
+   * @param is_leaf (out) whether the node is a word
+   * @param scratch buffer for the descriptors parsed with F::fromString
+   * @return false if the line is not valid
+   */
+  bool parseTextNode(const char *p, const char *end, Node &node,
+    bool &is_leaf, std::string &scratch) const;
+
+  /**
+   * Parses a descriptor written as the values of its bytes
+   * @param p (in/out) position in the line
+   * @param end end of the line
+   * @param d (out) descriptor
+   * @return false if the descriptor is not valid
+   */
+  template<class T>
+  bool parseTextDescriptor(const char *&p, const char *end, T &d,
+    std::string &, std::true_type) const;
+
+  /**
+   * Parses a descriptor with F::fromString
+   * @param p (in/out) position in the line
+   * @param end end of the line
+   * @param d (out) descriptor
+   * @param scratch buffer for the text of the descriptor
+   * @return false if the line has no descriptor
+   */
+  template<class T>
+  bool parseTextDescriptor(const char *&p, const char *end, T &d,
+    std::string &scratch, std::false_type) const;
+
+  /**
+   * Parses an integer, skipping the blanks before it
+   * @param p (in/out) position in the line, moved past the integer
+   * @param end end of the line
+   * @param value (out)
+   * @return false if there is no integer at p
+   */
+  static bool parseInt(const char *&p, const char *end, int &value);
+
+  /**
+   * Appends the line of a node to a text vocabulary file
+   * @param node
+   * @param out (out) text the line is appended to
+   */
+  void appendTextNode(const Node &node, std::string &out) const;
+
+  /**
+   * Appends a descriptor as the values of its bytes
+   * @param d descriptor
+   * @param out (out) text
+   */
+  template<class T>
+  void appendTextDescriptor(const T &d, std::string &out,
+    std::true_type) const;
+
+  /**
+   * Appends a descriptor with F::toString
+   * @param d descriptor
+   * @param out (out) text
+   */
+  template<class T>
+  void appendTextDescriptor(const T &d, std::string &out,
+    std::false_type) const;
+
+  /**
+   * Returns the number of threads that read or write the lines of the nodes
+   * of a text vocabulary file
+   * @param nodes number of lines
+   * @return number of threads, at least 1
+   */
+  static size_t textThreads(size_t nodes);
+
+  /**
+   * Checks that F compares descriptors in place in the rows of a matrix, and
+   * that the matrix holds one descriptor of DescriptorTraits<F>::bytes per row
+   * @param descriptors
+   * @throw std::string if it does not
+   */
+  void checkDescriptorBlock(const cv::Mat &descriptors) const;
+
+  /**
+   * Checks whether a node is the closest one to a feature among its siblings
+   * @param feature
+   * @param nid node id (must not be the root)
+   * @return true iff descend would choose nid when visiting its parent
+   */
+  bool isClosestChild(const TDescriptor &feature, NodeId nid) const;
+
+  /**
+   * Returns the ancestor of a node at the given level of the tree
+   * @param nid node id
+   * @param level level of the ancestor (root is at level 0)
+   * @param ancestor (out) ancestor id, only set if the node is at level
+   *   "level" or below
+   * @return true iff the ancestor exists
+   */
+  bool getAncestor(NodeId nid, int level, NodeId &ancestor) const;
+
+  /**
+   * Fills the statistics of the tree
+   * @param stats (out) statistics
+   * @param occupancy if given, number of training descriptors of each word
+   */
+  void computeStats(VocabularyStats &stats,
+    const std::vector<double> *occupancy) const;
+
+  /**
+   * Moves the children of all the nodes into the given arena, releasing
+   * their previous memory
+   * @param arena arena, or NULL to use the global allocator
+   */
+  void relocateTree(MonotonicArena *arena);
+
   /**
    * Creates a level in the tree, under the parent, by running kmeans with
    * a descriptor set, and recursively creates the subsequent levels too
@@ -423,6 +971,21 @@ protected:
   /// Object for computing scores
   GeneralScoring* m_scoring_object;
 
+  /// Cache of descriptor assignments (NULL if not enabled)
+  QuantizationCache* m_cache;
+
+  /// Arena of the tree (NULL if using the global allocator)
+  MonotonicArena* m_arena;
+
+  /// Reduced precision centers (NULL if using full precision)
+  QuantizedCenters* m_quantized;
+
+  /// Compare full precision leaves in the last step of the descent
+  bool m_exact_leaves;
+
+  /// Weight of the features of each semantic class (empty: all 1)
+  std::vector<float> m_class_weights;
+
   /// Tree nodes
   std::vector<Node> m_nodes;
 
@@ -438,7 +1001,8 @@ template<class TDescriptor, class F>
 TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
   (int k, int L, WeightingType weighting, ScoringType scoring)
   : m_k(k), m_L(L), m_weighting(weighting), m_scoring(scoring),
-  m_scoring_object(NULL)
+  m_scoring_object(NULL), m_cache(NULL),
+  m_arena(NULL), m_quantized(NULL), m_exact_leaves(true)
 {
   createScoringObject();
 }
@@ -447,7 +1011,8 @@ TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
 
 template<class TDescriptor, class F>
 TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
-  (const std::string &filename): m_scoring_object(NULL)
+  (const std::string &filename): m_scoring_object(NULL), m_cache(NULL),
+  m_arena(NULL), m_quantized(NULL), m_exact_leaves(true)
 {
   load(filename);
 }
@@ -456,7 +1021,8 @@ TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
 
 template<class TDescriptor, class F>
 TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary
-  (const char *filename): m_scoring_object(NULL)
+  (const char *filename): m_scoring_object(NULL), m_cache(NULL),
+  m_arena(NULL), m_quantized(NULL), m_exact_leaves(true)
 {
   load(filename);
 }
@@ -520,7 +1086,8 @@ void TemplatedVocabulary<TDescriptor,F>::setWeightingType(WeightingType type)
 template<class TDescriptor, class F>
 TemplatedVocabulary<TDescriptor,F>::TemplatedVocabulary(
   const TemplatedVocabulary<TDescriptor, F> &voc)
-  : m_scoring_object(NULL)
+  : m_scoring_object(NULL), m_cache(NULL),
+  m_arena(NULL), m_quantized(NULL), m_exact_leaves(true)
 {
   *this = voc;
 }
@@ -531,6 +1098,9 @@ template<class TDescriptor, class F>
 TemplatedVocabulary<TDescriptor,F>::~TemplatedVocabulary()
 {
   delete m_scoring_object;
+  delete m_cache;
+  delete m_arena;
+  delete m_quantized;
 }
 
 // --------------------------------------------------------------------------
@@ -553,6 +1123,19 @@ TemplatedVocabulary<TDescriptor,F>::operator=
   this->m_nodes = voc.m_nodes;
   this->createWords();
 
+  // the copied nodes use the global allocator
+  delete m_arena;
+  m_arena = NULL;
+  setAllocationPolicy(voc.getAllocationPolicy());
+
+  delete m_quantized;
+  m_quantized = (voc.m_quantized ? new QuantizedCenters(*voc.m_quantized) :
+    NULL);
+  m_exact_leaves = voc.m_exact_leaves;
+  m_class_weights = voc.m_class_weights;
+
+  if(m_cache) m_cache->clear();
+
   return *this;
 }
 
@@ -564,6 +1147,7 @@ void TemplatedVocabulary<TDescriptor,F>::create(
 {
   m_nodes.clear();
   m_words.clear();
+  if(m_cache) m_cache->clear();
 
   // expected_nodes = Sum_{i=0..L} ( k^i )
 	int expected_nodes =
@@ -588,6 +1172,8 @@ void TemplatedVocabulary<TDescriptor,F>::create(
   // and set the weight of each node of the tree
   setNodeWeights(training_features);
 
+  if(m_arena) relocateTree(new MonotonicArena);
+  if(m_quantized) quantizeCenters(m_quantized->precision());
 }
 
 // --------------------------------------------------------------------------
@@ -697,6 +1283,10 @@ void TemplatedVocabulary<TDescriptor,F>::HKmeansStep(NodeId parent_id,
 
         for(unsigned int c = 0; c < clusters.size(); ++c)
         {
+          // a cluster may lose all its features when the others move; it
+          // keeps its last center, since the mean of nothing is undefined
+          if(groups[c].empty()) continue;
+
           std::vector<pDescriptor> cluster_descriptors;
           cluster_descriptors.reserve(groups[c].size());
 
@@ -800,7 +1390,7 @@ void TemplatedVocabulary<TDescriptor,F>::HKmeansStep(NodeId parent_id,
   if(current_level < m_L)
   {
     // iterate again with the resulting clusters
-    const std::vector<NodeId> &children_ids = m_nodes[parent_id].children;
+    const Children &children_ids = m_nodes[parent_id].children;
     for(unsigned int i = 0; i < clusters.size(); ++i)
     {
       NodeId id = children_ids[i];
@@ -1035,66 +1625,197 @@ float TemplatedVocabulary<TDescriptor,F>::getEffectiveLevels() const
 // --------------------------------------------------------------------------
 
 template<class TDescriptor, class F>
-TDescriptor TemplatedVocabulary<TDescriptor,F>::getWord(WordId wid) const
+VocabularyStats TemplatedVocabulary<TDescriptor,F>::computeStats() const
 {
-  return m_words[wid]->descriptor;
+  VocabularyStats stats;
+  computeStats(stats, NULL);
+  return stats;
 }
 
 // --------------------------------------------------------------------------
 
 template<class TDescriptor, class F>
-WordValue TemplatedVocabulary<TDescriptor, F>::getWordWeight(WordId wid) const
+VocabularyStats TemplatedVocabulary<TDescriptor,F>::computeStats(
+  const std::vector<std::vector<TDescriptor> > &training_features) const
 {
-  return m_words[wid]->weight;
+  std::vector<double> occupancy;
+  computeOccupancy(training_features, occupancy);
+
+  VocabularyStats stats;
+  computeStats(stats, &occupancy);
+  return stats;
 }
 
 // --------------------------------------------------------------------------
 
 template<class TDescriptor, class F>
-WordId TemplatedVocabulary<TDescriptor, F>::transform
-  (const TDescriptor& feature) const
+void TemplatedVocabulary<TDescriptor,F>::computeOccupancy(
+  const std::vector<std::vector<TDescriptor> > &training_features,
+  std::vector<double> &occupancy) const
 {
-  if(empty())
+  occupancy.assign(m_words.size(), 0);
+  if(m_words.empty()) return;
+
+  typename std::vector<std::vector<TDescriptor> >::const_iterator vvit;
+  typename std::vector<TDescriptor>::const_iterator vit;
+  for(vvit = training_features.begin(); vvit != training_features.end();
+    ++vvit)
   {
-    return 0;
+    for(vit = vvit->begin(); vit != vvit->end(); ++vit)
+      occupancy[transform(*vit)] += 1;
   }
-
-  WordId wid;
-  transform(feature, wid);
-  return wid;
 }
 
 // --------------------------------------------------------------------------
 
 template<class TDescriptor, class F>
-void TemplatedVocabulary<TDescriptor,F>::transform(
-  const std::vector<TDescriptor>& features, BowVector &v) const
+void TemplatedVocabulary<TDescriptor,F>::computeStats(VocabularyStats &stats,
+  const std::vector<double> *occupancy) const
 {
-  v.clear();
-
-  if(empty())
+  stats = VocabularyStats();
+  stats.k = m_k;
+  stats.L = m_L;
+  stats.nodes = m_nodes.size();
+  stats.words = m_words.size();
+  if(m_words.empty()) return;
+
+  // depth and descent cost (distances computed to reach it) of each node,
+  // visiting the tree in breadth-first order
+  std::vector<int> depth(m_nodes.size(), 0);
+  std::vector<double> cost(m_nodes.size(), 0);
+  std::vector<std::vector<double> > branching;
+
+  std::vector<NodeId> queue(1, 0);
+  for(size_t i = 0; i < queue.size(); ++i)
   {
-    return;
-  }
-
-  // normalize
-  LNorm norm;
-  bool must = m_scoring_object->mustNormalize(norm);
+    const Node &node = m_nodes[queue[i]];
+    const int d = depth[node.id];
 
-  typename std::vector<TDescriptor>::const_iterator fit;
+    if((int)stats.levels.size() <= d)
+    {
+      stats.levels.resize(d + 1);
+      branching.resize(d + 1);
+    }
 
-  if(m_weighting == TF || m_weighting == TF_IDF)
-  {
-    for(fit = features.begin(); fit < features.end(); ++fit)
+    ++stats.levels[d].nodes;
+    if(node.isLeaf())
     {
-      WordId id;
-      WordValue w;
-      // w is the idf value if TF_IDF, 1 if TF
+      if(node.id != 0) ++stats.levels[d].leaves;
+      continue;
+    }
 
-      transform(*fit, id, w);
+    branching[d].push_back(node.children.size());
 
-      // not stopped
-      if(w > 0) v.addWeight(id, w);
+    typename Children::const_iterator cit;
+    for(cit = node.children.begin(); cit != node.children.end(); ++cit)
+    {
+      depth[*cit] = d + 1;
+      cost[*cit] = cost[node.id] + node.children.size();
+      queue.push_back(*cit);
+    }
+  }
+
+  for(size_t d = 0; d < branching.size(); ++d)
+    stats.levels[d].branching.compute(branching[d]);
+
+  // words
+  std::vector<double> depths, weights;
+  depths.reserve(m_words.size());
+  weights.reserve(m_words.size());
+
+  double sum_cost = 0, total = 0;
+  for(WordId wid = 0; wid < m_words.size(); ++wid)
+  {
+    const NodeId nid = m_words[wid]->id;
+    depths.push_back(depth[nid]);
+    weights.push_back(m_words[wid]->weight);
+
+    const double w = (occupancy ? (*occupancy)[wid] : 1.);
+    sum_cost += w * cost[nid];
+    total += w;
+  }
+
+  stats.word_depth.compute(depths);
+  stats.idf.compute(weights);
+
+  if(total > 0) stats.descent_cost = sum_cost / total;
+  if(m_k > 1)
+    stats.ideal_descent_cost = m_k *
+      std::max(1., log((double)m_words.size()) / log((double)m_k));
+
+  if(occupancy)
+  {
+    std::vector<double> aux = *occupancy;
+    stats.empty_words = std::count(aux.begin(), aux.end(), 0.);
+    stats.occupancy.compute(aux);
+  }
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+TDescriptor TemplatedVocabulary<TDescriptor,F>::getWord(WordId wid) const
+{
+  return m_words[wid]->descriptor;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+WordValue TemplatedVocabulary<TDescriptor, F>::getWordWeight(WordId wid) const
+{
+  return m_words[wid]->weight;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+WordId TemplatedVocabulary<TDescriptor, F>::transform
+  (const TDescriptor& feature) const
+{
+  if(empty())
+  {
+    return 0;
+  }
+
+  WordId wid;
+  transform(feature, wid);
+  return wid;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::transform(
+  const std::vector<TDescriptor>& features, BowVector &v) const
+{
+  v.clear();
+
+  if(empty())
+  {
+    return;
+  }
+
+  // normalize
+  LNorm norm;
+  bool must = m_scoring_object->mustNormalize(norm);
+
+  typename std::vector<TDescriptor>::const_iterator fit;
+
+  if(m_weighting == TF || m_weighting == TF_IDF)
+  {
+    for(fit = features.begin(); fit < features.end(); ++fit)
+    {
+      if(isDropped(*fit)) continue;
+
+      WordId id;
+      WordValue w;
+      // w is the idf value if TF_IDF, 1 if TF
+
+      transform(*fit, id, w);
+
+      // not stopped
+      if(w > 0) v.addWeight(id, w);
     }
 
     //if(!v.empty() && !must)
@@ -1122,7 +1843,7 @@ void TemplatedVocabulary<TDescriptor,F>::transform(
   //  } // if add_features
   //} // if m_weighting == ...
 
-  // TODO Nate: Need to pass the features and normalize with anchor and non anchor features
+  // the weights of the semantic classes were applied by transform(feature)
   if(must) v.normalize(norm);
 }
 
@@ -1152,6 +1873,8 @@ void TemplatedVocabulary<TDescriptor,F>::transform(
     unsigned int i_feature = 0;
     for(fit = features.begin(); fit < features.end(); ++fit, ++i_feature)
     {
+      if(isDropped(*fit)) continue;
+
       WordId id;
       NodeId nid;
       WordValue w;
@@ -1180,6 +1903,8 @@ void TemplatedVocabulary<TDescriptor,F>::transform(
     unsigned int i_feature = 0;
     for(fit = features.begin(); fit < features.end(); ++fit, ++i_feature)
     {
+      if(isDropped(*fit)) continue;
+
       WordId id;
       NodeId nid;
       WordValue w;
@@ -1200,6 +1925,281 @@ void TemplatedVocabulary<TDescriptor,F>::transform(
 
 // --------------------------------------------------------------------------
 
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::transform(
+  const std::vector<TDescriptor>& features, const std::vector<NodeId> &hints,
+  BowVector &v, FeatureVector &fv, int levelsup,
+  std::vector<NodeId> *new_hints, int hint_level) const
+{
+  v.clear();
+  fv.clear();
+  if(new_hints) new_hints->assign(features.size(), 0);
+
+  if(empty()) // safe for subclasses
+  {
+    return;
+  }
+
+  // normalize
+  LNorm norm;
+  bool must = m_scoring_object->mustNormalize(norm);
+
+  const bool tf = (m_weighting == TF || m_weighting == TF_IDF);
+
+  for(unsigned int i_feature = 0; i_feature < features.size(); ++i_feature)
+  {
+    if(isDropped(features[i_feature])) continue;
+
+    WordId id;
+    NodeId nid;
+    WordValue w;
+    // w is the idf value if TF_IDF, 1 if TF, idf if IDF, or 1 if BINARY
+
+    const NodeId hint = (i_feature < hints.size() ? hints[i_feature] : 0);
+
+    transform(features[i_feature], hint, id, w, &nid, levelsup,
+      (new_hints ? &(*new_hints)[i_feature] : NULL), hint_level);
+
+    if(w > 0) // not stopped
+    {
+      if(tf) v.addWeight(id, w);
+      else v.addIfNotExist(id, w);
+      fv.addFeature(nid, i_feature);
+    }
+  }
+
+  if(tf && !v.empty() && !must)
+  {
+    // unnecessary when normalizing
+    const double nd = v.size();
+    for(BowVector::iterator vit = v.begin(); vit != v.end(); vit++)
+      vit->second /= nd;
+  }
+
+  if(must) v.normalize(norm);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::transform(
+  const std::vector<TDescriptor>& features, TransformContext &ctx,
+  int levelsup) const
+{
+  ctx.clear();
+
+  if(empty()) // safe for subclasses
+  {
+    return;
+  }
+
+  // normalize
+  LNorm norm;
+  bool must = m_scoring_object->mustNormalize(norm);
+
+  for(unsigned int i_feature = 0; i_feature < features.size(); ++i_feature)
+  {
+    if(isDropped(features[i_feature])) continue;
+
+    WordId id;
+    NodeId nid;
+    WordValue w;
+    // w is the idf value if TF_IDF, 1 if TF, idf if IDF, or 1 if BINARY
+
+    transform(features[i_feature], id, w, &nid, levelsup);
+
+    if(w > 0) ctx.add(id, w, nid, i_feature); // not stopped
+  }
+
+  ctx.finish(m_weighting == TF || m_weighting == TF_IDF, must, norm);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::checkDescriptorBlock(
+  const cv::Mat &descriptors) const
+{
+  if(!DescriptorTraits<F>::has_batch_distance)
+    throw std::string("This descriptor class does not read descriptor "
+      "matrices");
+
+  if(!descriptors.empty() && (descriptors.type() != CV_8U ||
+    descriptors.cols != DescriptorTraits<F>::bytes))
+  {
+    std::stringstream ss;
+    ss << "Expected a descriptor matrix of " << DescriptorTraits<F>::bytes
+      << " CV_8U columns, got " << descriptors.cols << " columns of type "
+      << descriptors.type();
+    throw ss.str();
+  }
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+template<class TMatrix>
+inline void TemplatedVocabulary<TDescriptor,F>::quantizeRow(
+  const TMatrix &descriptors, int i, WordId &id, WordValue &weight,
+  NodeId *nid, int levelsup, std::true_type) const
+{
+  quantize(descriptors.template ptr<unsigned char>(i), id, weight, nid,
+    levelsup);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+template<class TMatrix>
+inline void TemplatedVocabulary<TDescriptor,F>::quantizeRow(
+  const TMatrix &, int, WordId &id, WordValue &weight, NodeId *nid, int,
+  std::false_type) const
+{
+  id = 0;
+  weight = 0;
+  if(nid) *nid = 0;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::transform(
+  const cv::Mat &descriptors, BowVector &v, const int *classes) const
+{
+  v.clear();
+
+  if(empty()) // safe for subclasses
+  {
+    return;
+  }
+
+  checkDescriptorBlock(descriptors);
+
+  // normalize
+  LNorm norm;
+  bool must = m_scoring_object->mustNormalize(norm);
+
+  const bool tf = (m_weighting == TF || m_weighting == TF_IDF);
+
+  for(int i = 0; i < descriptors.rows; ++i)
+  {
+    WordId id;
+    WordValue w;
+    // w is the idf value if TF_IDF, 1 if TF, idf if IDF, or 1 if BINARY
+
+    // features of classes of weight 0 are not quantized
+    const WordValue class_weight = (classes ? getClassWeight(classes[i]) : 1.);
+    if(class_weight <= 0) continue;
+
+    quantizeRow(descriptors, i, id, w, NULL, 0, BatchDistance());
+    w *= class_weight;
+
+    if(w > 0) // not stopped
+    {
+      if(tf) v.addWeight(id, w);
+      else v.addIfNotExist(id, w);
+    }
+  }
+
+  if(must) v.normalize(norm);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::transform(
+  const cv::Mat &descriptors, BowVector &v, FeatureVector &fv,
+  int levelsup, const int *classes) const
+{
+  v.clear();
+  fv.clear();
+
+  if(empty()) // safe for subclasses
+  {
+    return;
+  }
+
+  checkDescriptorBlock(descriptors);
+
+  // normalize
+  LNorm norm;
+  bool must = m_scoring_object->mustNormalize(norm);
+
+  const bool tf = (m_weighting == TF || m_weighting == TF_IDF);
+
+  for(int i = 0; i < descriptors.rows; ++i)
+  {
+    WordId id;
+    NodeId nid;
+    WordValue w;
+
+    // features of classes of weight 0 are not quantized
+    const WordValue class_weight = (classes ? getClassWeight(classes[i]) : 1.);
+    if(class_weight <= 0) continue;
+
+    quantizeRow(descriptors, i, id, w, &nid, levelsup, BatchDistance());
+    w *= class_weight;
+
+    if(w > 0) // not stopped
+    {
+      if(tf) v.addWeight(id, w);
+      else v.addIfNotExist(id, w);
+      fv.addFeature(nid, i);
+    }
+  }
+
+  if(tf && !v.empty() && !must)
+  {
+    // unnecessary when normalizing
+    const double nd = v.size();
+    for(BowVector::iterator vit = v.begin(); vit != v.end(); vit++)
+      vit->second /= nd;
+  }
+
+  if(must) v.normalize(norm);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::transform(
+  const cv::Mat &descriptors, TransformContext &ctx, int levelsup,
+  const int *classes) const
+{
+  ctx.clear();
+
+  if(empty()) // safe for subclasses
+  {
+    return;
+  }
+
+  checkDescriptorBlock(descriptors);
+
+  // normalize
+  LNorm norm;
+  bool must = m_scoring_object->mustNormalize(norm);
+
+  for(int i = 0; i < descriptors.rows; ++i)
+  {
+    WordId id;
+    NodeId nid;
+    WordValue w;
+
+    // features of classes of weight 0 are not quantized
+    const WordValue class_weight = (classes ? getClassWeight(classes[i]) : 1.);
+    if(class_weight <= 0) continue;
+
+    quantizeRow(descriptors, i, id, w, &nid, levelsup, BatchDistance());
+    w *= class_weight;
+
+    if(w > 0) ctx.add(id, w, nid, i); // not stopped
+  }
+
+  ctx.finish(m_weighting == TF || m_weighting == TF_IDF, must, norm);
+}
+
+// --------------------------------------------------------------------------
+
 template<class TDescriptor, class F>
 inline double TemplatedVocabulary<TDescriptor,F>::score
   (const BowVector &v1, const BowVector &v2) const
@@ -1223,26 +2223,117 @@ template<class TDescriptor, class F>
 void TemplatedVocabulary<TDescriptor,F>::transform(const TDescriptor &feature,
   WordId &word_id, WordValue &weight, NodeId *nid, int levelsup) const
 {
-  // propagate the feature down the tree
-  std::vector<NodeId> nodes;
-  typename std::vector<NodeId>::const_iterator nit;
+  quantize(feature, word_id, weight, nid, levelsup);
+
+  // the vectors of all the transform overloads are weighted here, in the
+  // same pass
+  if(!m_class_weights.empty())
+    weight *= classWeight(feature, SemanticFeatures());
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+template<class TQuery>
+void TemplatedVocabulary<TDescriptor,F>::quantize(const TQuery &feature,
+  WordId &word_id, WordValue &weight, NodeId *nid, int levelsup) const
+{
+  NodeId final_id = 0; // root
+
+  uint64_t key = 0;
+  if(m_cache) key = F::hash(feature);
 
-  // level at which the node must be stored in nid, if given
-  const int nid_level = m_L - levelsup;
-  if(nid_level <= 0 && nid != NULL) *nid = 0; // root
+  if(!m_cache || !m_cache->find(key, final_id))
+  {
+    // propagate the feature down the tree
+    final_id = descend(feature, 0);
+
+    if(m_cache) m_cache->insert(key, final_id);
+  }
+
+  if(nid != NULL)
+  {
+    // level at which the node must be stored in nid
+    const int nid_level = m_L - levelsup;
+    if(nid_level <= 0) *nid = 0; // root
+    else getAncestor(final_id, nid_level, *nid);
+  }
+
+  // turn node id into word id
+  word_id = m_nodes[final_id].word_id;
+  weight = m_nodes[final_id].weight;
+}
+
+// --------------------------------------------------------------------------
 
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::transform(const TDescriptor &feature,
+  NodeId hint, WordId &word_id, WordValue &weight, NodeId *nid, int levelsup,
+  NodeId *new_hint, int hint_level) const
+{
   NodeId final_id = 0; // root
-  int current_level = 0;
 
-  do
+  uint64_t key = 0;
+  if(m_cache) key = F::hash(feature);
+
+  if(!m_cache || !m_cache->find(key, final_id))
   {
-    ++current_level;
-    nodes = m_nodes[final_id].children;
-    final_id = nodes[0];
+    if(hint != 0 && hint < m_nodes.size() && isClosestChild(feature, hint))
+    {
+      // resume the descent from the hint. The result is not cached because
+      // the levels above the hint were not checked
+      final_id = descend(feature, hint);
+    }
+    else
+    {
+      final_id = descend(feature, 0);
+
+      if(m_cache) m_cache->insert(key, final_id);
+    }
+  }
 
+  if(nid != NULL)
+  {
+    const int nid_level = m_L - levelsup;
+    if(nid_level <= 0) *nid = 0; // root
+    else getAncestor(final_id, nid_level, *nid);
+  }
+
+  if(new_hint != NULL)
+  {
+    // leaves above hint_level are good hints too
+    if(hint_level <= 0) *new_hint = 0;
+    else if(!getAncestor(final_id, hint_level, *new_hint)) *new_hint = final_id;
+  }
+
+  word_id = m_nodes[final_id].word_id;
+  weight = m_nodes[final_id].weight;
+
+  if(!m_class_weights.empty())
+    weight *= classWeight(feature, SemanticFeatures());
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+template<class TQuery>
+NodeId TemplatedVocabulary<TDescriptor,F>::descend(const TQuery &feature,
+  NodeId start) const
+{
+  const float *data = FloatView<TQuery>::data(feature);
+  if(m_quantized && data) return descendQuantized(feature, data, start);
+
+  NodeId final_id = start;
+
+  while(!m_nodes[final_id].isLeaf())
+  {
+    const Children &nodes = m_nodes[final_id].children;
+    typename Children::const_iterator nit = nodes.begin();
+
+    final_id = *nit;
     double best_d = F::distance(feature, m_nodes[final_id].descriptor);
 
-    for(nit = nodes.begin() + 1; nit != nodes.end(); ++nit)
+    for(++nit; nit != nodes.end(); ++nit)
     {
       NodeId id = *nit;
       double d = F::distance(feature, m_nodes[id].descriptor);
@@ -1252,15 +2343,113 @@ void TemplatedVocabulary<TDescriptor,F>::transform(const TDescriptor &feature,
         final_id = id;
       }
     }
+  }
 
-    if(nid != NULL && current_level == nid_level)
-      *nid = final_id;
+  return final_id;
+}
 
-  } while( !m_nodes[final_id].isLeaf() );
+// --------------------------------------------------------------------------
 
-  // turn node id into word id
-  word_id = m_nodes[final_id].word_id;
-  weight = m_nodes[final_id].weight;
+template<class TDescriptor, class F>
+template<class TQuery>
+NodeId TemplatedVocabulary<TDescriptor,F>::descendQuantized(
+  const TQuery &feature, const float *data, NodeId start) const
+{
+  QuantizedCenters::Query q;
+  m_quantized->prepare(data, q);
+
+  NodeId final_id = start;
+
+  while(!m_nodes[final_id].isLeaf())
+  {
+    const Children &nodes = m_nodes[final_id].children;
+    typename Children::const_iterator nit = nodes.begin();
+
+    final_id = *nit;
+
+    // leaves and inner nodes can be siblings in unbalanced trees, so the
+    // step is exact if any child is a leaf, whatever the order of children
+    bool exact = false;
+    if(m_exact_leaves)
+    {
+      typename Children::const_iterator cit;
+      for(cit = nodes.begin(); cit != nodes.end() && !exact; ++cit)
+        exact = m_nodes[*cit].isLeaf();
+    }
+
+    if(exact)
+    {
+      // last step: full precision
+      double best_d = F::distance(feature, m_nodes[final_id].descriptor);
+      for(++nit; nit != nodes.end(); ++nit)
+      {
+        double d = F::distance(feature, m_nodes[*nit].descriptor);
+        if(d < best_d)
+        {
+          best_d = d;
+          final_id = *nit;
+        }
+      }
+    }
+    else
+    {
+      float best_d = m_quantized->distance(q, final_id);
+      for(++nit; nit != nodes.end(); ++nit)
+      {
+        float d = m_quantized->distance(q, *nit);
+        if(d < best_d)
+        {
+          best_d = d;
+          final_id = *nit;
+        }
+      }
+    }
+  }
+
+  return final_id;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+bool TemplatedVocabulary<TDescriptor,F>::isClosestChild
+  (const TDescriptor &feature, NodeId nid) const
+{
+  const Children &siblings = m_nodes[m_nodes[nid].parent].children;
+  typename Children::const_iterator nit = siblings.begin();
+
+  // same tie breaking as descend: the first closest child wins
+  NodeId best_id = *nit;
+  double best_d = F::distance(feature, m_nodes[best_id].descriptor);
+
+  for(++nit; nit != siblings.end(); ++nit)
+  {
+    double d = F::distance(feature, m_nodes[*nit].descriptor);
+    if(d < best_d)
+    {
+      best_d = d;
+      best_id = *nit;
+    }
+  }
+
+  return best_id == nid;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+bool TemplatedVocabulary<TDescriptor,F>::getAncestor(NodeId nid, int level,
+  NodeId &ancestor) const
+{
+  int depth = 0;
+  for(NodeId p = nid; p != 0; p = m_nodes[p].parent) ++depth;
+
+  // the node may be above the level if the tree is not balanced
+  if(depth < level) return false;
+
+  for(; depth > level; --depth) nid = m_nodes[nid].parent;
+  ancestor = nid;
+  return true;
 }
 
 // --------------------------------------------------------------------------
@@ -1302,8 +2491,8 @@ void TemplatedVocabulary<TDescriptor,F>::getWordsFromNode
       NodeId parentid = parents.back();
       parents.pop_back();
 
-      const std::vector<NodeId> &child_ids = m_nodes[parentid].children;
-      std::vector<NodeId>::const_iterator cit;
+      const Children &child_ids = m_nodes[parentid].children;
+      typename Children::const_iterator cit;
 
       for(cit = child_ids.begin(); cit != child_ids.end(); ++cit)
       {
@@ -1339,6 +2528,190 @@ int TemplatedVocabulary<TDescriptor,F>::stopWords(double minWeight)
 
 // --------------------------------------------------------------------------
 
+template<class TDescriptor, class F>
+unsigned int TemplatedVocabulary<TDescriptor,F>::prune(
+  const std::vector<double> &usage, unsigned int target_words,
+  VocabularyRemap &remap)
+{
+  if(usage.size() != m_words.size())
+  {
+    std::stringstream ss;
+    ss << "Expected the usage of " << m_words.size() << " words, got "
+      << usage.size();
+    throw ss.str();
+  }
+
+  const size_t N = m_nodes.size();
+  const unsigned int old_words = m_words.size();
+  if(target_words < 1) target_words = 1;
+
+  // state of the nodes while words are removed
+  std::vector<double> use(N, 0);
+  std::vector<WordValue> weight(N, 0);
+  std::vector<unsigned int> children(N, 0); // children left
+  std::vector<unsigned int> leaves(N, 0); // children left that are words
+  std::vector<unsigned char> removed(N, 0);
+  std::vector<NodeId> target(N, 0); // node that takes the features
+
+  for(NodeId nid = 0; nid < N; ++nid)
+  {
+    const Node &node = m_nodes[nid];
+    children[nid] = node.children.size();
+    if(nid != 0 && node.isLeaf())
+    {
+      use[nid] = usage[node.word_id];
+      weight[nid] = node.weight;
+      ++leaves[node.parent];
+    }
+  }
+
+  // words by usage, the least used first. Entries whose usage changed or
+  // that were removed are skipped when popped
+  typedef std::pair<double, NodeId> Candidate;
+  std::priority_queue<Candidate, std::vector<Candidate>,
+    std::greater<Candidate> > queue;
+
+  for(WordId wid = 0; wid < old_words; ++wid)
+    queue.push(Candidate(use[m_words[wid]->id], m_words[wid]->id));
+
+  unsigned int words = old_words;
+  while(words > target_words && !queue.empty())
+  {
+    const Candidate c = queue.top();
+    queue.pop();
+
+    const NodeId nid = c.second;
+    if(removed[nid] || children[nid] > 0 || c.first != use[nid]) continue;
+
+    const NodeId pid = m_nodes[nid].parent;
+
+    if(children[pid] == 1)
+    {
+      // last child: the parent becomes a word (the root cannot)
+      if(pid == 0) continue;
+
+      removed[nid] = 1;
+      target[nid] = pid;
+      use[pid] = use[nid];
+      weight[pid] = weight[nid];
+      children[pid] = leaves[pid] = 0;
+
+      const Node &grandparent = m_nodes[m_nodes[pid].parent];
+      ++leaves[grandparent.id];
+
+      // the words next to the new one may be removed now
+      typename Children::const_iterator cit;
+      for(cit = grandparent.children.begin();
+        cit != grandparent.children.end(); ++cit)
+      {
+        if(!removed[*cit] && children[*cit] == 0)
+          queue.push(Candidate(use[*cit], *cit));
+      }
+    }
+    else if(leaves[pid] >= 2)
+    {
+      // the features of the word go to the closest sibling word
+      NodeId best = 0;
+      double best_d = std::numeric_limits<double>::max();
+
+      typename Children::const_iterator cit;
+      const Children &siblings = m_nodes[pid].children;
+      for(cit = siblings.begin(); cit != siblings.end(); ++cit)
+      {
+        if(*cit == nid || removed[*cit] || children[*cit] > 0) continue;
+
+        const double d = F::distance(m_nodes[nid].descriptor,
+          m_nodes[*cit].descriptor);
+        if(d < best_d)
+        {
+          best_d = d;
+          best = *cit;
+        }
+      }
+
+      removed[nid] = 1;
+      target[nid] = best;
+      use[best] += use[nid];
+      weight[best] = std::min(weight[best], weight[nid]);
+      --children[pid];
+      --leaves[pid];
+      --words;
+
+      queue.push(Candidate(use[best], best));
+    }
+    // else: its siblings are inner nodes, which may collapse later
+  }
+
+  // renumbering, in the same order, so parents still come first
+  std::vector<NodeId> new_id(N, 0);
+  std::vector<Node> nodes;
+  nodes.reserve(N - std::count(removed.begin(), removed.end(), 1));
+
+  for(NodeId nid = 0; nid < N; ++nid)
+  {
+    if(removed[nid]) continue;
+
+    new_id[nid] = nodes.size();
+    nodes.push_back(Node(new_id[nid]));
+
+    Node &node = nodes.back();
+    node.parent = new_id[m_nodes[nid].parent];
+    node.descriptor = m_nodes[nid].descriptor;
+    if(children[nid] == 0) node.weight = weight[nid];
+  }
+
+  for(NodeId nid = 1; nid < N; ++nid)
+  {
+    if(!removed[nid]) nodes[nodes[new_id[nid]].parent].children.push_back(
+      new_id[nid]);
+  }
+
+  // a removed node stands for the node that took its features
+  remap.nodes.resize(N);
+  for(NodeId nid = 0; nid < N; ++nid)
+  {
+    NodeId n = nid;
+    while(removed[n]) n = target[n];
+    remap.nodes[nid] = new_id[n];
+  }
+
+  std::vector<NodeId> word_nodes(old_words);
+  for(WordId wid = 0; wid < old_words; ++wid)
+    word_nodes[wid] = m_words[wid]->id;
+
+  // the old nodes are released before the arena they may use
+  m_nodes.swap(nodes);
+  std::vector<Node>().swap(nodes);
+  createWords();
+  if(m_cache) m_cache->clear();
+
+  remap.words.resize(old_words);
+  for(WordId wid = 0; wid < old_words; ++wid)
+    remap.words[wid] = m_nodes[remap.nodes[word_nodes[wid]]].word_id;
+
+  if(m_arena) relocateTree(new MonotonicArena);
+  if(m_quantized) quantizeCenters(m_quantized->precision());
+
+  return old_words - m_words.size();
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+unsigned int TemplatedVocabulary<TDescriptor,F>::prune(
+  const std::vector<std::vector<TDescriptor> > &training_features,
+  unsigned int target_words, VocabularyRemap &remap)
+{
+  std::vector<double> occupancy;
+  computeOccupancy(training_features, occupancy);
+
+  const unsigned int removed = prune(occupancy, target_words, remap);
+  setNodeWeights(training_features);
+  return removed;
+}
+
+// --------------------------------------------------------------------------
+
 template<class TDescriptor, class F>
 void TemplatedVocabulary<TDescriptor,F>::save(const std::string &filename) const
 {
@@ -1413,7 +2786,7 @@ void TemplatedVocabulary<TDescriptor,F>::save(cv::FileStorage &f,
     parents.pop_back();
 
     const Node& parent = m_nodes[pid];
-    children = parent.children;
+    children.assign(parent.children.begin(), parent.children.end());
 
     for(pit = children.begin(); pit != children.end(); pit++)
     {
@@ -1464,6 +2837,7 @@ void TemplatedVocabulary<TDescriptor,F>::load(const cv::FileStorage &fs,
 {
   m_words.clear();
   m_nodes.clear();
+  if(m_cache) m_cache->clear();
 
   cv::FileNode fvoc = fs[name];
 
@@ -1508,96 +2882,655 @@ void TemplatedVocabulary<TDescriptor,F>::load(const cv::FileStorage &fs,
     m_nodes[nid].word_id = wid;
     m_words[wid] = &m_nodes[nid];
   }
+
+  if(m_arena) relocateTree(new MonotonicArena);
+  if(m_quantized) quantizeCenters(m_quantized->precision());
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::saveBinary(std::ostream &out) const
+{
+  // Format:
+  // k, L, scoringType, weightingType, number of nodes (with the root),
+  //   number of words, bytes of a descriptor: uint32
+  // nodes 1..N-1, in id order:
+  //   parentId, wordId (NO_WORD if not a word): uint32
+  //   weight: double
+  //   descriptor: F::toBytes
+  //
+  // The children of the nodes are rebuilt in id order, which is the order
+  // in which they are created
+
+  const uint32_t NO_WORD = 0xffffffff;
+  const int bytes = DescriptorTraits<F>::bytes;
+  if(bytes <= 0)
+    throw std::string("This descriptor class has no binary format");
+
+  BundleSection::write(out, (uint32_t)m_k);
+  BundleSection::write(out, (uint32_t)m_L);
+  BundleSection::write(out, (uint32_t)m_scoring);
+  BundleSection::write(out, (uint32_t)m_weighting);
+  BundleSection::write(out, (uint32_t)m_nodes.size());
+  BundleSection::write(out, (uint32_t)m_words.size());
+  BundleSection::write(out, (uint32_t)bytes);
+
+  // the records are serialized into a buffer written in large blocks
+  const size_t record = 2 * sizeof(uint32_t) + sizeof(double) + bytes;
+  const size_t BLOCK = 4096;
+  std::vector<unsigned char> buffer(BLOCK * record);
+
+  for(size_t first = 1; first < m_nodes.size(); first += BLOCK)
+  {
+    const size_t last = std::min(m_nodes.size(), first + BLOCK);
+    unsigned char *p = &buffer[0];
+
+    for(size_t nid = first; nid < last; ++nid, p += record)
+    {
+      const Node &node = m_nodes[nid];
+      const uint32_t ids[2] = { (uint32_t)node.parent,
+        node.isLeaf() ? (uint32_t)node.word_id : NO_WORD };
+      const double weight = node.weight;
+
+      std::memcpy(p, ids, sizeof(ids));
+      std::memcpy(p + sizeof(ids), &weight, sizeof(weight));
+      F::toBytes(node.descriptor, p + sizeof(ids) + sizeof(weight));
+    }
+
+    out.write(reinterpret_cast<const char*>(&buffer[0]),
+      (last - first) * record);
+  }
 }
 
 // --------------------------------------------------------------------------
 
 template<class TDescriptor, class F>
-bool TemplatedVocabulary<TDescriptor,F>::loadFromTextFile(const std::string &filename)
+void TemplatedVocabulary<TDescriptor,F>::loadBinary(BundleSection section)
 {
-    std::ifstream f;
-    f.open(filename.c_str());
+  const uint32_t NO_WORD = 0xffffffff;
+  const int bytes = DescriptorTraits<F>::bytes;
+  if(bytes <= 0)
+    throw std::string("This descriptor class has no binary format");
+
+  const uint32_t k = section.read<uint32_t>();
+  const uint32_t L = section.read<uint32_t>();
+  const uint32_t scoring = section.read<uint32_t>();
+  const uint32_t weighting = section.read<uint32_t>();
+  const uint32_t nodes = section.read<uint32_t>();
+  const uint32_t words = section.read<uint32_t>();
+  const uint32_t descriptor_bytes = section.read<uint32_t>();
+
+  const size_t record = 2 * sizeof(uint32_t) + sizeof(double) + bytes;
+
+  if(descriptor_bytes != (uint32_t)bytes)
+  {
+    std::stringstream ss;
+    ss << "The vocabulary has descriptors of " << descriptor_bytes
+      << " bytes instead of " << bytes;
+    throw ss.str();
+  }
+
+  if(scoring > DOT_PRODUCT || weighting > BINARY || nodes == 0 ||
+    words > nodes || section.remaining() / record < nodes - 1)
+    throw std::string("Invalid vocabulary data");
+
+  m_words.clear();
+  m_nodes.clear();
+  if(m_cache) m_cache->clear();
+
+  m_k = k;
+  m_L = L;
+  m_scoring = (ScoringType)scoring;
+  m_weighting = (WeightingType)weighting;
+  createScoringObject();
+
+  try
+  {
+    m_nodes.resize(nodes);
+    m_words.assign(words, (Node*)NULL);
+
+    for(NodeId nid = 1; nid < nodes; ++nid)
+    {
+      const uint32_t pid = section.read<uint32_t>();
+      const uint32_t wid = section.read<uint32_t>();
+
+      // parents are created before their children
+      if(pid >= nid || (wid != NO_WORD && (wid >= words || m_words[wid])))
+        throw std::string("Invalid vocabulary data");
 
-    if(f.eof())
-	return false;
+      Node &node = m_nodes[nid];
+      node.id = nid;
+      node.parent = pid;
+      node.weight = section.read<double>();
+      F::fromBytes(node.descriptor, section.skip(bytes));
+      m_nodes[pid].children.push_back(nid);
+
+      if(wid != NO_WORD)
+      {
+        node.word_id = wid;
+        m_words[wid] = &node;
+      }
+    }
 
+    if(std::find(m_words.begin(), m_words.end(), (Node*)NULL) !=
+      m_words.end())
+      throw std::string("Invalid vocabulary data");
+  }
+  catch(...)
+  {
     m_words.clear();
     m_nodes.clear();
+    throw;
+  }
 
-    std::string s;
-    getline(f,s);
-    std::stringstream ss;
-    ss << s;
-    ss >> m_k;
-    ss >> m_L;
-    int n1, n2;
-    ss >> n1;
-    ss >> n2;
-
-    if(m_k<0 || m_k>20 || m_L<1 || m_L>10 || n1<0 || n1>5 || n2<0 || n2>3)
+  if(m_arena) relocateTree(new MonotonicArena);
+  if(m_quantized) quantizeCenters(m_quantized->precision());
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+bool TemplatedVocabulary<TDescriptor,F>::loadFromTextFile(
+  const std::string &filename)
+{
+  // Format:
+  // k L scoringType weightingType
+  // a line per node, in id order from 1: parentId isLeaf descriptor weight
+  //
+  // The file is read at once, and its lines are split into ranges parsed by
+  // different threads, each one filling its own nodes. The children and the
+  // word ids are then set in a single pass, in id order
+
+  std::ifstream f(filename.c_str(), std::ios::binary);
+  if(!f.is_open())
+  {
+    std::cerr << "Vocabulary loading failure: could not open " << filename
+      << std::endl;
+    return false;
+  }
+
+  std::vector<char> text;
+  f.seekg(0, std::ios::end);
+  const std::streamoff length = f.tellg();
+  f.seekg(0, std::ios::beg);
+  if(length > 0)
+  {
+    text.resize((size_t)length);
+    f.read(&text[0], length);
+  }
+  if(!f || length <= 0)
+  {
+    std::cerr << "Vocabulary loading failure: could not read " << filename
+      << std::endl;
+    return false;
+  }
+  text.push_back('\0'); // the weights are parsed with strtod
+
+  // non-blank lines
+  std::vector<std::pair<const char*, const char*> > lines;
+  lines.reserve(text.size() / 64);
+
+  const char *p = &text[0];
+  const char *text_end = p + text.size() - 1;
+  while(p < text_end)
+  {
+    const char *eol =
+      static_cast<const char*>(std::memchr(p, '\n', text_end - p));
+    if(!eol) eol = text_end;
+
+    const char *q = p;
+    while(q < eol && std::isspace((unsigned char)*q)) ++q;
+    if(q < eol) lines.push_back(std::make_pair(p, eol));
+
+    p = eol + 1;
+  }
+
+  int k = 0, L = 0, n1 = -1, n2 = -1;
+  if(!lines.empty())
+  {
+    p = lines[0].first;
+    if(!parseInt(p, lines[0].second, k) || !parseInt(p, lines[0].second, L) ||
+      !parseInt(p, lines[0].second, n1) || !parseInt(p, lines[0].second, n2))
+      k = -1;
+  }
+
+  if(k<0 || k>20 || L<1 || L>10 || n1<0 || n1>5 || n2<0 || n2>3)
+  {
+    std::cerr << "Vocabulary loading failure: This is not a correct text file!" << std::endl;
+    return false;
+  }
+
+  m_words.clear();
+  m_nodes.clear();
+  if(m_cache) m_cache->clear();
+
+  m_k = k;
+  m_L = L;
+  m_scoring = (ScoringType)n1;
+  m_weighting = (WeightingType)n2;
+  createScoringObject();
+
+  // nodes
+  const size_t N = lines.size(); // with the root
+  m_nodes.resize(N);
+  m_nodes[0].id = 0;
+
+  std::vector<unsigned char> leaves(N, 0);
+
+  const size_t threads = textThreads(N - 1);
+
+  // first invalid line of each range, 0 if none
+  std::vector<size_t> errors(threads, 0);
+
+  auto parseRange = [&](size_t t)
+  {
+    std::string scratch;
+    const size_t first = 1 + (N - 1) * t / threads;
+    const size_t last = 1 + (N - 1) * (t + 1) / threads;
+
+    for(size_t nid = first; nid < last; ++nid)
     {
-        std::cerr << "Vocabulary loading failure: This is not a correct text file!" << std::endl;
-	return false;
+      bool is_leaf;
+      if(!parseTextNode(lines[nid].first, lines[nid].second, m_nodes[nid],
+        is_leaf, scratch))
+      {
+        errors[t] = nid;
+        return;
+      }
+      leaves[nid] = (is_leaf ? 1 : 0);
     }
+  };
 
-    m_scoring = (ScoringType)n1;
-    m_weighting = (WeightingType)n2;
-    createScoringObject();
+  std::vector<std::thread> workers;
+  for(size_t t = 1; t < threads; ++t)
+    workers.push_back(std::thread(parseRange, t));
+  parseRange(0);
+  for(size_t t = 0; t < workers.size(); ++t) workers[t].join();
 
-    // nodes
-    int expected_nodes =
-    (int)((pow((double)m_k, (double)m_L + 1) - 1)/(m_k - 1));
-    m_nodes.reserve(expected_nodes);
+  size_t error = 0;
+  for(size_t t = 0; t < threads && error == 0; ++t) error = errors[t];
 
-    m_words.reserve(pow((double)m_k, (double)m_L + 1));
+  // links, in id order so that the children keep the order of the file
+  size_t nwords = 0;
+  for(NodeId nid = 1; nid < N && error == 0; ++nid)
+  {
+    Node &node = m_nodes[nid];
+    node.id = nid;
 
-    m_nodes.resize(1);
-    m_nodes[0].id = 0;
-    while(!f.eof())
+    // parents come before their children
+    if(node.parent >= nid)
     {
-        std::string snode;
-        getline(f,snode);
-        std::stringstream ssnode;
-        ssnode << snode;
+      error = nid;
+      break;
+    }
+    m_nodes[node.parent].children.push_back(nid);
+
+    if(leaves[nid])
+      node.word_id = nwords++;
+    else
+      node.children.reserve(m_k);
+  }
 
-        int nid = m_nodes.size();
-        m_nodes.resize(m_nodes.size()+1);
-	m_nodes[nid].id = nid;
+  if(error != 0)
+  {
+    std::cerr << "Vocabulary loading failure: the line of node " << error
+      << " of " << filename << " is not valid" << std::endl;
+    m_nodes.clear();
+    return false;
+  }
 
-        int pid ;
-        ssnode >> pid;
-        m_nodes[nid].parent = pid;
-        m_nodes[pid].children.push_back(nid);
+  m_words.resize(nwords);
+  for(NodeId nid = 1; nid < N; ++nid)
+    if(leaves[nid]) m_words[m_nodes[nid].word_id] = &m_nodes[nid];
 
-        int nIsLeaf;
-        ssnode >> nIsLeaf;
+  if(m_arena) relocateTree(new MonotonicArena);
+  if(m_quantized) quantizeCenters(m_quantized->precision());
 
-        std::stringstream ssd;
-        for(int iD=0;iD<F::L;iD++)
-        {
-            std::string sElement;
-            ssnode >> sElement;
-            ssd << sElement << " ";
-	}
-        F::fromString(m_nodes[nid].descriptor, ssd.str());
+  return true;
+}
 
-        ssnode >> m_nodes[nid].weight;
+// --------------------------------------------------------------------------
 
-        if(nIsLeaf>0)
-        {
-            int wid = m_words.size();
-            m_words.resize(wid+1);
+template<class TDescriptor, class F>
+bool TemplatedVocabulary<TDescriptor,F>::parseTextNode(const char *p,
+  const char *end, Node &node, bool &is_leaf, std::string &scratch) const
+{
+  int pid, leaf;
+  if(!parseInt(p, end, pid) || pid < 0 || !parseInt(p, end, leaf))
+    return false;
+
+  if(!parseTextDescriptor(p, end, node.descriptor, scratch, ByteTokens()))
+    return false;
+
+  // the line ends with '\n' or the '\0' after the text
+  char *weight_end;
+  const double weight = std::strtod(p, &weight_end);
+  if(weight_end == p || weight_end > end) return false;
+
+  node.parent = pid;
+  node.weight = weight;
+  is_leaf = (leaf > 0);
+  return true;
+}
 
-            m_nodes[nid].word_id = wid;
-            m_words[wid] = &m_nodes[nid];
-        }
-        else
-        {
-            m_nodes[nid].children.reserve(m_k);
-        }
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+template<class T>
+bool TemplatedVocabulary<TDescriptor,F>::parseTextDescriptor(const char *&p,
+  const char *end, T &d, std::string &, std::true_type) const
+{
+  unsigned char bytes[DescriptorTraits<F>::bytes];
+  for(int i = 0; i < DescriptorTraits<F>::bytes; ++i)
+  {
+    int value;
+    if(!parseInt(p, end, value) || value < 0 || value > 255) return false;
+    bytes[i] = (unsigned char)value;
+  }
+
+  F::fromBytes(d, bytes);
+  return true;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+template<class T>
+bool TemplatedVocabulary<TDescriptor,F>::parseTextDescriptor(const char *&p,
+  const char *end, T &d, std::string &scratch, std::false_type) const
+{
+  // the descriptor is the text before the last token (the weight), so any
+  // format of F::toString can be read back
+  const char *last = end;
+  while(last > p && std::isspace((unsigned char)last[-1])) --last;
+  while(last > p && !std::isspace((unsigned char)last[-1])) --last;
+
+  const char *first = p;
+  while(first < last && std::isspace((unsigned char)*first)) ++first;
+  if(first == last) return false;
+
+  scratch.assign(first, last);
+  F::fromString(d, scratch);
+  p = last;
+  return true;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+bool TemplatedVocabulary<TDescriptor,F>::parseInt(const char *&p,
+  const char *end, int &value)
+{
+  while(p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+
+  const bool negative = (p < end && *p == '-');
+  if(negative) ++p;
+
+  const char *digits = p;
+  long long v = 0;
+  while(p < end && *p >= '0' && *p <= '9' && v <= INT_MAX)
+    v = v * 10 + (*p++ - '0');
+
+  if(p == digits || v > INT_MAX) return false;
+
+  value = (int)(negative ? -v : v);
+  return true;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::saveToTextFile(
+  const std::string &filename) const
+{
+  // Same format as loadFromTextFile. The nodes are written in id order,
+  // which puts parents before their children and keeps the word ids.
+  // Blocks of BLOCK nodes are formatted by different threads in each round
+  // and written in order, so the text in memory is bounded
+
+  std::ofstream f(filename.c_str(), std::ios::binary);
+  if(!f.is_open()) throw std::string("Could not open file ") + filename;
+
+  f << m_k << " " << m_L << " " << m_scoring << " " << m_weighting << "\n";
+
+  const size_t BLOCK = 16384;
+  const size_t N = m_nodes.size();
+  const size_t threads = textThreads(N > 0 ? N - 1 : 0);
+  std::vector<std::string> blocks(threads);
+
+  for(size_t first = 1; first < N; first += threads * BLOCK)
+  {
+    auto formatBlock = [&](size_t t)
+    {
+      std::string &out = blocks[t];
+      out.clear();
+
+      const size_t begin = std::min(N, first + t * BLOCK);
+      const size_t end = std::min(N, begin + BLOCK);
+      for(size_t nid = begin; nid < end; ++nid)
+        appendTextNode(m_nodes[nid], out);
+    };
+
+    std::vector<std::thread> workers;
+    for(size_t t = 1; t < threads; ++t)
+      workers.push_back(std::thread(formatBlock, t));
+    formatBlock(0);
+    for(size_t t = 0; t < workers.size(); ++t) workers[t].join();
+
+    for(size_t t = 0; t < threads; ++t)
+      f.write(blocks[t].data(), blocks[t].size());
+  }
+
+  if(!f) throw std::string("Could not write file ") + filename;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::appendTextNode(const Node &node,
+  std::string &out) const
+{
+  char number[32];
+
+  int n = std::snprintf(number, sizeof(number), "%u %d ",
+    (unsigned int)node.parent, node.isLeaf() ? 1 : 0);
+  out.append(number, n);
+
+  appendTextDescriptor(node.descriptor, out, ByteTokens());
+
+  n = std::snprintf(number, sizeof(number), "%.*g\n",
+    std::numeric_limits<WordValue>::max_digits10, (double)node.weight);
+  out.append(number, n);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+template<class T>
+void TemplatedVocabulary<TDescriptor,F>::appendTextDescriptor(const T &d,
+  std::string &out, std::true_type) const
+{
+  unsigned char bytes[DescriptorTraits<F>::bytes];
+  F::toBytes(d, bytes);
+
+  for(int i = 0; i < DescriptorTraits<F>::bytes; ++i)
+  {
+    const unsigned int v = bytes[i];
+    if(v >= 100) out.push_back((char)('0' + v / 100));
+    if(v >= 10) out.push_back((char)('0' + v / 10 % 10));
+    out.push_back((char)('0' + v % 10));
+    out.push_back(' ');
+  }
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+template<class T>
+void TemplatedVocabulary<TDescriptor,F>::appendTextDescriptor(const T &d,
+  std::string &out, std::false_type) const
+{
+  out += F::toString(d);
+  if(out.empty() || out[out.size() - 1] != ' ') out.push_back(' ');
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+size_t TemplatedVocabulary<TDescriptor,F>::textThreads(size_t nodes)
+{
+  const size_t MIN_LINES_PER_THREAD = 16384;
+  const size_t threads = std::thread::hardware_concurrency();
+  return std::max((size_t)1,
+    std::min(threads, nodes / MIN_LINES_PER_THREAD));
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::saveToBinaryFile(
+  const std::string &filename) const
+{
+  std::ostringstream data;
+  saveBinary(data);
+
+  BundleWriter writer;
+  writer.add(Bundle::VOCABULARY, data.str());
+  writer.write(filename);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::loadFromBinaryFile(
+  const std::string &filename)
+{
+  Bundle bundle(filename);
+  loadBinary(bundle.section(Bundle::VOCABULARY));
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::enableQuantizationCache
+  (size_t capacity)
+{
+  delete m_cache;
+  m_cache = new QuantizationCache(capacity);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::disableQuantizationCache()
+{
+  delete m_cache;
+  m_cache = NULL;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+QuantizationCacheStats
+TemplatedVocabulary<TDescriptor,F>::getQuantizationCacheStats() const
+{
+  if(m_cache) return m_cache->getStats();
+  else return QuantizationCacheStats();
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::setAllocationPolicy(
+  AllocationPolicy policy)
+{
+  if(policy == ARENA_ALLOCATION)
+    relocateTree(new MonotonicArena);
+  else if(m_arena)
+    relocateTree(NULL);
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::setClassWeights(
+  const std::vector<float> &weights)
+{
+  for(size_t c = 0; c < weights.size(); ++c)
+  {
+    if(!(weights[c] >= 0.f))
+    {
+      std::stringstream ss;
+      ss << "Invalid weight " << weights[c] << " of semantic class " << c;
+      throw ss.str();
     }
+  }
+
+  m_class_weights = weights;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::setNodePrecision(
+  NodePrecision precision, bool exact_leaves)
+{
+  if(precision != FULL_PRECISION && FloatView<TDescriptor>::dimensions == 0)
+    throw std::string("Reduced node precision requires float descriptors");
+
+  m_exact_leaves = exact_leaves;
+
+  // the descent may choose other words
+  if(m_cache) m_cache->clear();
+
+  if(precision == FULL_PRECISION)
+  {
+    delete m_quantized;
+    m_quantized = NULL;
+  }
+  else
+  {
+    quantizeCenters(precision);
+  }
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::quantizeCenters(
+  NodePrecision precision)
+{
+  QuantizedCenters *quantized = new QuantizedCenters(precision,
+    FloatView<TDescriptor>::dimensions);
+
+  std::vector<const float*> centers(m_nodes.size(), (const float*)NULL);
+  for(size_t i = 1; i < m_nodes.size(); ++i) // the root has no center
+    centers[i] = FloatView<TDescriptor>::data(m_nodes[i].descriptor);
+  quantized->build(centers);
+
+  delete m_quantized;
+  m_quantized = quantized;
+}
+
+// --------------------------------------------------------------------------
+
+template<class TDescriptor, class F>
+void TemplatedVocabulary<TDescriptor,F>::relocateTree(MonotonicArena *arena)
+{
+  // the tree does not change after being created, so each list of children
+  // is packed with its exact size, in node order
+  typename std::vector<Node>::iterator nit;
+  for(nit = m_nodes.begin(); nit != m_nodes.end(); ++nit)
+  {
+    Children children((ArenaAllocator<NodeId>(arena)));
+    children.reserve(nit->children.size());
+    children.assign(nit->children.begin(), nit->children.end());
+    nit->children = std::move(children);
+  }
 
-    return true;
+  delete m_arena;
+  m_arena = arena;
 }
 
 // --------------------------------------------------------------------------
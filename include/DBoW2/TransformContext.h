@@ -0,0 +1,142 @@
+/**
+ * File: TransformContext.h
+ * Date: October 2026
+ * Description: reusable scratch storage for vocabulary transforms
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_TRANSFORM_CONTEXT__
+#define __D_T_TRANSFORM_CONTEXT__
+
+#include <utility>
+#include <vector>
+
+#include "BowVector.h"
+#include "FeatureVector.h"
+
+namespace DBoW2 {
+
+/// Scratch storage and result of TemplatedVocabulary::transform
+/**
+ * The context keeps the capacity of its buffers between calls, so once it
+ * has seen the largest image, transforming more images does not allocate
+ * memory. The result is stored as flat vectors sorted like the BowVector
+ * and FeatureVector maps, which can be obtained with toBowVector and
+ * toFeatureVector.
+ * A context must not be used by several threads at once; use one per
+ * thread.
+ */
+class TransformContext
+{
+public:
+
+  /// Words and weights, in ascending word id order
+  typedef std::vector<std::pair<WordId, WordValue> > Words;
+
+  /// Node and feature index pairs, in ascending node id and feature order
+  typedef std::vector<std::pair<NodeId, unsigned int> > Features;
+
+  /**
+   * Creates an empty context
+   * @param features number of features per image to reserve memory for
+   */
+  explicit TransformContext(size_t features = 0);
+
+  /**
+   * Reserves memory for images with the given number of features
+   * @param features
+   */
+  void reserve(size_t features);
+
+  /**
+   * Empties the result, keeping the memory
+   */
+  void clear();
+
+  /**
+   * Returns the bag of words of the last transform
+   * @return words and weights
+   */
+  inline const Words& words() const { return m_words; }
+
+  /**
+   * Returns the nodes of the features of the last transform
+   * @return node and feature pairs
+   */
+  inline const Features& features() const { return m_features; }
+
+  /**
+   * Copies the bag of words of the last transform
+   * @param v (out) bow vector
+   */
+  void toBowVector(BowVector &v) const;
+
+  /**
+   * Copies the nodes of the features of the last transform
+   * @param fv (out) feature vector
+   */
+  void toFeatureVector(FeatureVector &fv) const;
+
+  /**
+   * Gives each word of the last transform the most frequent semantic class
+   * among the features assigned to it. Features without class do not vote,
+   * and ties go to the smallest class id. The votes are counted in a buffer
+   * of the context, so this does not allocate memory either
+   * @param classes class of each feature (<= 0 for none)
+   * @param word_classes (out) class of each word of words(), 0 if none of
+   *   its features has a class
+   */
+  void wordClasses(const int *classes, std::vector<int> &word_classes) const;
+
+  /**
+   * Adds the word of a feature
+   * @param word_id word
+   * @param weight weight of the word
+   * @param nid node of the feature in the direct index
+   * @param i_feature index of the feature
+   */
+  inline void add(WordId word_id, WordValue weight, NodeId nid,
+    unsigned int i_feature)
+  {
+    Assignment a = { word_id, weight, nid, i_feature };
+    m_assignments.push_back(a);
+  }
+
+  /**
+   * Builds the result from the words added since the last clear()
+   * @param tf accumulate the weights of repeated words, or keep one
+   * @param must_normalize normalize the weights with norm, otherwise,
+   *   accumulated weights are divided by the number of words
+   * @param norm norm to use
+   */
+  void finish(bool tf, bool must_normalize, LNorm norm);
+
+protected:
+
+  /// Word of a feature
+  struct Assignment
+  {
+    WordId word_id;
+    WordValue weight;
+    NodeId nid;
+    unsigned int i_feature;
+
+    /// Orders by word, and the features of a word in input order
+    inline bool operator<(const Assignment &a) const
+    {
+      return word_id < a.word_id ||
+        (word_id == a.word_id && i_feature < a.i_feature);
+    }
+  };
+
+  std::vector<Assignment> m_assignments;
+  Words m_words;
+  Features m_features;
+  /// Classes of the features of a word, used by wordClasses
+  mutable std::vector<int> m_votes;
+};
+
+} // namespace DBoW2
+
+#endif
@@ -0,0 +1,64 @@
+/**
+ * File: VocabularyRemap.h
+ * Date: October 2026
+ * Description: correspondence between the words and nodes of a vocabulary
+ *   and those of its pruned version
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_VOCABULARY_REMAP__
+#define __D_T_VOCABULARY_REMAP__
+
+#include <string>
+#include <vector>
+
+#include "BowVector.h"
+
+namespace DBoW2 {
+
+/// Remap table written by TemplatedVocabulary::prune
+/**
+ * Each word and node of the original vocabulary is mapped to the word or
+ * node of the pruned vocabulary that takes its features, so that databases
+ * built with the original vocabulary can be kept (see
+ * TemplatedDatabase::setPrunedVocabulary).
+ */
+struct VocabularyRemap
+{
+  /// words[old word id] = id of the word in the pruned vocabulary
+  std::vector<WordId> words;
+  /// nodes[old node id] = id of the node in the pruned vocabulary
+  std::vector<NodeId> nodes;
+
+  /**
+   * Returns whether the table maps nothing
+   */
+  inline bool empty() const { return words.empty(); }
+
+  /**
+   * Returns the number of words of the pruned vocabulary
+   * @return 1 + largest word id of the table, 0 if it is empty
+   */
+  unsigned int prunedWords() const;
+
+  /**
+   * Writes the table in a text file: a line with the number of words and
+   * nodes of the original vocabulary, followed by the new id of each word
+   * and each node, one per line
+   * @param filename
+   * @throw std::string if the file cannot be written
+   */
+  void save(const std::string &filename) const;
+
+  /**
+   * Reads a table written by save
+   * @param filename
+   * @throw std::string if the file cannot be read or is not valid
+   */
+  void load(const std::string &filename);
+};
+
+} // namespace DBoW2
+
+#endif
@@ -0,0 +1,107 @@
+/**
+ * File: VocabularyStats.h
+ * Date: October 2026
+ * Description: statistics of the structure and balance of a vocabulary
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#ifndef __D_T_VOCABULARY_STATS__
+#define __D_T_VOCABULARY_STATS__
+
+#include <iostream>
+#include <vector>
+
+namespace DBoW2 {
+
+/// Summary of a set of non-negative values
+struct Distribution
+{
+  /// Number of values
+  unsigned int count;
+  /// Mean, standard deviation and extremes of the values
+  double mean, stddev, min, max;
+  /// Gini coefficient: 0 if all the values are equal, close to 1 if a few
+  /// values take the whole sum
+  double gini;
+  /// Fraction of the sum taken by the 1% largest values
+  double top1_share;
+
+  /**
+   * Creates an empty distribution
+   */
+  Distribution();
+
+  /**
+   * Computes the distribution of the given values
+   * @param values values (they are sorted in place)
+   */
+  void compute(std::vector<double> &values);
+};
+
+/// Structure of a level of the vocabulary tree
+struct LevelStats
+{
+  /// Nodes in this level
+  unsigned int nodes;
+  /// Nodes of this level that are words
+  unsigned int leaves;
+  /// Children of the inner nodes of this level
+  Distribution branching;
+
+  LevelStats(): nodes(0), leaves(0){}
+};
+
+/// Structure and balance statistics of a vocabulary
+struct VocabularyStats
+{
+  /// Nominal branching factor and depth
+  int k, L;
+  /// Number of nodes (including the root) and words
+  unsigned int nodes, words;
+
+  /// Per level statistics. levels[0] is the root
+  std::vector<LevelStats> levels;
+  /// Depth of the words
+  Distribution word_depth;
+  /// Weights of the words (the idf when using IDF or TF_IDF)
+  Distribution idf;
+
+  /// Training descriptors that fall in each word. Empty if no training
+  /// data was given
+  Distribution occupancy;
+  /// Words where no training descriptor falls
+  unsigned int empty_words;
+
+  /// Expected number of distance computations to quantize a descriptor,
+  /// weighting the words by their occupancy if known, or uniformly
+  double descent_cost;
+  /// Distance computations in a complete tree of the same size, with
+  /// nominal branching factor
+  double ideal_descent_cost;
+
+  /// Entries where each word occurs in a database. Empty unless computed
+  /// by a database
+  Distribution word_frequency;
+
+  VocabularyStats(): k(0), L(0), nodes(0), words(0), empty_words(0),
+    descent_cost(0), ideal_descent_cost(0){}
+};
+
+/**
+ * Writes a summary of the distribution
+ * @param os stream to write to
+ * @param d
+ */
+std::ostream& operator<<(std::ostream &os, const Distribution &d);
+
+/**
+ * Writes a report of the statistics
+ * @param os stream to write to
+ * @param stats
+ */
+std::ostream& operator<<(std::ostream &os, const VocabularyStats &stats);
+
+} // namespace DBoW2
+
+#endif
@@ -0,0 +1,137 @@
+/**
+ * File: Allocators.cpp
+ * Date: October 2026
+ * Description: arena and pool allocators for vocabulary and database
+ *   containers
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <algorithm>
+#include <stdint.h>
+
+#include "Allocators.h"
+
+namespace DBoW2 {
+
+// --------------------------------------------------------------------------
+
+/// Alignment of the blocks of the pools
+static const size_t POOL_ALIGNMENT = sizeof(void*) * 2;
+
+// --------------------------------------------------------------------------
+
+MonotonicArena::MonotonicArena(size_t block_size)
+  : m_block_size(block_size), m_capacity(0), m_current(NULL), m_end(NULL)
+{
+}
+
+// --------------------------------------------------------------------------
+
+MonotonicArena::~MonotonicArena()
+{
+  release();
+}
+
+// --------------------------------------------------------------------------
+
+void* MonotonicArena::allocate(size_t bytes, size_t alignment)
+{
+  uintptr_t p = ((uintptr_t)m_current + alignment - 1) & ~(alignment - 1);
+
+  if(m_current == NULL || p + bytes > (uintptr_t)m_end)
+  {
+    // large requests get a block of their own
+    const size_t size = std::max(m_block_size, bytes + alignment);
+    char *block = static_cast<char*>(::operator new(size));
+    m_blocks.push_back(block);
+    m_capacity += size;
+
+    m_current = block;
+    m_end = block + size;
+    p = ((uintptr_t)m_current + alignment - 1) & ~(alignment - 1);
+  }
+
+  m_current = (char*)(p + bytes);
+  return (void*)p;
+}
+
+// --------------------------------------------------------------------------
+
+void MonotonicArena::release()
+{
+  for(size_t i = 0; i < m_blocks.size(); ++i) ::operator delete(m_blocks[i]);
+  m_blocks.clear();
+  m_capacity = 0;
+  m_current = m_end = NULL;
+}
+
+// --------------------------------------------------------------------------
+
+SlabPool::SlabPool(size_t block_size, size_t blocks_per_slab)
+  : m_blocks_per_slab(blocks_per_slab), m_used(0), m_free(NULL),
+    m_current(NULL), m_end(NULL)
+{
+  if(block_size < sizeof(FreeBlock)) block_size = sizeof(FreeBlock);
+  m_block_size = (block_size + POOL_ALIGNMENT - 1) & ~(POOL_ALIGNMENT - 1);
+}
+
+// --------------------------------------------------------------------------
+
+SlabPool::~SlabPool()
+{
+  for(size_t i = 0; i < m_slabs.size(); ++i) ::operator delete(m_slabs[i]);
+}
+
+// --------------------------------------------------------------------------
+
+void* SlabPool::allocate()
+{
+  ++m_used;
+
+  if(m_free)
+  {
+    FreeBlock *b = m_free;
+    m_free = b->next;
+    return b;
+  }
+
+  if(m_current == m_end)
+  {
+    const size_t size = m_block_size * m_blocks_per_slab;
+    m_current = static_cast<char*>(::operator new(size));
+    m_end = m_current + size;
+    m_slabs.push_back(m_current);
+  }
+
+  void *p = m_current;
+  m_current += m_block_size;
+  return p;
+}
+
+// --------------------------------------------------------------------------
+
+void SlabPool::deallocate(void *p)
+{
+  FreeBlock *b = static_cast<FreeBlock*>(p);
+  b->next = m_free;
+  m_free = b;
+  --m_used;
+}
+
+// --------------------------------------------------------------------------
+
+bool SlabPool::purge()
+{
+  if(m_used > 0) return false;
+
+  for(size_t i = 0; i < m_slabs.size(); ++i) ::operator delete(m_slabs[i]);
+  m_slabs.clear();
+  m_free = NULL;
+  m_current = m_end = NULL;
+  return true;
+}
+
+// --------------------------------------------------------------------------
+
+} // namespace DBoW2
@@ -0,0 +1,417 @@
+/**
+ * File: BinaryKernels.cpp
+ * Date: October 2026
+ * Description: vectorized kernels for binary descriptors
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "BinaryKernels.h"
+
+#if !defined(DBOW2_DISABLE_SIMD) && defined(__GNUC__) && \
+  (defined(__x86_64__) || defined(__i386__))
+#define DBOW2_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace DBoW2 {
+
+// --------------------------------------------------------------------------
+
+/// Counts the bits set in a word without special instructions
+static inline int popcountScalar(uint64_t v)
+{
+  v = v - ((v >> 1) & (uint64_t)~(uint64_t)0/3);
+  v = (v & (uint64_t)~(uint64_t)0/15*3) + ((v >> 2) &
+    (uint64_t)~(uint64_t)0/15*3);
+  v = (v + (v >> 4)) & (uint64_t)~(uint64_t)0/255*15;
+  return (int)((uint64_t)(v * ((uint64_t)~(uint64_t)0/255)) >> 56);
+}
+
+// --------------------------------------------------------------------------
+
+static int distanceScalar(const uint64_t *a, const uint64_t *b, int n)
+{
+  int s = 0;
+  for(int i = 0; i < n; ++i) s += popcountScalar(a[i] ^ b[i]);
+  return s;
+}
+
+// --------------------------------------------------------------------------
+
+static int countScalar(const uint64_t *a, int n)
+{
+  int s = 0;
+  for(int i = 0; i < n; ++i) s += popcountScalar(a[i]);
+  return s;
+}
+
+// --------------------------------------------------------------------------
+
+/// Bytes processed at once by the majority kernels
+static const int MAJORITY_BLOCK = 32;
+
+/// Maximum number of bit planes of the counters
+static const int MAX_PLANES = 32;
+
+/// Returns the number of bit planes needed to count up to n
+static inline int planesFor(int n)
+{
+  int b = 0;
+  while(b < MAX_PLANES && (n >> b) != 0) ++b;
+  return b;
+}
+
+// --------------------------------------------------------------------------
+
+/**
+ * Each block of 256 bits keeps one counter per bit, sliced in bit planes:
+ * plane b holds bit b of all the counters. A string is added with a ripple
+ * carry that stops as soon as no bit carries, which takes two steps on
+ * average. The counters are then compared with the threshold from the most
+ * significant plane down
+ */
+static void majorityScalar(const unsigned char *const *strings, int n,
+  int bytes, int threshold, unsigned char *mean)
+{
+  const int B = planesFor(n);
+
+  for(int offset = 0; offset < bytes; offset += MAJORITY_BLOCK)
+  {
+    const int len = std::min(MAJORITY_BLOCK, bytes - offset);
+
+    uint64_t planes[MAX_PLANES][4];
+    memset(planes, 0, B * sizeof(planes[0]));
+
+    for(int i = 0; i < n; ++i)
+    {
+      uint64_t x[4] = {0, 0, 0, 0};
+      memcpy(x, strings[i] + offset, len);
+
+      for(int w = 0; w < 4; ++w)
+      {
+        uint64_t carry = x[w];
+        for(int b = 0; carry; ++b)
+        {
+          const uint64_t t = planes[b][w] & carry;
+          planes[b][w] ^= carry;
+          carry = t;
+        }
+      }
+    }
+
+    uint64_t result[4];
+    for(int w = 0; w < 4; ++w)
+    {
+      uint64_t gt = 0, eq = ~(uint64_t)0;
+      for(int b = B - 1; b >= 0; --b)
+      {
+        const uint64_t t = ((threshold >> b) & 1) ? ~(uint64_t)0 : 0;
+        gt |= eq & planes[b][w] & ~t;
+        eq &= ~(planes[b][w] ^ t);
+      }
+      result[w] = gt | eq;
+    }
+
+    memcpy(mean + offset, result, len);
+  }
+}
+
+// --------------------------------------------------------------------------
+
+#ifdef DBOW2_X86_KERNELS
+
+__attribute__((target("popcnt")))
+static int distancePOPCNT(const uint64_t *a, const uint64_t *b, int n)
+{
+  int s = 0;
+  for(int i = 0; i < n; ++i) s += __builtin_popcountll(a[i] ^ b[i]);
+  return s;
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("popcnt")))
+static int countPOPCNT(const uint64_t *a, int n)
+{
+  int s = 0;
+  for(int i = 0; i < n; ++i) s += __builtin_popcountll(a[i]);
+  return s;
+}
+
+// --------------------------------------------------------------------------
+
+/// Counts the bits of each byte with a nibble lookup table and adds them up
+/// in four 64-bit lanes
+__attribute__((target("avx2,popcnt")))
+static inline __m256i popcountBytesAVX2(__m256i v)
+{
+  const __m256i lookup = _mm256_setr_epi8(
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+    0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const __m256i low = _mm256_set1_epi8(0x0f);
+
+  const __m256i lo = _mm256_and_si256(v, low);
+  const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), low);
+  const __m256i c = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo),
+    _mm256_shuffle_epi8(lookup, hi));
+  return _mm256_sad_epu8(c, _mm256_setzero_si256());
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx2,popcnt")))
+static int sumLanesAVX2(__m256i acc)
+{
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i*)lanes, acc);
+  return (int)(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx2,popcnt")))
+static int distanceAVX2(const uint64_t *a, const uint64_t *b, int n)
+{
+  // strings shorter than 8 words (a BRIEF descriptor has 4) are faster
+  // with POPCNT than with the final reduction of the lanes
+  int i = 0, s = 0;
+  if(n >= 8)
+  {
+    __m256i acc = _mm256_setzero_si256();
+    for(; i + 4 <= n; i += 4)
+    {
+      const __m256i v = _mm256_xor_si256(
+        _mm256_loadu_si256((const __m256i*)(a + i)),
+        _mm256_loadu_si256((const __m256i*)(b + i)));
+      acc = _mm256_add_epi64(acc, popcountBytesAVX2(v));
+    }
+    s = sumLanesAVX2(acc);
+  }
+
+  for(; i < n; ++i) s += __builtin_popcountll(a[i] ^ b[i]);
+  return s;
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx2,popcnt")))
+static int countAVX2(const uint64_t *a, int n)
+{
+  int i = 0, s = 0;
+  if(n >= 8)
+  {
+    __m256i acc = _mm256_setzero_si256();
+    for(; i + 4 <= n; i += 4)
+      acc = _mm256_add_epi64(acc, popcountBytesAVX2(
+        _mm256_loadu_si256((const __m256i*)(a + i))));
+    s = sumLanesAVX2(acc);
+  }
+
+  for(; i < n; ++i) s += __builtin_popcountll(a[i]);
+  return s;
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx2,popcnt")))
+static void majorityAVX2(const unsigned char *const *strings, int n,
+  int bytes, int threshold, unsigned char *mean)
+{
+  // same algorithm as majorityScalar, a block per register
+  const int B = planesFor(n);
+  const __m256i ones = _mm256_set1_epi8(-1);
+
+  for(int offset = 0; offset < bytes; offset += MAJORITY_BLOCK)
+  {
+    const int len = std::min(MAJORITY_BLOCK, bytes - offset);
+
+    __m256i planes[MAX_PLANES];
+    for(int b = 0; b < B; ++b) planes[b] = _mm256_setzero_si256();
+
+    for(int i = 0; i < n; ++i)
+    {
+      __m256i carry;
+      if(len == MAJORITY_BLOCK)
+      {
+        carry = _mm256_loadu_si256((const __m256i*)(strings[i] + offset));
+      }
+      else
+      {
+        unsigned char x[MAJORITY_BLOCK] = {0};
+        memcpy(x, strings[i] + offset, len);
+        carry = _mm256_loadu_si256((const __m256i*)x);
+      }
+
+      for(int b = 0; !_mm256_testz_si256(carry, carry); ++b)
+      {
+        const __m256i t = _mm256_and_si256(planes[b], carry);
+        planes[b] = _mm256_xor_si256(planes[b], carry);
+        carry = t;
+      }
+    }
+
+    __m256i gt = _mm256_setzero_si256(), eq = ones;
+    for(int b = B - 1; b >= 0; --b)
+    {
+      const __m256i t = ((threshold >> b) & 1) ? ones :
+        _mm256_setzero_si256();
+      gt = _mm256_or_si256(gt,
+        _mm256_and_si256(eq, _mm256_andnot_si256(t, planes[b])));
+      eq = _mm256_andnot_si256(_mm256_xor_si256(planes[b], t), eq);
+    }
+
+    unsigned char result[MAJORITY_BLOCK];
+    _mm256_storeu_si256((__m256i*)result, _mm256_or_si256(gt, eq));
+    memcpy(mean + offset, result, len);
+  }
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx512f,avx512vpopcntdq,popcnt")))
+static int sumLanesAVX512(__m512i acc)
+{
+  uint64_t lanes[8];
+  _mm512_storeu_si512(lanes, acc);
+  return (int)((lanes[0] + lanes[1]) + (lanes[2] + lanes[3]) +
+    (lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx512f,avx512vpopcntdq,popcnt")))
+static int distanceAVX512(const uint64_t *a, const uint64_t *b, int n)
+{
+  int i = 0, s = 0;
+  if(n >= 8)
+  {
+    __m512i acc = _mm512_setzero_si512();
+    for(; i + 8 <= n; i += 8)
+    {
+      const __m512i v = _mm512_xor_si512(_mm512_loadu_si512(a + i),
+        _mm512_loadu_si512(b + i));
+      acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(v));
+    }
+    s = sumLanesAVX512(acc);
+  }
+
+  for(; i < n; ++i) s += __builtin_popcountll(a[i] ^ b[i]);
+  return s;
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx512f,avx512vpopcntdq,popcnt")))
+static int countAVX512(const uint64_t *a, int n)
+{
+  int i = 0, s = 0;
+  if(n >= 8)
+  {
+    __m512i acc = _mm512_setzero_si512();
+    for(; i + 8 <= n; i += 8)
+      acc = _mm512_add_epi64(acc,
+        _mm512_popcnt_epi64(_mm512_loadu_si512(a + i)));
+    s = sumLanesAVX512(acc);
+  }
+
+  for(; i < n; ++i) s += __builtin_popcountll(a[i]);
+  return s;
+}
+
+#endif // DBOW2_X86_KERNELS
+
+// --------------------------------------------------------------------------
+
+/// Kernels of one instruction set
+struct BinaryKernelTable
+{
+  const char *name;
+  int (*distance)(const uint64_t *, const uint64_t *, int);
+  int (*count)(const uint64_t *, int);
+  void (*majority)(const unsigned char *const *, int, int, int,
+    unsigned char *);
+};
+
+// --------------------------------------------------------------------------
+
+static BinaryKernelTable selectKernels()
+{
+#ifdef DBOW2_X86_KERNELS
+  __builtin_cpu_init();
+
+  if(__builtin_cpu_supports("avx512vpopcntdq"))
+  {
+    // the 256-bit descriptors fill an AVX2 register for the majority
+    BinaryKernelTable k = { "AVX-512", distanceAVX512, countAVX512,
+      majorityAVX2 };
+    return k;
+  }
+  if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+  {
+    BinaryKernelTable k = { "AVX2", distanceAVX2, countAVX2,
+      majorityAVX2 };
+    return k;
+  }
+  if(__builtin_cpu_supports("popcnt"))
+  {
+    BinaryKernelTable k = { "POPCNT", distancePOPCNT, countPOPCNT,
+      majorityScalar };
+    return k;
+  }
+#endif
+
+  BinaryKernelTable k = { "scalar", distanceScalar, countScalar,
+    majorityScalar };
+  return k;
+}
+
+// --------------------------------------------------------------------------
+
+static const BinaryKernelTable& kernels()
+{
+  static const BinaryKernelTable table = selectKernels();
+  return table;
+}
+
+// --------------------------------------------------------------------------
+
+int BinaryKernels::distance(const uint64_t *a, const uint64_t *b, int n)
+{
+  return kernels().distance(a, b, n);
+}
+
+// --------------------------------------------------------------------------
+
+int BinaryKernels::count(const uint64_t *a, int n)
+{
+  return kernels().count(a, n);
+}
+
+// --------------------------------------------------------------------------
+
+void BinaryKernels::majority(const unsigned char *const *strings, int n,
+  int bytes, int threshold, unsigned char *mean)
+{
+  if(threshold <= 0 || threshold > n)
+  {
+    memset(mean, threshold <= 0 ? 0xff : 0, bytes);
+    return;
+  }
+
+  kernels().majority(strings, n, bytes, threshold, mean);
+}
+
+// --------------------------------------------------------------------------
+
+const char* BinaryKernels::instructionSet()
+{
+  return kernels().name;
+}
+
+// --------------------------------------------------------------------------
+
+} // namespace DBoW2
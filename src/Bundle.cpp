@@ -0,0 +1,286 @@
+/**
+ * File: Bundle.cpp
+ * Date: October 2026
+ * Description: single-file bundle of a vocabulary, its semantic classes and
+ *   a database, read through a memory map
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "Bundle.h"
+
+namespace DBoW2 {
+
+// --------------------------------------------------------------------------
+
+const char* const Bundle::VOCABULARY = "vocabulary";
+const char* const Bundle::CLASSES = "classes";
+const char* const Bundle::DATABASE = "database";
+
+/// First bytes of a bundle file
+static const char MAGIC[8] = { 'D', 'B', 'o', 'W', '2', 'B', 'D', 'L' };
+
+/// Version of the format
+static const uint32_t VERSION = 2;
+
+/// Size of the header and of the entries of the table of contents
+static const size_t HEADER_SIZE = 32;
+static const size_t ENTRY_SIZE = 32;
+
+/// Longest section name, followed by at least one zero
+static const size_t NAME_SIZE = 16;
+
+/// Alignment of the sections in the file
+static const size_t SECTION_ALIGNMENT = 64;
+
+// --------------------------------------------------------------------------
+
+Bundle::Bundle()
+  : m_data(NULL), m_size(0), m_mapped(false)
+{
+}
+
+// --------------------------------------------------------------------------
+
+Bundle::Bundle(const std::string &filename)
+  : m_data(NULL), m_size(0), m_mapped(false)
+{
+  open(filename);
+}
+
+// --------------------------------------------------------------------------
+
+Bundle::~Bundle()
+{
+  close();
+}
+
+// --------------------------------------------------------------------------
+
+void Bundle::open(const std::string &filename)
+{
+  close();
+
+#ifndef _WIN32
+  const int fd = ::open(filename.c_str(), O_RDONLY);
+  if(fd < 0) throw std::string("Could not open file ") + filename;
+
+  struct stat st;
+  if(fstat(fd, &st) != 0 || st.st_size <= 0)
+  {
+    ::close(fd);
+    throw std::string("Could not read file ") + filename;
+  }
+
+  void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // the mapping keeps the file
+
+  if(p == MAP_FAILED) throw std::string("Could not map file ") + filename;
+
+  m_data = static_cast<const unsigned char*>(p);
+  m_size = (size_t)st.st_size;
+  m_mapped = true;
+#else
+  std::ifstream f(filename.c_str(), std::ios::binary);
+  if(!f.is_open()) throw std::string("Could not open file ") + filename;
+
+  f.seekg(0, std::ios::end);
+  m_buffer.resize((size_t)f.tellg());
+  f.seekg(0, std::ios::beg);
+  if(m_buffer.empty() ||
+    !f.read(reinterpret_cast<char*>(&m_buffer[0]), m_buffer.size()))
+  {
+    m_buffer.clear();
+    throw std::string("Could not read file ") + filename;
+  }
+
+  m_data = &m_buffer[0];
+  m_size = m_buffer.size();
+  m_mapped = false;
+#endif
+
+  try
+  {
+    readContents(filename);
+  }
+  catch(...)
+  {
+    close();
+    throw;
+  }
+}
+
+// --------------------------------------------------------------------------
+
+void Bundle::close()
+{
+#ifndef _WIN32
+  if(m_mapped && m_data) munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+
+  m_data = NULL;
+  m_size = 0;
+  m_mapped = false;
+  m_buffer.clear();
+  m_contents.clear();
+}
+
+// --------------------------------------------------------------------------
+
+void Bundle::readContents(const std::string &filename)
+{
+  BundleSection header(m_data, m_size);
+
+  if(m_size < HEADER_SIZE ||
+    std::memcmp(header.skip(sizeof(MAGIC)), MAGIC, sizeof(MAGIC)) != 0)
+    throw filename + " is not a bundle file";
+
+  const uint32_t version = header.read<uint32_t>();
+  const uint32_t sections = header.read<uint32_t>();
+  const uint64_t size = header.read<uint64_t>();
+
+  if(version != VERSION)
+  {
+    std::stringstream ss;
+    ss << "Unsupported version " << version << " of bundle " << filename;
+    throw ss.str();
+  }
+
+  if(size != m_size ||
+    sections > (m_size - HEADER_SIZE) / ENTRY_SIZE)
+    throw std::string("Truncated bundle file ") + filename;
+
+  BundleSection toc(m_data + HEADER_SIZE, sections * ENTRY_SIZE);
+  m_contents.resize(sections);
+
+  for(uint32_t i = 0; i < sections; ++i)
+  {
+    const char *name = reinterpret_cast<const char*>(toc.skip(NAME_SIZE));
+    m_contents[i].name.assign(name, std::find(name, name + NAME_SIZE - 1,
+      '\0'));
+    m_contents[i].offset = toc.read<uint64_t>();
+    m_contents[i].size = toc.read<uint64_t>();
+
+    if(m_contents[i].offset > m_size ||
+      m_contents[i].size > m_size - m_contents[i].offset)
+      throw std::string("Truncated bundle file ") + filename;
+  }
+}
+
+// --------------------------------------------------------------------------
+
+bool Bundle::has(const std::string &name) const
+{
+  for(size_t i = 0; i < m_contents.size(); ++i)
+    if(m_contents[i].name == name) return true;
+  return false;
+}
+
+// --------------------------------------------------------------------------
+
+BundleSection Bundle::section(const std::string &name) const
+{
+  for(size_t i = 0; i < m_contents.size(); ++i)
+  {
+    if(m_contents[i].name == name)
+      return BundleSection(m_data + m_contents[i].offset,
+        (size_t)m_contents[i].size);
+  }
+
+  throw std::string("The bundle has no section ") + name;
+}
+
+// --------------------------------------------------------------------------
+
+std::vector<std::string> Bundle::names() const
+{
+  std::vector<std::string> ret;
+  for(size_t i = 0; i < m_contents.size(); ++i)
+    ret.push_back(m_contents[i].name);
+  return ret;
+}
+
+// --------------------------------------------------------------------------
+
+void BundleWriter::add(const std::string &name, const std::string &data)
+{
+  if(name.empty() || name.size() >= NAME_SIZE ||
+    name.find('\0') != std::string::npos)
+  {
+    std::stringstream ss;
+    ss << "Invalid bundle section name \"" << name << "\" (1 to "
+      << NAME_SIZE - 1 << " characters)";
+    throw ss.str();
+  }
+
+  for(size_t i = 0; i < m_sections.size(); ++i)
+  {
+    if(m_sections[i].first == name)
+    {
+      m_sections[i].second = data;
+      return;
+    }
+  }
+
+  m_sections.push_back(std::make_pair(name, data));
+}
+
+// --------------------------------------------------------------------------
+
+void BundleWriter::write(const std::string &filename) const
+{
+  // layout
+  std::vector<uint64_t> offsets(m_sections.size());
+  uint64_t size = HEADER_SIZE + m_sections.size() * ENTRY_SIZE;
+  for(size_t i = 0; i < m_sections.size(); ++i)
+  {
+    size = (size + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT *
+      SECTION_ALIGNMENT;
+    offsets[i] = size;
+    size += m_sections[i].second.size();
+  }
+
+  std::ofstream f(filename.c_str(), std::ios::binary);
+  if(!f.is_open()) throw std::string("Could not open file ") + filename;
+
+  f.write(MAGIC, sizeof(MAGIC));
+  BundleSection::write(f, VERSION);
+  BundleSection::write(f, (uint32_t)m_sections.size());
+  BundleSection::write(f, size);
+  BundleSection::write(f, (uint64_t)0); // reserved
+
+  for(size_t i = 0; i < m_sections.size(); ++i)
+  {
+    char name[NAME_SIZE] = { 0 };
+    m_sections[i].first.copy(name, NAME_SIZE - 1);
+    f.write(name, NAME_SIZE);
+    BundleSection::write(f, offsets[i]);
+    BundleSection::write(f, (uint64_t)m_sections[i].second.size());
+  }
+
+  uint64_t pos = HEADER_SIZE + m_sections.size() * ENTRY_SIZE;
+  const char padding[SECTION_ALIGNMENT] = { 0 };
+  for(size_t i = 0; i < m_sections.size(); ++i)
+  {
+    f.write(padding, offsets[i] - pos);
+    f.write(m_sections[i].second.data(), m_sections[i].second.size());
+    pos = offsets[i] + m_sections[i].second.size();
+  }
+
+  if(!f) throw std::string("Could not write file ") + filename;
+}
+
+// --------------------------------------------------------------------------
+
+} // namespace DBoW2
@@ -0,0 +1,102 @@
+/**
+ * File: DatabaseStats.cpp
+ * Date: October 2026
+ * Description: memory usage and posting list statistics of a database
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <algorithm>
+
+#include "DatabaseStats.h"
+
+namespace DBoW2 {
+
+// --------------------------------------------------------------------------
+
+/// Orders words (or classes) by descending length (or count), and ascending
+/// id on ties
+template<class T>
+static bool heavier(const std::pair<T, unsigned long> &a,
+  const std::pair<T, unsigned long> &b)
+{
+  return a.second > b.second || (a.second == b.second && a.first < b.first);
+}
+
+// --------------------------------------------------------------------------
+
+void DatabaseStats::findHeaviestWords(
+  const std::vector<unsigned long> &lengths, size_t n)
+{
+  heaviest_words.clear();
+  heaviest_words.reserve(lengths.size());
+  for(WordId wid = 0; wid < lengths.size(); ++wid)
+    if(lengths[wid] > 0) heaviest_words.push_back(std::make_pair(wid,
+      lengths[wid]));
+
+  n = std::min(n, heaviest_words.size());
+  std::partial_sort(heaviest_words.begin(), heaviest_words.begin() + n,
+    heaviest_words.end(), heavier<WordId>);
+  heaviest_words.resize(n);
+}
+
+// --------------------------------------------------------------------------
+
+void DatabaseStats::sortDroppedClasses()
+{
+  std::sort(dropped_classes.begin(), dropped_classes.end(), heavier<int>);
+}
+
+// --------------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream &os, const DatabaseStats &stats)
+{
+  const double KB = 1024.;
+
+  os << "Memory: " << stats.total() / KB << " KB (inverted file "
+    << stats.inverted_file / KB << " KB, direct file "
+    << stats.direct_file / KB << " KB, semantic "
+    << stats.semantic / KB << " KB, overhead "
+    << stats.overhead / KB << " KB)" << std::endl
+    << "Postings: " << stats.postings << std::endl
+    << "Posting list length: " << stats.posting_lengths << std::endl;
+
+  const std::vector<unsigned long> &buckets = stats.posting_lengths.buckets();
+  for(size_t i = 0; i < buckets.size(); ++i)
+  {
+    if(buckets[i] == 0) continue;
+    os << "  < " << Histogram::bucketLimit(i) << ": " << buckets[i]
+      << " words" << std::endl;
+  }
+
+  if(!stats.heaviest_words.empty())
+  {
+    os << "Heaviest words:";
+    for(size_t i = 0; i < stats.heaviest_words.size(); ++i)
+      os << " " << stats.heaviest_words[i].first << " ("
+        << stats.heaviest_words[i].second << ")";
+    os << std::endl;
+  }
+
+  if(stats.dropped_features > 0 || stats.weighted_features > 0)
+  {
+    os << "Dropped features: " << stats.dropped_features
+      << ", down-weighted features: " << stats.weighted_features
+      << std::endl;
+
+    if(!stats.dropped_classes.empty())
+    {
+      os << "Dropped by class:";
+      for(size_t i = 0; i < stats.dropped_classes.size(); ++i)
+        os << " " << stats.dropped_classes[i].first << " ("
+          << stats.dropped_classes[i].second << ")";
+      os << std::endl;
+    }
+  }
+
+  return os;
+}
+
+// --------------------------------------------------------------------------
+
+} // namespace DBoW2
@@ -10,8 +10,11 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <istream>
+#include <ostream>
 
 #include "FBrief.h"
+#include "QuantizationCache.h"
 
 using namespace std;
 
@@ -19,6 +22,94 @@ namespace DBoW2 {
 
 // --------------------------------------------------------------------------
 
+/// Reads the words of a descriptor from the bytes of a matrix row, in which
+/// bit i is bit i % 8 of byte i / 8
+static inline void loadWords(const unsigned char *p, uint64_t *w)
+{
+  for(int j = 0; j < BriefDescriptor::WORDS; ++j, p += 8)
+  {
+    w[j] = (uint64_t)p[0]       | (uint64_t)p[1] << 8  |
+           (uint64_t)p[2] << 16 | (uint64_t)p[3] << 24 |
+           (uint64_t)p[4] << 32 | (uint64_t)p[5] << 40 |
+           (uint64_t)p[6] << 48 | (uint64_t)p[7] << 56;
+  }
+}
+
+// --------------------------------------------------------------------------
+
+BriefDescriptor::BriefDescriptor(const std::bitset<L> &b)
+{
+  const std::bitset<L> mask(~0ULL);
+  for(int i = 0; i < WORDS; ++i)
+  {
+    m_words[i] = ((b >> (64 * i)) & mask).to_ullong();
+  }
+}
+
+// --------------------------------------------------------------------------
+
+std::bitset<BriefDescriptor::L> BriefDescriptor::to_bitset() const
+{
+  std::bitset<L> b;
+  for(int i = WORDS - 1; i >= 0; --i)
+  {
+    b <<= 64;
+    b |= std::bitset<L>(m_words[i]);
+  }
+  return b;
+}
+
+// --------------------------------------------------------------------------
+
+std::string BriefDescriptor::to_string() const
+{
+  std::string s(L, '0');
+  for(int i = 0; i < L; ++i)
+  {
+    if(test(i)) s[L - 1 - i] = '1';
+  }
+  return s;
+}
+
+// --------------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream &os, const BriefDescriptor &a)
+{
+  return os << a.to_string();
+}
+
+// --------------------------------------------------------------------------
+
+std::istream& operator>>(std::istream &is, BriefDescriptor &a)
+{
+  // as std::bitset, reads up to L digits; the last one read is bit 0
+  char digits[BriefDescriptor::L];
+  int n = 0;
+
+  is >> std::ws;
+  while(n < BriefDescriptor::L)
+  {
+    const int c = is.peek();
+    if(c != '0' && c != '1') break;
+    digits[n++] = (char)is.get();
+  }
+
+  if(n == 0)
+  {
+    is.setstate(std::ios::failbit);
+    return is;
+  }
+
+  a.reset();
+  for(int i = 0; i < n; ++i)
+  {
+    if(digits[n - 1 - i] == '1') a.set(i);
+  }
+  return is;
+}
+
+// --------------------------------------------------------------------------
+
 void FBrief::meanValue(const std::vector<FBrief::pDescriptor> &descriptors, 
   FBrief::TDescriptor &mean)
 {
@@ -26,48 +117,118 @@ void FBrief::meanValue(const std::vector<FBrief::pDescriptor> &descriptors,
   
   if(descriptors.empty()) return;
   
-  const int N2 = descriptors.size() / 2;
-  
-  vector<int> counters(FBrief::L, 0);
-
-  vector<FBrief::pDescriptor>::const_iterator it;
-  for(it = descriptors.begin(); it != descriptors.end(); ++it)
+  vector<const unsigned char*> strings(descriptors.size());
+  for(size_t i = 0; i < descriptors.size(); ++i)
   {
-    const FBrief::TDescriptor &desc = **it;
-    for(int i = 0; i < FBrief::L; ++i)
-    {
-      if(desc[i]) counters[i]++;
-    }
-  }
-  
-  for(int i = 0; i < FBrief::L; ++i)
-  {
-    if(counters[i] > N2) mean.set(i);
+    strings[i] = reinterpret_cast<const unsigned char*>(
+      descriptors[i]->words());
   }
   
+  // a bit is set if it is in more than half of the descriptors
+  const int N2 = descriptors.size() / 2;
+  BinaryKernels::majority(&strings[0], (int)strings.size(), FBrief::L / 8,
+    N2 + 1, reinterpret_cast<unsigned char*>(mean.words()));
 }
 
 // --------------------------------------------------------------------------
-  
-double FBrief::distance(const FBrief::TDescriptor &a, 
-  const FBrief::TDescriptor &b)
+
+uint64_t FBrief::hash(const FBrief::TDescriptor &a)
 {
-  return (double)(a^b).count();
+  return QuantizationCache::hashBytes(a.words(),
+    TDescriptor::WORDS * sizeof(uint64_t));
+}
+
+// --------------------------------------------------------------------------
+
+double FBrief::distance(const unsigned char *a, const FBrief::TDescriptor &b)
+{
+  uint64_t w[TDescriptor::WORDS];
+  loadWords(a, w);
+  return (double)BinaryKernels::distance(w, b.words(), TDescriptor::WORDS);
+}
+
+// --------------------------------------------------------------------------
+
+uint64_t FBrief::hash(const unsigned char *a)
+{
+  uint64_t w[TDescriptor::WORDS];
+  loadWords(a, w);
+  return QuantizationCache::hashBytes(w, sizeof(w));
 }
 
 // --------------------------------------------------------------------------
   
 std::string FBrief::toString(const FBrief::TDescriptor &a)
 {
-  return a.to_string(); // reversed
+  // hex digits from bit L-1 to bit 0, the order of to_string, read from the
+  // words 4 bits at a time
+  static const char hex[] = "0123456789abcdef";
+  const int digits = FBrief::L / 4;
+  const uint64_t *w = a.words();
+
+  std::string s(digits, '0');
+  for(int i = 0; i < digits; ++i)
+    s[digits - 1 - i] = hex[(w[i / 16] >> ((i % 16) * 4)) & 0xf];
+  return s;
 }
 
 // --------------------------------------------------------------------------
   
 void FBrief::fromString(FBrief::TDescriptor &a, const std::string &s)
 {
-  stringstream ss(s);
-  ss >> a;
+  const int digits = FBrief::L / 4;
+
+  const char *p = s.c_str();
+  while(*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') ++p;
+  int n = 0;
+  while(p[n] != '\0' && p[n] != ' ' && p[n] != '\t' && p[n] != '\r' &&
+    p[n] != '\n') ++n;
+
+  a.reset();
+  uint64_t *w = a.words();
+
+  if(n == digits)
+  {
+    // written by toString, the last digit holds bits 0..3
+    for(int i = 0; i < digits; ++i)
+    {
+      const char c = p[digits - 1 - i];
+      uint64_t v;
+      if(c >= '0' && c <= '9') v = c - '0';
+      else if(c >= 'a' && c <= 'f') v = c - 'a' + 10;
+      else if(c >= 'A' && c <= 'F') v = c - 'A' + 10;
+      else v = 0;
+      w[i / 16] |= v << ((i % 16) * 4);
+    }
+  }
+  else
+  {
+    // a bit per digit, as std::bitset writes them (older vocabularies):
+    // up to L digits, the last one is bit 0
+    int bits = 0;
+    while(bits < n && bits < FBrief::L && (p[bits] == '0' || p[bits] == '1'))
+      ++bits;
+
+    for(int i = 0; i < bits; ++i)
+      if(p[bits - 1 - i] == '1') w[i / 64] |= (uint64_t)1 << (i % 64);
+  }
+}
+
+// --------------------------------------------------------------------------
+
+void FBrief::toBytes(const FBrief::TDescriptor &a, unsigned char *p)
+{
+  // layout of OpenCV binary descriptors, as in toMat8U
+  const uint64_t *w = a.words();
+  for(int i = 0; i < FBrief::L / 8; ++i)
+    p[i] = (unsigned char)(w[i / 8] >> ((i % 8) * 8));
+}
+
+// --------------------------------------------------------------------------
+
+void FBrief::fromBytes(FBrief::TDescriptor &a, const unsigned char *p)
+{
+  fromBlocks(p, a);
 }
 
 // --------------------------------------------------------------------------
@@ -87,16 +248,65 @@ void FBrief::toMat32F(const std::vector<TDescriptor> &descriptors,
   
   for(int i = 0; i < N; ++i)
   {
-    const TDescriptor& desc = descriptors[i];
+    const uint64_t *w = descriptors[i].words();
     float *p = mat.ptr<float>(i);
     for(int j = 0; j < FBrief::L; ++j, ++p)
     {
-      *p = (desc[j] ? 1.f : 0.f);
+      *p = (float)((w[j >> 6] >> (j & 63)) & 1);
     }
   } 
 }
 
 // --------------------------------------------------------------------------
 
-} // namespace DBoW2
+void FBrief::fromMat8U(const cv::Mat &mat,
+  std::vector<TDescriptor> &descriptors)
+{
+  descriptors.clear();
+  if(mat.empty()) return;
+
+  if(mat.type() != CV_8U || mat.cols != FBrief::L / 8)
+  {
+    stringstream ss;
+    ss << "Expected a descriptor matrix of " << FBrief::L / 8
+      << " CV_8U columns, got " << mat.cols << " columns of type "
+      << mat.type();
+    throw ss.str();
+  }
+
+  descriptors.resize(mat.rows);
+  for(int i = 0; i < mat.rows; ++i)
+  {
+    loadWords(mat.ptr<unsigned char>(i), descriptors[i].words());
+  }
+}
+
+// --------------------------------------------------------------------------
+
+void FBrief::toMat8U(const std::vector<TDescriptor> &descriptors,
+  cv::Mat &mat)
+{
+  if(descriptors.empty())
+  {
+    mat.release();
+    return;
+  }
+
+  const int N = descriptors.size();
+
+  mat.create(N, FBrief::L / 8, CV_8U);
+
+  for(int i = 0; i < N; ++i)
+  {
+    const uint64_t *w = descriptors[i].words();
+    unsigned char *p = mat.ptr<unsigned char>(i);
+    for(int j = 0; j < FBrief::L / 8; ++j)
+    {
+      p[j] = (unsigned char)(w[j >> 3] >> (8 * (j & 7)));
+    }
+  }
+}
+
+// --------------------------------------------------------------------------
 
+} // namespace DBoW2
\ No newline at end of file
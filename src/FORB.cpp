@@ -7,6 +7,7 @@
  *
  */
  
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <sstream>
@@ -14,6 +15,8 @@
 #include <limits.h>
 
 #include "FORB.h"
+#include "QuantizationCache.h"
+#include "BinaryKernels.h"
 
 using namespace std;
 
@@ -35,40 +38,18 @@ void FORB::meanValue(const std::vector<FORB::pDescriptor> &descriptors,
   }
   else
   {
-    vector<int> sum(FORB::L * 8, 0);
-    
+    vector<const unsigned char*> strings(descriptors.size());
     for(size_t i = 0; i < descriptors.size(); ++i)
     {
-      const cv::Mat &d = *descriptors[i];
-      const unsigned char *p = d.ptr<unsigned char>();
-      
-      for(int j = 0; j < d.cols; ++j, ++p)
-      {
-        if(*p & (1 << 7)) ++sum[ j*8     ];
-        if(*p & (1 << 6)) ++sum[ j*8 + 1 ];
-        if(*p & (1 << 5)) ++sum[ j*8 + 2 ];
-        if(*p & (1 << 4)) ++sum[ j*8 + 3 ];
-        if(*p & (1 << 3)) ++sum[ j*8 + 4 ];
-        if(*p & (1 << 2)) ++sum[ j*8 + 5 ];
-        if(*p & (1 << 1)) ++sum[ j*8 + 6 ];
-        if(*p & (1))      ++sum[ j*8 + 7 ];
-      }
+      strings[i] = descriptors[i]->ptr<unsigned char>();
     }
     
     mean = cv::Mat::zeros(1, FORB::L, CV_8U);
-    unsigned char *p = mean.ptr<unsigned char>();
     
+    // a bit is set if it is in at least half of the descriptors
     const int N2 = (int)descriptors.size() / 2 + descriptors.size() % 2;
-    for(size_t i = 0; i < sum.size(); ++i)
-    {
-      if(sum[i] >= N2)
-      {
-        // set bit
-        *p |= 1 << (7 - (i % 8));
-      }
-      
-      if(i % 8 == 7) ++p;
-    }
+    BinaryKernels::majority(&strings[0], (int)strings.size(), FORB::L, N2,
+      mean.ptr<unsigned char>());
   }
 }
 
@@ -76,17 +57,24 @@ void FORB::meanValue(const std::vector<FORB::pDescriptor> &descriptors,
   
 double FORB::distance(const FORB::TDescriptor &a, 
   const FORB::TDescriptor &b)
+{
+  return distance(a.ptr<unsigned char>(), b);
+}
+
+// --------------------------------------------------------------------------
+
+double FORB::distance(const unsigned char *a, const FORB::TDescriptor &b)
 {
   // Bit count function got from:
   // http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetKernighan
-  // This implementation assumes that a.cols (CV_8U) % sizeof(uint64_t) == 0
+  // This implementation assumes that b.cols (CV_8U) % sizeof(uint64_t) == 0
   
   const uint64_t *pa, *pb;
-  pa = a.ptr<uint64_t>(); // a & b are actually CV_8U
+  pa = reinterpret_cast<const uint64_t*>(a); // a & b are actually CV_8U
   pb = b.ptr<uint64_t>(); 
   
   uint64_t v, ret = 0;
-  for(size_t i = 0; i < a.cols / sizeof(uint64_t); ++i, ++pa, ++pb)
+  for(size_t i = 0; i < b.cols / sizeof(uint64_t); ++i, ++pa, ++pb)
   {
     v = *pa ^ *pb;
     v = v - ((v >> 1) & (uint64_t)~(uint64_t)0/3);
@@ -114,6 +102,20 @@ double FORB::distance(const FORB::TDescriptor &a,
   // return ret;
 }
 
+// --------------------------------------------------------------------------
+
+uint64_t FORB::hash(const FORB::TDescriptor &a)
+{
+  return QuantizationCache::hashBytes(a.ptr<unsigned char>(), a.cols);
+}
+
+// --------------------------------------------------------------------------
+
+uint64_t FORB::hash(const unsigned char *a)
+{
+  return QuantizationCache::hashBytes(a, FORB::L);
+}
+
 // --------------------------------------------------------------------------
   
 std::string FORB::toString(const FORB::TDescriptor &a)
@@ -150,6 +152,22 @@ void FORB::fromString(FORB::TDescriptor &a, const std::string &s)
 
 // --------------------------------------------------------------------------
 
+void FORB::toBytes(const FORB::TDescriptor &a, unsigned char *p)
+{
+  const unsigned char *d = a.ptr<unsigned char>();
+  std::copy(d, d + FORB::L, p);
+}
+
+// --------------------------------------------------------------------------
+
+void FORB::fromBytes(FORB::TDescriptor &a, const unsigned char *p)
+{
+  a.create(1, FORB::L, CV_8U);
+  std::copy(p, p + FORB::L, a.ptr<unsigned char>());
+}
+
+// --------------------------------------------------------------------------
+
 void FORB::toMat32F(const std::vector<TDescriptor> &descriptors, 
   cv::Mat &mat)
 {
@@ -7,6 +7,7 @@
  *
  */
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <sstream>
@@ -15,6 +16,8 @@
 #include <limits.h>
 
 #include "FSORB.h"
+#include "QuantizationCache.h"
+#include "BinaryKernels.h"
 
 using namespace std;
 
@@ -37,40 +40,18 @@ void FSORB::meanValue(const std::vector<FSORB::pDescriptor> &descriptors,
   }
   else
   {
-    vector<int> sum(FSORB::L * 8, 0);
-
+    vector<const unsigned char*> strings(descriptors.size());
     for(size_t i = 0; i < descriptors.size(); ++i)
     {
-      const cv::Mat &d = (*descriptors[i]).first;
-      const unsigned char *p = d.ptr<unsigned char>();
-
-      for(int j = 0; j < d.cols; ++j, ++p)
-      {
-        if(*p & (1 << 7)) ++sum[ j*8     ];
-        if(*p & (1 << 6)) ++sum[ j*8 + 1 ];
-        if(*p & (1 << 5)) ++sum[ j*8 + 2 ];
-        if(*p & (1 << 4)) ++sum[ j*8 + 3 ];
-        if(*p & (1 << 3)) ++sum[ j*8 + 4 ];
-        if(*p & (1 << 2)) ++sum[ j*8 + 5 ];
-        if(*p & (1 << 1)) ++sum[ j*8 + 6 ];
-        if(*p & (1))      ++sum[ j*8 + 7 ];
-      }
+      strings[i] = (*descriptors[i]).first.ptr<unsigned char>();
     }
 
     mean_ref = cv::Mat::zeros(1, FSORB::L, CV_8U);
-    unsigned char *p = mean_ref.ptr<unsigned char>();
 
+    // a bit is set if it is in at least half of the descriptors
     const int N2 = (int)descriptors.size() / 2 + descriptors.size() % 2;
-    for(size_t i = 0; i < sum.size(); ++i)
-    {
-      if(sum[i] >= N2)
-      {
-        // set bit
-        *p |= 1 << (7 - (i % 8));
-      }
-
-      if(i % 8 == 7) ++p;
-    }
+    BinaryKernels::majority(&strings[0], (int)strings.size(), FSORB::L, N2,
+      mean_ref.ptr<unsigned char>());
   }
 }
 
@@ -78,17 +59,24 @@ void FSORB::meanValue(const std::vector<FSORB::pDescriptor> &descriptors,
 
 double FSORB::distance(const FSORB::TDescriptor &a,
   const FSORB::TDescriptor &b)
+{
+  return distance((a.first).ptr<unsigned char>(), b);
+}
+
+// --------------------------------------------------------------------------
+
+double FSORB::distance(const unsigned char *a, const FSORB::TDescriptor &b)
 {
   // Bit count function got from:
   // http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetKernighan
-  // This implementation assumes that a.cols (CV_8U) % sizeof(uint64_t) == 0
+  // This implementation assumes that b.cols (CV_8U) % sizeof(uint64_t) == 0
 
   const uint64_t *pa, *pb;
-  pa = (a.first).ptr<uint64_t>(); // a & b are actually CV_8U
+  pa = reinterpret_cast<const uint64_t*>(a); // a & b are actually CV_8U
   pb = (b.first).ptr<uint64_t>();
 
   uint64_t v, ret = 0;
-  for(size_t i = 0; i < (a.first).cols / sizeof(uint64_t); ++i, ++pa, ++pb)
+  for(size_t i = 0; i < (b.first).cols / sizeof(uint64_t); ++i, ++pa, ++pb)
   {
     v = *pa ^ *pb;
     v = v - ((v >> 1) & (uint64_t)~(uint64_t)0/3);
@@ -118,6 +106,22 @@ double FSORB::distance(const FSORB::TDescriptor &a,
 
 // --------------------------------------------------------------------------
 
+uint64_t FSORB::hash(const FSORB::TDescriptor &a)
+{
+  // the semantic class does not take part in the distance
+  return QuantizationCache::hashBytes((a.first).ptr<unsigned char>(),
+    (a.first).cols);
+}
+
+// --------------------------------------------------------------------------
+
+uint64_t FSORB::hash(const unsigned char *a)
+{
+  return QuantizationCache::hashBytes(a, FSORB::L);
+}
+
+// --------------------------------------------------------------------------
+
 std::string FSORB::toString(const FSORB::TDescriptor &a)
 {
   stringstream ss;
@@ -152,6 +156,22 @@ void FSORB::fromString(FSORB::TDescriptor &a, const std::string &s)
 
 // --------------------------------------------------------------------------
 
+void FSORB::toBytes(const FSORB::TDescriptor &a, unsigned char *p)
+{
+  const unsigned char *d = (a.first).ptr<unsigned char>();
+  std::copy(d, d + FSORB::L, p);
+}
+
+// --------------------------------------------------------------------------
+
+void FSORB::fromBytes(FSORB::TDescriptor &a, const unsigned char *p)
+{
+  (a.first).create(1, FSORB::L, CV_8U);
+  std::copy(p, p + FSORB::L, (a.first).ptr<unsigned char>());
+}
+
+// --------------------------------------------------------------------------
+
 void FSORB::toMat32F(const std::vector<TDescriptor> &descriptors,
   cv::Mat &mat)
 {
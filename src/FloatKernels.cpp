@@ -0,0 +1,515 @@
+/**
+ * File: FloatKernels.cpp
+ * Date: October 2026
+ * Description: vectorized kernels for float descriptors
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <cstring>
+
+#include "FloatKernels.h"
+
+#if !defined(DBOW2_DISABLE_SIMD) && defined(__GNUC__) && \
+  (defined(__x86_64__) || defined(__i386__))
+#define DBOW2_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace DBoW2 {
+
+// --------------------------------------------------------------------------
+
+static float squaredDistanceScalar(const float *a, const float *b, int n)
+{
+  float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+
+  int i = 0;
+  for(; i + 4 <= n; i += 4)
+  {
+    const float d0 = a[i  ] - b[i  ];
+    const float d1 = a[i+1] - b[i+1];
+    const float d2 = a[i+2] - b[i+2];
+    const float d3 = a[i+3] - b[i+3];
+    s0 += d0 * d0;
+    s1 += d1 * d1;
+    s2 += d2 * d2;
+    s3 += d3 * d3;
+  }
+  for(; i < n; ++i)
+  {
+    const float d = a[i] - b[i];
+    s0 += d * d;
+  }
+
+  return (s0 + s1) + (s2 + s3);
+}
+
+// --------------------------------------------------------------------------
+
+static void accumulateScalar(float *sum, const float *a, int n)
+{
+  for(int i = 0; i < n; ++i) sum[i] += a[i];
+}
+
+// --------------------------------------------------------------------------
+
+static void scaleScalar(float *a, float s, int n)
+{
+  for(int i = 0; i < n; ++i) a[i] *= s;
+}
+
+// --------------------------------------------------------------------------
+
+static int squaredDistanceInt8Scalar(const int8_t *a, const int8_t *b, int n)
+{
+  int s = 0;
+  for(int i = 0; i < n; ++i)
+  {
+    const int d = (int)a[i] - (int)b[i];
+    s += d * d;
+  }
+  return s;
+}
+
+// --------------------------------------------------------------------------
+
+/// Converts a float to half precision, rounding to nearest even
+static uint16_t floatToHalf(float f)
+{
+  uint32_t x;
+  memcpy(&x, &f, sizeof(x));
+
+  const uint16_t sign = (uint16_t)((x >> 16) & 0x8000);
+  x &= 0x7fffffff;
+
+  if(x >= 0x7f800000) // inf or nan
+    return sign | (x > 0x7f800000 ? 0x7e00 : 0x7c00);
+  if(x >= 0x477ff000) // rounds above 65504
+    return sign | 0x7c00;
+
+  uint32_t h, rem, half;
+  if(x < 0x38800000)
+  {
+    // subnormal half, in units of 2^-24
+    if(x < 0x33000000) return sign; // rounds to 0
+    const uint32_t m = (x & 0x7fffff) | 0x800000;
+    const int shift = 126 - (int)(x >> 23);
+    h = m >> shift;
+    rem = m & ((1u << shift) - 1);
+    half = 1u << (shift - 1);
+  }
+  else
+  {
+    // rebias the exponent from 127 to 15
+    h = (x - 0x38000000) >> 13;
+    rem = x & 0x1fff;
+    half = 0x1000;
+  }
+
+  if(rem > half || (rem == half && (h & 1))) ++h;
+  return sign | (uint16_t)h;
+}
+
+// --------------------------------------------------------------------------
+
+/// Converts a half precision value to float
+static float halfToFloat(uint16_t h)
+{
+  const uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+  uint32_t e = (h >> 10) & 0x1f;
+  uint32_t m = h & 0x3ff;
+
+  uint32_t x;
+  if(e == 0)
+  {
+    if(m == 0) x = sign;
+    else
+    {
+      // subnormal: normalize the mantissa
+      e = 113;
+      while(!(m & 0x400))
+      {
+        m <<= 1;
+        --e;
+      }
+      x = sign | (e << 23) | ((m & 0x3ff) << 13);
+    }
+  }
+  else if(e == 31) x = sign | 0x7f800000 | (m << 13);
+  else x = sign | ((e + 112) << 23) | (m << 13);
+
+  float f;
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+// --------------------------------------------------------------------------
+
+static float squaredDistanceHalfScalar(const float *a, const uint16_t *b,
+  int n)
+{
+  float s = 0.f;
+  for(int i = 0; i < n; ++i)
+  {
+    const float d = a[i] - halfToFloat(b[i]);
+    s += d * d;
+  }
+  return s;
+}
+
+// --------------------------------------------------------------------------
+
+static void toHalfScalar(const float *a, uint16_t *h, int n)
+{
+  for(int i = 0; i < n; ++i) h[i] = floatToHalf(a[i]);
+}
+
+// --------------------------------------------------------------------------
+
+static void fromHalfScalar(const uint16_t *h, float *a, int n)
+{
+  for(int i = 0; i < n; ++i) a[i] = halfToFloat(h[i]);
+}
+
+// --------------------------------------------------------------------------
+
+#ifdef DBOW2_X86_KERNELS
+
+__attribute__((target("avx2,fma")))
+static inline float horizontalSum(__m256 v)
+{
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(v),
+    _mm256_extractf128_ps(v, 1));
+  s = _mm_hadd_ps(s, s);
+  s = _mm_hadd_ps(s, s);
+  return _mm_cvtss_f32(s);
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx2,fma")))
+static float squaredDistanceAVX2(const float *a, const float *b, int n)
+{
+  // two accumulators hide the latency of the fma
+  __m256 acc0 = _mm256_setzero_ps();
+  __m256 acc1 = _mm256_setzero_ps();
+
+  int i = 0;
+  for(; i + 16 <= n; i += 16)
+  {
+    const __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i),
+      _mm256_loadu_ps(b + i));
+    const __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8),
+      _mm256_loadu_ps(b + i + 8));
+    acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+    acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+  }
+  if(i + 8 <= n)
+  {
+    const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i),
+      _mm256_loadu_ps(b + i));
+    acc0 = _mm256_fmadd_ps(d, d, acc0);
+    i += 8;
+  }
+
+  float ret = horizontalSum(_mm256_add_ps(acc0, acc1));
+
+  for(; i < n; ++i)
+  {
+    const float d = a[i] - b[i];
+    ret += d * d;
+  }
+  return ret;
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx2,fma")))
+static void accumulateAVX2(float *sum, const float *a, int n)
+{
+  int i = 0;
+  for(; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(sum + i, _mm256_add_ps(_mm256_loadu_ps(sum + i),
+      _mm256_loadu_ps(a + i)));
+  for(; i < n; ++i) sum[i] += a[i];
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx2,fma")))
+static void scaleAVX2(float *a, float s, int n)
+{
+  const __m256 vs = _mm256_set1_ps(s);
+
+  int i = 0;
+  for(; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(a + i, _mm256_mul_ps(_mm256_loadu_ps(a + i), vs));
+  for(; i < n; ++i) a[i] *= s;
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx2,fma")))
+static int squaredDistanceInt8AVX2(const int8_t *a, const int8_t *b, int n)
+{
+  __m256i acc = _mm256_setzero_si256();
+
+  int i = 0;
+  for(; i + 16 <= n; i += 16)
+  {
+    // widen to 16 bits, so that the squares of differences up to 254 fit
+    const __m256i a16 = _mm256_cvtepi8_epi16(
+      _mm_loadu_si128((const __m128i*)(a + i)));
+    const __m256i b16 = _mm256_cvtepi8_epi16(
+      _mm_loadu_si128((const __m128i*)(b + i)));
+    const __m256i d = _mm256_sub_epi16(a16, b16);
+    acc = _mm256_add_epi32(acc, _mm256_madd_epi16(d, d));
+  }
+
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc),
+    _mm256_extracti128_si256(acc, 1));
+  s = _mm_hadd_epi32(s, s);
+  s = _mm_hadd_epi32(s, s);
+  int ret = _mm_cvtsi128_si32(s);
+
+  for(; i < n; ++i)
+  {
+    const int d = (int)a[i] - (int)b[i];
+    ret += d * d;
+  }
+  return ret;
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx2,fma,f16c")))
+static float squaredDistanceHalfAVX2(const float *a, const uint16_t *b,
+  int n)
+{
+  __m256 acc = _mm256_setzero_ps();
+
+  int i = 0;
+  for(; i + 8 <= n; i += 8)
+  {
+    const __m256 hb = _mm256_cvtph_ps(
+      _mm_loadu_si128((const __m128i*)(b + i)));
+    const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), hb);
+    acc = _mm256_fmadd_ps(d, d, acc);
+  }
+
+  float ret = horizontalSum(acc);
+
+  for(; i < n; ++i)
+  {
+    const float d = a[i] - halfToFloat(b[i]);
+    ret += d * d;
+  }
+  return ret;
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx2,fma,f16c")))
+static void toHalfAVX2(const float *a, uint16_t *h, int n)
+{
+  int i = 0;
+  for(; i + 8 <= n; i += 8)
+    _mm_storeu_si128((__m128i*)(h + i), _mm256_cvtps_ph(
+      _mm256_loadu_ps(a + i), _MM_FROUND_TO_NEAREST_INT));
+  for(; i < n; ++i) h[i] = floatToHalf(a[i]);
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx2,fma,f16c")))
+static void fromHalfAVX2(const uint16_t *h, float *a, int n)
+{
+  int i = 0;
+  for(; i + 8 <= n; i += 8)
+    _mm256_storeu_ps(a + i, _mm256_cvtph_ps(
+      _mm_loadu_si128((const __m128i*)(h + i))));
+  for(; i < n; ++i) a[i] = halfToFloat(h[i]);
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx512f")))
+static float squaredDistanceAVX512(const float *a, const float *b, int n)
+{
+  __m512 acc0 = _mm512_setzero_ps();
+  __m512 acc1 = _mm512_setzero_ps();
+
+  int i = 0;
+  for(; i + 32 <= n; i += 32)
+  {
+    const __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(a + i),
+      _mm512_loadu_ps(b + i));
+    const __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 16),
+      _mm512_loadu_ps(b + i + 16));
+    acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+    acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+  }
+  for(; i < n; i += 16)
+  {
+    // the mask loads zeros past the end
+    const __mmask16 m = (n - i >= 16 ? 0xFFFF :
+      (__mmask16)((1u << (n - i)) - 1));
+    const __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(m, a + i),
+      _mm512_maskz_loadu_ps(m, b + i));
+    acc0 = _mm512_fmadd_ps(d, d, acc0);
+  }
+
+  // _mm512_reduce_add_ps trips -Wuninitialized in some GCC versions
+  float lanes[16];
+  _mm512_storeu_ps(lanes, _mm512_add_ps(acc0, acc1));
+  return horizontalSum(_mm256_add_ps(_mm256_loadu_ps(lanes),
+    _mm256_loadu_ps(lanes + 8)));
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx512f")))
+static void accumulateAVX512(float *sum, const float *a, int n)
+{
+  for(int i = 0; i < n; i += 16)
+  {
+    const __mmask16 m = (n - i >= 16 ? 0xFFFF :
+      (__mmask16)((1u << (n - i)) - 1));
+    _mm512_mask_storeu_ps(sum + i, m, _mm512_add_ps(
+      _mm512_maskz_loadu_ps(m, sum + i), _mm512_maskz_loadu_ps(m, a + i)));
+  }
+}
+
+// --------------------------------------------------------------------------
+
+__attribute__((target("avx512f")))
+static void scaleAVX512(float *a, float s, int n)
+{
+  const __m512 vs = _mm512_set1_ps(s);
+
+  for(int i = 0; i < n; i += 16)
+  {
+    const __mmask16 m = (n - i >= 16 ? 0xFFFF :
+      (__mmask16)((1u << (n - i)) - 1));
+    _mm512_mask_storeu_ps(a + i, m,
+      _mm512_mul_ps(_mm512_maskz_loadu_ps(m, a + i), vs));
+  }
+}
+
+#endif // DBOW2_X86_KERNELS
+
+// --------------------------------------------------------------------------
+
+/// Kernels of one instruction set
+struct KernelTable
+{
+  const char *name;
+  float (*squaredDistance)(const float *, const float *, int);
+  void (*accumulate)(float *, const float *, int);
+  void (*scale)(float *, float, int);
+  int (*squaredDistanceInt8)(const int8_t *, const int8_t *, int);
+  float (*squaredDistanceHalf)(const float *, const uint16_t *, int);
+  void (*toHalf)(const float *, uint16_t *, int);
+  void (*fromHalf)(const uint16_t *, float *, int);
+};
+
+// --------------------------------------------------------------------------
+
+static KernelTable selectKernels()
+{
+#ifdef DBOW2_X86_KERNELS
+  __builtin_cpu_init();
+
+  if(__builtin_cpu_supports("avx512f"))
+  {
+    // the 16-bit kernels gain nothing from 512-bit registers
+    KernelTable k = { "AVX-512", squaredDistanceAVX512, accumulateAVX512,
+      scaleAVX512, squaredDistanceInt8AVX2, squaredDistanceHalfAVX2,
+      toHalfAVX2, fromHalfAVX2 };
+    return k;
+  }
+  if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+  {
+    // every processor with AVX2 has F16C
+    KernelTable k = { "AVX2", squaredDistanceAVX2, accumulateAVX2,
+      scaleAVX2, squaredDistanceInt8AVX2, squaredDistanceHalfAVX2,
+      toHalfAVX2, fromHalfAVX2 };
+    return k;
+  }
+#endif
+
+  KernelTable k = { "scalar", squaredDistanceScalar, accumulateScalar,
+    scaleScalar, squaredDistanceInt8Scalar, squaredDistanceHalfScalar,
+    toHalfScalar, fromHalfScalar };
+  return k;
+}
+
+// --------------------------------------------------------------------------
+
+static const KernelTable& kernels()
+{
+  static const KernelTable table = selectKernels();
+  return table;
+}
+
+// --------------------------------------------------------------------------
+
+float FloatKernels::squaredDistance(const float *a, const float *b, int n)
+{
+  return kernels().squaredDistance(a, b, n);
+}
+
+// --------------------------------------------------------------------------
+
+void FloatKernels::accumulate(float *sum, const float *a, int n)
+{
+  kernels().accumulate(sum, a, n);
+}
+
+// --------------------------------------------------------------------------
+
+void FloatKernels::scale(float *a, float s, int n)
+{
+  kernels().scale(a, s, n);
+}
+
+// --------------------------------------------------------------------------
+
+int FloatKernels::squaredDistanceInt8(const int8_t *a, const int8_t *b, int n)
+{
+  return kernels().squaredDistanceInt8(a, b, n);
+}
+
+// --------------------------------------------------------------------------
+
+float FloatKernels::squaredDistanceHalf(const float *a, const uint16_t *b,
+  int n)
+{
+  return kernels().squaredDistanceHalf(a, b, n);
+}
+
+// --------------------------------------------------------------------------
+
+void FloatKernels::toHalf(const float *a, uint16_t *h, int n)
+{
+  kernels().toHalf(a, h, n);
+}
+
+// --------------------------------------------------------------------------
+
+void FloatKernels::fromHalf(const uint16_t *h, float *a, int n)
+{
+  kernels().fromHalf(h, a, n);
+}
+
+// --------------------------------------------------------------------------
+
+const char* FloatKernels::instructionSet()
+{
+  return kernels().name;
+}
+
+// --------------------------------------------------------------------------
+
+} // namespace DBoW2
@@ -0,0 +1,141 @@
+/**
+ * File: QuantizationCache.cpp
+ * Date: October 2026
+ * Description: bounded lock-free cache of descriptor to word assignments
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <cstring>
+
+#include "QuantizationCache.h"
+
+namespace DBoW2 {
+
+// --------------------------------------------------------------------------
+
+double QuantizationCacheStats::hitRate() const
+{
+  const unsigned long long n = hits + misses;
+  return (n > 0 ? (double)hits / (double)n : 0.0);
+}
+
+// --------------------------------------------------------------------------
+
+QuantizationCache::QuantizationCache(size_t capacity)
+  : m_hits(0), m_misses(0), m_insertions(0)
+{
+  size_t n = 1;
+  while(n < capacity) n <<= 1;
+
+  m_mask = n - 1;
+  m_slots = new Slot[n];
+  clear();
+}
+
+// --------------------------------------------------------------------------
+
+QuantizationCache::~QuantizationCache()
+{
+  delete [] m_slots;
+}
+
+// --------------------------------------------------------------------------
+
+bool QuantizationCache::find(uint64_t key, NodeId &nid) const
+{
+  const Slot &slot = m_slots[key & m_mask];
+
+  const uint64_t check = slot.check.load(std::memory_order_acquire);
+  const uint64_t data = slot.data.load(std::memory_order_acquire);
+
+  if(data != 0 && (check ^ data) == key)
+  {
+    nid = (NodeId)data;
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  m_misses.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+// --------------------------------------------------------------------------
+
+void QuantizationCache::insert(uint64_t key, NodeId nid)
+{
+  Slot &slot = m_slots[key & m_mask];
+  const uint64_t data = nid;
+
+  slot.data.store(data, std::memory_order_release);
+  slot.check.store(key ^ data, std::memory_order_release);
+
+  m_insertions.fetch_add(1, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------
+
+void QuantizationCache::clear()
+{
+  for(size_t i = 0; i <= m_mask; ++i)
+  {
+    m_slots[i].data.store(0, std::memory_order_relaxed);
+    m_slots[i].check.store(0, std::memory_order_relaxed);
+  }
+}
+
+// --------------------------------------------------------------------------
+
+QuantizationCacheStats QuantizationCache::getStats() const
+{
+  QuantizationCacheStats stats;
+  stats.hits = m_hits.load(std::memory_order_relaxed);
+  stats.misses = m_misses.load(std::memory_order_relaxed);
+  stats.insertions = m_insertions.load(std::memory_order_relaxed);
+  return stats;
+}
+
+// --------------------------------------------------------------------------
+
+void QuantizationCache::resetStats()
+{
+  m_hits.store(0, std::memory_order_relaxed);
+  m_misses.store(0, std::memory_order_relaxed);
+  m_insertions.store(0, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------------------------
+
+uint64_t QuantizationCache::hashBytes(const void *data, size_t bytes)
+{
+  // 64-bit multiply-xorshift mixing of 8-byte words (murmur3 finalizer)
+  const unsigned char *p = static_cast<const unsigned char*>(data);
+  uint64_t h = 0x9e3779b97f4a7c15ULL ^ (uint64_t)bytes;
+
+  for(; bytes >= sizeof(uint64_t); bytes -= sizeof(uint64_t))
+  {
+    uint64_t w;
+    std::memcpy(&w, p, sizeof(uint64_t));
+    p += sizeof(uint64_t);
+
+    w *= 0xff51afd7ed558ccdULL;
+    w ^= w >> 33;
+    h = (h ^ w) * 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 29;
+  }
+
+  for(; bytes > 0; --bytes, ++p)
+  {
+    h = (h ^ *p) * 0x100000001b3ULL;
+  }
+
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// --------------------------------------------------------------------------
+
+} // namespace DBoW2
+
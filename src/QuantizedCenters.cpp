@@ -0,0 +1,107 @@
+/**
+ * File: QuantizedCenters.cpp
+ * Date: October 2026
+ * Description: reduced precision copy of the node centers of a vocabulary
+ *   of float descriptors
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+
+#include "QuantizedCenters.h"
+
+namespace DBoW2 {
+
+// --------------------------------------------------------------------------
+
+/// Quantizes a float to 8 bits, saturating
+static inline int8_t toCode(float x, float inv_scale)
+{
+  const float c = std::floor(x * inv_scale + 0.5f);
+  return (int8_t)(c > 127.f ? 127 : (c < -127.f ? -127 : (int)c));
+}
+
+// --------------------------------------------------------------------------
+
+QuantizedCenters::QuantizedCenters(NodePrecision precision, int dimensions)
+  : m_precision(precision), m_dimensions(dimensions), m_scale(1.f),
+    m_inv_scale(1.f)
+{
+  if(precision == FULL_PRECISION)
+    throw std::string("Full precision centers are not quantized");
+
+  if(dimensions <= 0 || dimensions > MAX_DIMENSIONS)
+  {
+    std::stringstream ss;
+    ss << "Cannot quantize centers of " << dimensions << " dimensions";
+    throw ss.str();
+  }
+}
+
+// --------------------------------------------------------------------------
+
+void QuantizedCenters::build(const std::vector<const float*> &centers)
+{
+  const size_t n = centers.size();
+
+  if(m_precision == INT8_PRECISION)
+  {
+    float max_abs = 0.f;
+    for(size_t i = 0; i < n; ++i)
+    {
+      if(!centers[i]) continue;
+      for(int j = 0; j < m_dimensions; ++j)
+        max_abs = std::max(max_abs, std::fabs(centers[i][j]));
+    }
+
+    m_scale = (max_abs > 0.f ? max_abs / 127.f : 1.f);
+    m_inv_scale = 1.f / m_scale;
+
+    m_codes.assign(n * m_dimensions, 0);
+    for(size_t i = 0; i < n; ++i)
+    {
+      if(!centers[i]) continue;
+      int8_t *c = &m_codes[i * m_dimensions];
+      for(int j = 0; j < m_dimensions; ++j)
+        c[j] = toCode(centers[i][j], m_inv_scale);
+    }
+  }
+  else
+  {
+    m_halves.assign(n * m_dimensions, 0);
+    for(size_t i = 0; i < n; ++i)
+    {
+      if(centers[i])
+        FloatKernels::toHalf(centers[i], &m_halves[i * m_dimensions],
+          m_dimensions);
+    }
+  }
+}
+
+// --------------------------------------------------------------------------
+
+void QuantizedCenters::prepare(const float *feature, Query &q) const
+{
+  q.data = feature;
+
+  if(m_precision == INT8_PRECISION)
+  {
+    for(int j = 0; j < m_dimensions; ++j)
+      q.codes[j] = toCode(feature[j], m_inv_scale);
+  }
+}
+
+// --------------------------------------------------------------------------
+
+size_t QuantizedCenters::bytes() const
+{
+  return m_codes.size() * sizeof(int8_t) + m_halves.size() * sizeof(uint16_t);
+}
+
+// --------------------------------------------------------------------------
+
+} // namespace DBoW2
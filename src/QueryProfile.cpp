@@ -0,0 +1,234 @@
+/**
+ * File: QueryProfile.cpp
+ * Date: October 2026
+ * Description: optional instrumentation of database queries
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <cmath>
+
+#include "QueryProfile.h"
+
+namespace DBoW2 {
+
+// --------------------------------------------------------------------------
+
+QueryProfile::QueryProfile()
+  : words(0), postings(0), semantic_postings(0), entries(0),
+    max_posting_length(0), heaviest_word(0), accumulation_time(0),
+    sort_time(0), semantic_time(0), total_time(0)
+{
+}
+
+// --------------------------------------------------------------------------
+
+void QueryProfile::addRow(WordId word_id, unsigned long length)
+{
+  if(length == 0) return;
+
+  ++words;
+  postings += length;
+
+  if(length > max_posting_length)
+  {
+    max_posting_length = length;
+    heaviest_word = word_id;
+  }
+}
+
+// --------------------------------------------------------------------------
+
+Histogram::Histogram()
+{
+  clear();
+}
+
+// --------------------------------------------------------------------------
+
+void Histogram::add(double value)
+{
+  size_t i = 0;
+  if(value >= 1)
+  {
+    int exp;
+    std::frexp(value, &exp); // value = m * 2^exp, m in [0.5, 1)
+    i = exp;
+  }
+
+  if(i >= m_buckets.size()) m_buckets.resize(i + 1, 0);
+  ++m_buckets[i];
+
+  if(m_count == 0 || value < m_min) m_min = value;
+  if(m_count == 0 || value > m_max) m_max = value;
+  m_sum += value;
+  ++m_count;
+}
+
+// --------------------------------------------------------------------------
+
+void Histogram::clear()
+{
+  m_buckets.clear();
+  m_count = 0;
+  m_sum = 0;
+  m_min = 0;
+  m_max = 0;
+}
+
+// --------------------------------------------------------------------------
+
+double Histogram::mean() const
+{
+  return (m_count > 0 ? m_sum / m_count : 0.0);
+}
+
+// --------------------------------------------------------------------------
+
+double Histogram::percentile(double p) const
+{
+  if(m_count == 0) return 0;
+
+  const double target = p * m_count;
+  unsigned long n = 0;
+  for(size_t i = 0; i < m_buckets.size(); ++i)
+  {
+    n += m_buckets[i];
+    if(n >= target && n > 0) return bucketLimit(i);
+  }
+  return bucketLimit(m_buckets.size() - 1);
+}
+
+// --------------------------------------------------------------------------
+
+double Histogram::bucketLimit(size_t i)
+{
+  return std::ldexp(1.0, (int)i);
+}
+
+// --------------------------------------------------------------------------
+
+QueryProfiler::QueryProfiler()
+{
+}
+
+// --------------------------------------------------------------------------
+
+QueryProfiler::QueryProfiler(const QueryProfiler &p)
+{
+  std::lock_guard<std::mutex> lock(p.m_mutex);
+  copy(p);
+}
+
+// --------------------------------------------------------------------------
+
+QueryProfiler& QueryProfiler::operator=(const QueryProfiler &p)
+{
+  if(this != &p)
+  {
+    std::unique_lock<std::mutex> lock1(m_mutex, std::defer_lock);
+    std::unique_lock<std::mutex> lock2(p.m_mutex, std::defer_lock);
+    std::lock(lock1, lock2);
+    copy(p);
+  }
+  return *this;
+}
+
+// --------------------------------------------------------------------------
+
+void QueryProfiler::copy(const QueryProfiler &p)
+{
+  m_last = p.m_last;
+  m_slowest = p.m_slowest;
+  m_words = p.m_words;
+  m_postings = p.m_postings;
+  m_entries = p.m_entries;
+  m_max_posting_length = p.m_max_posting_length;
+  m_accumulation_time = p.m_accumulation_time;
+  m_sort_time = p.m_sort_time;
+  m_semantic_time = p.m_semantic_time;
+  m_total_time = p.m_total_time;
+}
+
+// --------------------------------------------------------------------------
+
+void QueryProfiler::record(const QueryProfile &profile)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if(m_words.count() == 0 || profile.total_time > m_slowest.total_time)
+    m_slowest = profile;
+  m_last = profile;
+
+  m_words.add(profile.words);
+  m_postings.add(profile.postings);
+  m_entries.add(profile.entries);
+  m_max_posting_length.add(profile.max_posting_length);
+  m_accumulation_time.add(profile.accumulation_time * 1e6);
+  m_sort_time.add(profile.sort_time * 1e6);
+  m_semantic_time.add(profile.semantic_time * 1e6);
+  m_total_time.add(profile.total_time * 1e6);
+}
+
+// --------------------------------------------------------------------------
+
+void QueryProfiler::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_last = QueryProfile();
+  m_slowest = QueryProfile();
+  m_words.clear();
+  m_postings.clear();
+  m_entries.clear();
+  m_max_posting_length.clear();
+  m_accumulation_time.clear();
+  m_sort_time.clear();
+  m_semantic_time.clear();
+  m_total_time.clear();
+}
+
+// --------------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream &os, const Histogram &h)
+{
+  os << "mean = " << h.mean() << ", min = " << h.minValue()
+    << ", p50 < " << h.percentile(0.5)
+    << ", p99 < " << h.percentile(0.99)
+    << ", max = " << h.maxValue();
+  return os;
+}
+
+// --------------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream &os, const QueryProfiler &p)
+{
+  if(!QueryProfiler::enabled())
+  {
+    os << "Query profiling disabled in this build" << std::endl;
+    return os;
+  }
+
+  os << "Queries: " << p.queries() << std::endl
+    << "Words: " << p.words() << std::endl
+    << "Postings: " << p.postings() << std::endl
+    << "Longest row: " << p.maxPostingLength() << std::endl
+    << "Entries scored: " << p.entries() << std::endl
+    << "Accumulation (us): " << p.accumulationTime() << std::endl
+    << "Sort (us): " << p.sortTime() << std::endl
+    << "Semantic weighting (us): " << p.semanticTime() << std::endl
+    << "Total (us): " << p.totalTime() << std::endl;
+
+  if(p.queries() > 0)
+  {
+    const QueryProfile &s = p.slowest();
+    os << "Slowest query: " << s.total_time * 1e6 << " us, "
+      << s.postings << " postings, longest row of word "
+      << s.heaviest_word << " (" << s.max_posting_length << ")" << std::endl;
+  }
+  return os;
+}
+
+// --------------------------------------------------------------------------
+
+} // namespace DBoW2
@@ -0,0 +1,354 @@
+/**
+ * File: SemanticClasses.cpp
+ * Date: October 2026
+ * Description: semantic classes of the features and compatibility of
+ *   their matches
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+
+#include "SemanticClasses.h"
+#include "Bundle.h"
+
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+namespace DBoW2 {
+
+// --------------------------------------------------------------------------
+
+const SemanticClasses::Index SemanticClasses::NO_CLASS;
+const SemanticClasses::Index SemanticClasses::UNKNOWN_CLASS;
+const int SemanticClasses::MAX_ID;
+const int SemanticClasses::MAX_CLASSES;
+
+// --------------------------------------------------------------------------
+
+/// Checks that an id fits in 16 bits
+static void checkId(int id, int min_id, const char *what)
+{
+  if(id < min_id || id > SemanticClasses::MAX_ID)
+  {
+    std::stringstream ss;
+    ss << "Semantic " << what << " id " << id << " out of range ["
+      << min_id << ", " << SemanticClasses::MAX_ID << "]";
+    throw ss.str();
+  }
+}
+
+// --------------------------------------------------------------------------
+
+SemanticClasses::SemanticClasses()
+  : m_stride(0)
+{
+  clear();
+}
+
+// --------------------------------------------------------------------------
+
+void SemanticClasses::clear()
+{
+  const SemanticClass none = { 0, 0 };
+
+  m_classes.assign(2, none); // NO_CLASS, UNKNOWN_CLASS
+  m_anchors.assign(2, 0);
+  m_dynamic.assign(2, 0);
+  m_feature_weights.assign(2, -1.f);
+  m_slots.clear();
+  buildMatrix();
+}
+
+// --------------------------------------------------------------------------
+
+void SemanticClasses::load(const std::string &filename)
+{
+  std::ifstream f(filename.c_str());
+  if(!f.is_open())
+    throw std::string("Could not open file ") + filename;
+
+  json data;
+  try
+  {
+    data = json::parse(f);
+  }
+  catch(const json::exception &e)
+  {
+    throw std::string("Could not parse class file ") + filename + ": " +
+      e.what();
+  }
+
+  const json &categories = data["categories"];
+
+  // super-categories given by name are numbered after the largest numeric
+  // one, so both kinds can be mixed
+  int next_parent = 1;
+  for(json::const_iterator it = categories.begin(); it != categories.end();
+    ++it)
+  {
+    json::const_iterator sit = it->find("supercategory");
+    if(sit != it->end() && sit->is_number_integer())
+      next_parent = std::max(next_parent, sit->get<int>() + 1);
+  }
+
+  std::map<std::string, int> parent_names;
+  for(json::const_iterator it = categories.begin(); it != categories.end();
+    ++it)
+  {
+    const json &category = *it;
+    int parent = 0;
+
+    json::const_iterator sit = category.find("supercategory");
+    if(sit != category.end())
+    {
+      if(sit->is_number_integer())
+      {
+        parent = sit->get<int>();
+      }
+      else if(sit->is_string())
+      {
+        std::map<std::string, int>::iterator pit =
+          parent_names.insert(std::make_pair(sit->get<std::string>(),
+            next_parent)).first;
+        if(pit->second == next_parent) ++next_parent;
+        parent = pit->second;
+      }
+    }
+
+    json::const_iterator ait = category.find("is_anchor");
+    const bool is_anchor = (ait != category.end() && ait->get<bool>());
+
+    json::const_iterator dit = category.find("is_dynamic");
+    const bool is_dynamic = (dit != category.end() && dit->get<bool>());
+
+    json::const_iterator wit = category.find("weight");
+    const double weight = (wit != category.end() ? wit->get<double>() : -1);
+
+    add(category.at("id").get<int>(), parent, is_anchor, weight, is_dynamic);
+  }
+}
+
+// --------------------------------------------------------------------------
+
+void SemanticClasses::saveBinary(std::ostream &out) const
+{
+  // the first two slots are NO_CLASS and UNKNOWN_CLASS
+  BundleSection::write(out, (uint32_t)(m_classes.size() - 2));
+
+  BundleSection::write(out, m_weights.match);
+  BundleSection::write(out, m_weights.anchor_match);
+  BundleSection::write(out, m_weights.related);
+  BundleSection::write(out, m_weights.mismatch);
+  BundleSection::write(out, m_weights.anchor_feature);
+  BundleSection::write(out, m_weights.feature);
+  BundleSection::write(out, m_weights.dynamic_feature);
+
+  for(size_t i = 2; i < m_classes.size(); ++i)
+  {
+    BundleSection::write(out, m_classes[i].id);
+    BundleSection::write(out, m_classes[i].parent);
+    BundleSection::write(out, m_anchors[i]);
+    BundleSection::write(out, m_dynamic[i]);
+    BundleSection::write(out, (uint16_t)0); // padding
+    BundleSection::write(out, m_feature_weights[i]);
+  }
+}
+
+// --------------------------------------------------------------------------
+
+void SemanticClasses::loadBinary(BundleSection section)
+{
+  const uint32_t n = section.read<uint32_t>();
+  if(n > (uint32_t)MAX_CLASSES - 2) throw std::string("Too many classes");
+
+  SemanticWeights weights;
+  weights.match = section.read<double>();
+  weights.anchor_match = section.read<double>();
+  weights.related = section.read<double>();
+  weights.mismatch = section.read<double>();
+  weights.anchor_feature = section.read<double>();
+  weights.feature = section.read<double>();
+  weights.dynamic_feature = section.read<double>();
+
+  clear();
+  for(uint32_t i = 0; i < n; ++i)
+  {
+    const uint16_t id = section.read<uint16_t>();
+    const uint16_t parent = section.read<uint16_t>();
+    const unsigned char is_anchor = section.read<unsigned char>();
+    const unsigned char is_dynamic = section.read<unsigned char>();
+    section.skip(sizeof(uint16_t));
+    const float weight = section.read<float>();
+
+    if(m_slots.count(id)) throw std::string("Repeated class in the data");
+    add(id, parent, is_anchor != 0, weight, is_dynamic != 0);
+  }
+
+  setWeights(weights);
+}
+
+// --------------------------------------------------------------------------
+
+SemanticClasses::Index SemanticClasses::add(int id, int parent,
+  bool is_anchor, double weight, bool is_dynamic)
+{
+  checkId(id, 1, "class");
+  checkId(parent, 0, "super-category");
+
+  SemanticClass c;
+  c.id = (uint16_t)id;
+  c.parent = (uint16_t)parent;
+
+  std::unordered_map<int, Index>::const_iterator it = m_slots.find(id);
+  if(it == m_slots.end()) return append(c, is_anchor, weight, is_dynamic);
+
+  m_classes[it->second] = c;
+  m_anchors[it->second] = (is_anchor ? 1 : 0);
+  m_dynamic[it->second] = (is_dynamic ? 1 : 0);
+  m_feature_weights[it->second] = (float)weight;
+  fillSlot(it->second);
+  return it->second;
+}
+
+// --------------------------------------------------------------------------
+
+SemanticClasses::Index SemanticClasses::insert(int id)
+{
+  if(id <= 0) return NO_CLASS;
+
+  std::unordered_map<int, Index>::const_iterator it = m_slots.find(id);
+  if(it != m_slots.end()) return it->second;
+
+  checkId(id, 1, "class");
+
+  SemanticClass c;
+  c.id = (uint16_t)id;
+  c.parent = 0;
+  return append(c, false, -1, false);
+}
+
+// --------------------------------------------------------------------------
+
+SemanticClasses::Index SemanticClasses::append(const SemanticClass &c,
+  bool is_anchor, double weight, bool is_dynamic)
+{
+  if(m_classes.size() >= (size_t)MAX_CLASSES)
+  {
+    std::stringstream ss;
+    ss << "Cannot register more than " << MAX_CLASSES - 2
+      << " semantic classes";
+    throw ss.str();
+  }
+
+  const Index i = (Index)m_classes.size();
+  m_classes.push_back(c);
+  m_anchors.push_back(is_anchor ? 1 : 0);
+  m_dynamic.push_back(is_dynamic ? 1 : 0);
+  m_feature_weights.push_back((float)weight);
+  m_slots[c.id] = i;
+
+  if(m_classes.size() > m_stride) buildMatrix();
+  else fillSlot(i);
+
+  return i;
+}
+
+// --------------------------------------------------------------------------
+
+void SemanticClasses::setWeights(const SemanticWeights &weights)
+{
+  m_weights = weights;
+  buildMatrix();
+}
+
+// --------------------------------------------------------------------------
+
+void SemanticClasses::buildMatrix()
+{
+  if(m_stride < 16) m_stride = 16;
+  while(m_stride < m_classes.size()) m_stride *= 2;
+
+  m_matrix.assign(m_stride * m_stride, (float)m_weights.mismatch);
+  for(size_t i = 0; i < m_classes.size(); ++i) fillSlot((Index)i);
+}
+
+// --------------------------------------------------------------------------
+
+void SemanticClasses::fillSlot(Index i)
+{
+  const SemanticClass &a = m_classes[i];
+
+  for(size_t j = 0; j < m_classes.size(); ++j)
+  {
+    const SemanticClass &b = m_classes[j];
+    float w = (float)m_weights.mismatch;
+
+    if(i == NO_CLASS && j == NO_CLASS)
+      w = 0.f; // the database does not score pairs without classes
+    else if(i == NO_CLASS || i == UNKNOWN_CLASS ||
+      j == NO_CLASS || j == UNKNOWN_CLASS)
+      w = (float)m_weights.mismatch;
+    else if(i == j)
+      w = (float)(m_anchors[i] ? m_weights.anchor_match : m_weights.match);
+    else if(a.parent != 0 && a.parent == b.parent)
+      w = (float)m_weights.related;
+
+    m_matrix[(size_t)i * m_stride + j] = w;
+    m_matrix[j * m_stride + i] = w;
+  }
+}
+
+// --------------------------------------------------------------------------
+
+double SemanticClasses::featureWeight(Index i) const
+{
+  if(i == NO_CLASS || i == UNKNOWN_CLASS) return 1;
+  if(m_feature_weights[i] >= 0.f) return m_feature_weights[i];
+  if(m_dynamic[i]) return m_weights.dynamic_feature;
+  return (m_anchors[i] ? m_weights.anchor_feature : m_weights.feature);
+}
+
+// --------------------------------------------------------------------------
+
+void SemanticClasses::getFeatureWeights(std::vector<float> &weights) const
+{
+  weights.clear();
+
+  int max_id = 0;
+  bool weighted = false;
+  for(size_t i = 2; i < m_classes.size(); ++i)
+  {
+    max_id = std::max(max_id, (int)m_classes[i].id);
+    if(featureWeight((Index)i) != 1) weighted = true;
+  }
+
+  if(!weighted) return;
+
+  weights.assign(max_id + 1, 1.f);
+  for(size_t i = 2; i < m_classes.size(); ++i)
+    weights[m_classes[i].id] = (float)featureWeight((Index)i);
+}
+
+// --------------------------------------------------------------------------
+
+size_t SemanticClasses::bytes() const
+{
+  return m_classes.capacity() * sizeof(SemanticClass) +
+    m_anchors.capacity() * sizeof(unsigned char) +
+    m_dynamic.capacity() * sizeof(unsigned char) +
+    m_feature_weights.capacity() * sizeof(float) +
+    m_slots.bucket_count() * sizeof(void*) +
+    m_slots.size() *
+      (sizeof(std::unordered_map<int, Index>::value_type) + sizeof(void*)) +
+    m_matrix.capacity() * sizeof(float);
+}
+
+// --------------------------------------------------------------------------
+
+} // namespace DBoW2
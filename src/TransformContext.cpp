@@ -0,0 +1,167 @@
+/**
+ * File: TransformContext.cpp
+ * Date: October 2026
+ * Description: reusable scratch storage for vocabulary transforms
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "TransformContext.h"
+
+namespace DBoW2 {
+
+// --------------------------------------------------------------------------
+
+TransformContext::TransformContext(size_t features)
+{
+  reserve(features);
+}
+
+// --------------------------------------------------------------------------
+
+void TransformContext::reserve(size_t features)
+{
+  m_assignments.reserve(features);
+  m_words.reserve(features);
+  m_features.reserve(features);
+  m_votes.reserve(features);
+}
+
+// --------------------------------------------------------------------------
+
+void TransformContext::clear()
+{
+  m_assignments.clear();
+  m_words.clear();
+  m_features.clear();
+}
+
+// --------------------------------------------------------------------------
+
+void TransformContext::finish(bool tf, bool must_normalize, LNorm norm)
+{
+  m_words.clear();
+  m_features.clear();
+
+  std::vector<Assignment>::const_iterator ait;
+  for(ait = m_assignments.begin(); ait != m_assignments.end(); ++ait)
+    m_features.push_back(std::make_pair(ait->nid, ait->i_feature));
+  std::sort(m_features.begin(), m_features.end());
+
+  // std::sort does not allocate memory, unlike std::stable_sort. Repeated
+  // words are ordered by feature, so without tf the first feature keeps its
+  // weight (which depends on its class), as in BowVector::addIfNotExist
+  std::sort(m_assignments.begin(), m_assignments.end());
+
+  for(ait = m_assignments.begin(); ait != m_assignments.end(); ++ait)
+  {
+    if(!m_words.empty() && m_words.back().first == ait->word_id)
+    {
+      if(tf) m_words.back().second += ait->weight;
+    }
+    else
+      m_words.push_back(std::make_pair(ait->word_id, ait->weight));
+  }
+
+  Words::iterator wit;
+  if(must_normalize)
+  {
+    // same as BowVector::normalize
+    double n = 0.0;
+    if(norm == L1)
+    {
+      for(wit = m_words.begin(); wit != m_words.end(); ++wit)
+        n += fabs(wit->second);
+    }
+    else
+    {
+      for(wit = m_words.begin(); wit != m_words.end(); ++wit)
+        n += wit->second * wit->second;
+      n = sqrt(n);
+    }
+
+    if(n > 0.0)
+      for(wit = m_words.begin(); wit != m_words.end(); ++wit)
+        wit->second /= n;
+  }
+  else if(tf && !m_words.empty())
+  {
+    const double nd = m_words.size();
+    for(wit = m_words.begin(); wit != m_words.end(); ++wit)
+      wit->second /= nd;
+  }
+}
+
+// --------------------------------------------------------------------------
+
+void TransformContext::toBowVector(BowVector &v) const
+{
+  v.clear();
+
+  Words::const_iterator wit;
+  for(wit = m_words.begin(); wit != m_words.end(); ++wit)
+    v.insert(v.end(), *wit);
+}
+
+// --------------------------------------------------------------------------
+
+void TransformContext::toFeatureVector(FeatureVector &fv) const
+{
+  fv.clear();
+
+  FeatureVector::iterator fit = fv.end();
+  Features::const_iterator it;
+  for(it = m_features.begin(); it != m_features.end(); ++it)
+  {
+    if(fit == fv.end() || fit->first != it->first)
+      fit = fv.insert(fv.end(),
+        FeatureVector::value_type(it->first, std::vector<unsigned int>()));
+    fit->second.push_back(it->second);
+  }
+}
+
+// --------------------------------------------------------------------------
+
+void TransformContext::wordClasses(const int *classes,
+  std::vector<int> &word_classes) const
+{
+  word_classes.assign(m_words.size(), 0);
+
+  // after finish, the assignments are sorted by word like m_words, so the
+  // i-th run of assignments of the same word is the i-th word
+  std::vector<int> &votes = m_votes;
+  std::vector<Assignment>::const_iterator ait = m_assignments.begin();
+  for(size_t w = 0; w < m_words.size(); ++w)
+  {
+    votes.clear();
+    for(; ait != m_assignments.end() && ait->word_id == m_words[w].first;
+      ++ait)
+    {
+      const int c = classes[ait->i_feature];
+      if(c > 0) votes.push_back(c);
+    }
+
+    if(votes.empty()) continue;
+    std::sort(votes.begin(), votes.end());
+
+    size_t best = 0;
+    for(size_t i = 0; i < votes.size(); )
+    {
+      size_t j = i + 1;
+      while(j < votes.size() && votes[j] == votes[i]) ++j;
+      if(j - i > best)
+      {
+        best = j - i;
+        word_classes[w] = votes[i];
+      }
+      i = j;
+    }
+  }
+}
+
+// --------------------------------------------------------------------------
+
+} // namespace DBoW2
@@ -0,0 +1,63 @@
+/**
+ * File: VocabularyRemap.cpp
+ * Date: October 2026
+ * Description: correspondence between the words and nodes of a vocabulary
+ *   and those of its pruned version
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <algorithm>
+#include <fstream>
+
+#include "VocabularyRemap.h"
+
+namespace DBoW2 {
+
+// --------------------------------------------------------------------------
+
+unsigned int VocabularyRemap::prunedWords() const
+{
+  if(words.empty()) return 0;
+  return *std::max_element(words.begin(), words.end()) + 1;
+}
+
+// --------------------------------------------------------------------------
+
+void VocabularyRemap::save(const std::string &filename) const
+{
+  std::ofstream f(filename.c_str());
+  if(!f.is_open()) throw std::string("Could not open file ") + filename;
+
+  f << words.size() << " " << nodes.size() << "\n";
+  for(size_t i = 0; i < words.size(); ++i) f << words[i] << "\n";
+  for(size_t i = 0; i < nodes.size(); ++i) f << nodes[i] << "\n";
+
+  if(!f) throw std::string("Could not write file ") + filename;
+}
+
+// --------------------------------------------------------------------------
+
+void VocabularyRemap::load(const std::string &filename)
+{
+  std::ifstream f(filename.c_str());
+  if(!f.is_open()) throw std::string("Could not open file ") + filename;
+
+  size_t nwords = 0, nnodes = 0;
+  f >> nwords >> nnodes;
+  if(!f || nwords > nnodes)
+    throw std::string("Invalid remap file ") + filename;
+
+  std::vector<WordId> w(nwords);
+  std::vector<NodeId> n(nnodes);
+  for(size_t i = 0; i < nwords; ++i) f >> w[i];
+  for(size_t i = 0; i < nnodes; ++i) f >> n[i];
+  if(!f) throw std::string("Invalid remap file ") + filename;
+
+  words.swap(w);
+  nodes.swap(n);
+}
+
+// --------------------------------------------------------------------------
+
+} // namespace DBoW2
@@ -0,0 +1,110 @@
+/**
+ * File: VocabularyStats.cpp
+ * Date: October 2026
+ * Description: statistics of the structure and balance of a vocabulary
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "VocabularyStats.h"
+
+namespace DBoW2 {
+
+// --------------------------------------------------------------------------
+
+Distribution::Distribution()
+  : count(0), mean(0), stddev(0), min(0), max(0), gini(0), top1_share(0)
+{
+}
+
+// --------------------------------------------------------------------------
+
+void Distribution::compute(std::vector<double> &values)
+{
+  *this = Distribution();
+  if(values.empty()) return;
+
+  std::sort(values.begin(), values.end());
+
+  count = values.size();
+  min = values.front();
+  max = values.back();
+
+  double sum = 0, sum2 = 0, weighted = 0;
+  for(size_t i = 0; i < values.size(); ++i)
+  {
+    sum += values[i];
+    sum2 += values[i] * values[i];
+    weighted += (i + 1) * values[i];
+  }
+
+  mean = sum / count;
+  stddev = std::sqrt(std::max(0.0, sum2 / count - mean * mean));
+
+  if(sum > 0)
+  {
+    // with ascending values, G = 2 sum(i x_i) / (n sum(x)) - (n + 1) / n
+    gini = 2. * weighted / (count * sum) - (count + 1.) / count;
+
+    const size_t top = std::max<size_t>(1, values.size() / 100);
+    double top_sum = 0;
+    for(size_t i = values.size() - top; i < values.size(); ++i)
+      top_sum += values[i];
+    top1_share = top_sum / sum;
+  }
+}
+
+// --------------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream &os, const Distribution &d)
+{
+  os << "mean = " << d.mean << ", stddev = " << d.stddev
+    << ", min = " << d.min << ", max = " << d.max
+    << ", gini = " << d.gini;
+  return os;
+}
+
+// --------------------------------------------------------------------------
+
+std::ostream& operator<<(std::ostream &os, const VocabularyStats &stats)
+{
+  os << "Vocabulary: k = " << stats.k << ", L = " << stats.L
+    << ", Nodes = " << stats.nodes << ", Words = " << stats.words
+    << std::endl;
+
+  for(size_t i = 0; i < stats.levels.size(); ++i)
+  {
+    const LevelStats &level = stats.levels[i];
+    os << "  Level " << i << ": " << level.nodes << " nodes, "
+      << level.leaves << " words";
+    if(level.branching.count > 0)
+      os << ", branching " << level.branching.mean
+        << " [" << level.branching.min << ".." << level.branching.max << "]";
+    os << std::endl;
+  }
+
+  os << "Word depth: " << stats.word_depth << std::endl
+    << "Word weights: " << stats.idf << std::endl;
+
+  if(stats.occupancy.count > 0)
+    os << "Training occupancy: " << stats.occupancy << ", "
+      << stats.empty_words << " empty words, top 1% words take "
+      << stats.occupancy.top1_share * 100 << "%" << std::endl;
+
+  os << "Descent cost: " << stats.descent_cost << " distances per descriptor"
+    << " (" << stats.ideal_descent_cost << " if balanced)" << std::endl;
+
+  if(stats.word_frequency.count > 0)
+    os << "Database word frequency: " << stats.word_frequency
+      << ", top 1% words take " << stats.word_frequency.top1_share * 100
+      << "% of the postings" << std::endl;
+
+  return os;
+}
+
+// --------------------------------------------------------------------------
+
+} // namespace DBoW2
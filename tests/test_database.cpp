@@ -0,0 +1,217 @@
+/**
+ * File: test_database.cpp
+ * Date: October 2026
+ * Description: checks of the semantic database that run without data files
+ * License: see the LICENSE.txt file
+ *
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "DBoW2.h"
+
+using namespace DBoW2;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string &what)
+{
+  if(!condition)
+  {
+    std::cerr << "FAILED: " << what << std::endl;
+    ++failures;
+  }
+}
+
+/// Random ORB descriptor with a class
+FSORB::TDescriptor randomFeature(int c)
+{
+  FSORB::TDescriptor f;
+  f.first.create(1, FORB::L, CV_8U);
+  unsigned char *p = f.first.ptr<unsigned char>();
+  for(int i = 0; i < FORB::L; ++i) p[i] = (unsigned char)(rand() & 0xff);
+  f.second = c;
+  return f;
+}
+
+/// Copies some features with another class
+std::vector<FSORB::TDescriptor> withClass(
+  const std::vector<FSORB::TDescriptor> &features, int c)
+{
+  std::vector<FSORB::TDescriptor> ret(features);
+  for(size_t i = 0; i < ret.size(); ++i) ret[i].second = c;
+  return ret;
+}
+
+bool contains(const QueryResults &ret, EntryId id)
+{
+  for(size_t i = 0; i < ret.size(); ++i)
+    if(ret[i].Id == id) return true;
+  return false;
+}
+
+// ---------------------------------------------------------------------------
+
+/// A prefiltered query keeps the entries that share its anchor classes,
+/// also when they share signature bits, and after saving and loading the
+/// database without direct index
+void testPrefilterSaveLoad()
+{
+  // 100 anchor classes: class c has slot c + 1, so classes 1 and 65 share
+  // the bit of slot 2 in the signatures
+  const std::string class_file = "test_database_classes.json";
+  {
+    std::ofstream f(class_file.c_str());
+    f << "{ \"categories\": [";
+    for(int c = 1; c <= 100; ++c)
+      f << (c > 1 ? ", " : "") << "{ \"id\": " << c
+        << ", \"is_anchor\": true }";
+    f << "] }";
+  }
+
+  srand(0);
+  std::vector<FSORB::TDescriptor> place(60);
+  for(size_t i = 0; i < place.size(); ++i) place[i] = randomFeature(1);
+
+  std::vector<std::vector<FSORB::TDescriptor> > training(10);
+  training[0] = place;
+  for(size_t i = 1; i < training.size(); ++i)
+    for(int j = 0; j < 60; ++j) training[i].push_back(randomFeature(3));
+
+  SemanticOrbVocabulary voc(6, 3);
+  voc.create(training);
+
+  std::string classes = class_file;
+  SemanticOrbDatabase db(voc, classes, false, 0);
+
+  // entry 0: the place with classes 1 and 65
+  std::vector<FSORB::TDescriptor> query = place;
+  for(size_t i = 0; i < query.size(); i += 2) query[i].second = 65;
+  db.add(query);
+
+  // entry 1: the place with class 1, and one feature of class 65 that
+  // loses its word to a feature of class 1, so that no word has class 65
+  std::vector<FSORB::TDescriptor> minority = withClass(place, 1);
+  minority.push_back(place[0]);
+  minority.back().second = 65;
+  db.add(minority);
+
+  // entry 2: the place with class 1 only
+  db.add(withClass(place, 1));
+
+  for(size_t i = 1; i < training.size(); ++i) db.add(training[i]);
+
+  db.setSemanticPrefilter(2);
+
+  QueryResults ret;
+  db.query(query, ret, 0);
+  check(contains(ret, 0), "prefilter keeps the query place");
+  check(contains(ret, 1), "prefilter keeps the minority classes");
+  check(!contains(ret, 2), "prefilter discards one shared anchor");
+
+  const std::string db_file = "test_database_prefilter.yml.gz";
+  db.save(db_file);
+
+  SemanticOrbDatabase loaded(voc, classes, false, 0);
+  loaded.load(db_file);
+  loaded.setSemanticPrefilter(2);
+
+  QueryResults ret_loaded;
+  loaded.query(query, ret_loaded, 0);
+  check(ret_loaded.size() == ret.size(), "same results after loading");
+  for(size_t i = 0; i < ret.size() && i < ret_loaded.size(); ++i)
+    check(ret[i].Id == ret_loaded[i].Id, "same entries after loading");
+  check(contains(ret_loaded, 1), "minority classes kept after loading");
+
+  std::remove(db_file.c_str());
+  std::remove(class_file.c_str());
+}
+
+// ---------------------------------------------------------------------------
+
+/// The dropped and down-weighted feature counters of computeStats are kept
+/// after saving and loading the database in yaml and bundle formats
+void testCountersSaveLoad()
+{
+  // class 1 is an anchor, 2 is dynamic (dropped) and 3 is down-weighted
+  const std::string class_file = "test_database_counters.json";
+  {
+    std::ofstream f(class_file.c_str());
+    f << "{ \"categories\": ["
+      << "{ \"id\": 1, \"is_anchor\": true }, "
+      << "{ \"id\": 2, \"is_dynamic\": true }, "
+      << "{ \"id\": 3, \"weight\": 0.5 }"
+      << "] }";
+  }
+
+  srand(1);
+  std::vector<std::vector<FSORB::TDescriptor> > training(4);
+  for(size_t i = 0; i < training.size(); ++i)
+    for(int j = 0; j < 30; ++j)
+      training[i].push_back(randomFeature(1 + j % 3));
+
+  SemanticOrbVocabulary voc(6, 3);
+  voc.create(training);
+
+  std::string classes = class_file;
+  SemanticOrbDatabase db(voc, classes, false, 0);
+  for(size_t i = 0; i < training.size(); ++i) db.add(training[i]);
+
+  const DatabaseStats stats = db.computeStats();
+  check(stats.dropped_features == 40, "dynamic features dropped");
+  check(stats.weighted_features == 40, "features down-weighted");
+  check(stats.dropped_classes.size() == 1 &&
+    stats.dropped_classes[0].first == 2, "dropped class");
+
+  const std::string db_file = "test_database_counters.yml.gz";
+  const std::string bundle_file = "test_database_counters.bin";
+  db.save(db_file);
+  db.saveBundle(bundle_file);
+
+  SemanticOrbDatabase loaded(voc, classes, false, 0);
+  loaded.load(db_file);
+  DatabaseStats s = loaded.computeStats();
+  check(s.dropped_features == stats.dropped_features &&
+    s.weighted_features == stats.weighted_features &&
+    s.dropped_classes == stats.dropped_classes, "counters kept in yaml");
+
+  SemanticOrbDatabase bundled;
+  bundled.loadBundle(bundle_file);
+  s = bundled.computeStats();
+  check(s.dropped_features == stats.dropped_features &&
+    s.weighted_features == stats.weighted_features &&
+    s.dropped_classes == stats.dropped_classes, "counters kept in bundle");
+
+  std::remove(db_file.c_str());
+  std::remove(bundle_file.c_str());
+  std::remove(class_file.c_str());
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+
+int main()
+{
+  try
+  {
+    testPrefilterSaveLoad();
+    testCountersSaveLoad();
+  }
+  catch(const std::string &e)
+  {
+    std::cerr << "FAILED: " << e << std::endl;
+    return 1;
+  }
+
+  if(failures == 0) std::cout << "All tests passed" << std::endl;
+  return (failures == 0 ? 0 : 1);
+}